@@ -0,0 +1,303 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <getopt.h>
+#include <time.h>
+
+#include "common.h"
+#include "types.h"
+#include "hccvt.h"
+#include "htrpool.h"
+#include "htrsrc.h"
+
+/**
+ * Name........: htr_bench.c
+ * License.....: MIT
+ *
+ * extraction throughput and per-format latency, the same detection and
+ * converters as hash_extr, in process, without cache, dedup or outfiles
+ *
+ *   htr_bench [-j workers] [-r rounds] corpus...
+ *
+ * bench/mkcorpus.py writes a corpus, `make bench` does both
+ */
+
+#define HTR_BENCH_KEY_LEN 32
+
+struct htr_bench_sample {
+  char key[HTR_BENCH_KEY_LEN];  // hash mode, "10700", "11600 failed"
+  u64  size;
+  u64  ns;
+};
+
+typedef struct htr_bench_sample htr_bench_sample_t;
+
+struct htr_bench {
+  htr_bench_sample_t *samples;
+  u64                 samples_cnt;
+  u64                 samples_size;
+
+  u64 failed_cnt;
+
+  bool oom;
+
+  pthread_mutex_t mux;
+};
+
+typedef struct htr_bench htr_bench_t;
+
+static u64 htr_bench_now_ns ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+static void print_usage ()
+{
+  printf ("Usage: htr_bench [options] corpus...\n\n");
+  printf ("  -j, --workers     files converted in parallel (default 1)\n");
+  printf ("  -r, --rounds      passes over the corpus (default 3)\n");
+  printf ("  -h, --help        this help\n\n");
+  printf ("corpus: files or directories, walked recursively, see bench/mkcorpus.py\n");
+}
+
+static void htr_bench_add (htr_bench_t *bench, const char *key, const u64 size, const u64 ns)
+{
+  pthread_mutex_lock (&bench->mux);
+
+  if (bench->samples_cnt == bench->samples_size)
+  {
+    const u64 samples_size = (bench->samples_size == 0) ? 1024 : bench->samples_size * 2;
+
+    htr_bench_sample_t *samples = (htr_bench_sample_t *) realloc (bench->samples, samples_size * sizeof (htr_bench_sample_t));
+
+    if (samples == NULL)
+    {
+      bench->oom = true;
+
+      pthread_mutex_unlock (&bench->mux);
+
+      return;
+    }
+
+    bench->samples      = samples;
+    bench->samples_size = samples_size;
+  }
+
+  htr_bench_sample_t *sample = &bench->samples[bench->samples_cnt++];
+
+  snprintf (sample->key, sizeof (sample->key), "%s", key);
+
+  sample->size = size;
+  sample->ns   = ns;
+
+  pthread_mutex_unlock (&bench->mux);
+}
+
+// runs in a worker, what extract_rfile () in hash_extr does for a file nobody has seen before
+static int htr_bench_extract (void *userdata, rfile_info_ctx_t *rfile_info_ctx)
+{
+  htr_bench_t *bench = (htr_bench_t *) userdata;
+
+  char key[HTR_BENCH_KEY_LEN];
+
+  u64 size = 0;
+
+  const u64 start_ns = htr_bench_now_ns ();
+
+  int rc = 1;
+
+  if (get_rw_rfile_ftype (rfile_info_ctx) == -1)
+  {
+    rc = -1;
+
+    snprintf (key, sizeof (key), "unknown");
+  }
+  else
+  {
+    size = rfile_info_ctx->probe.size;
+
+    rc = extract_hchash_vaguemode (rfile_info_ctx);
+
+    if (rc == -1 || rfile_info_ctx->hash_ctx->hash == NULL)
+    {
+      rc = -1;
+
+      snprintf (key, sizeof (key), "%d failed", rfile_info_ctx->hash_ctx->hash_mode);
+    }
+    else
+    {
+      snprintf (key, sizeof (key), "%d", rfile_info_ctx->hash_ctx->hash_mode);
+    }
+  }
+
+  const u64 ns = htr_bench_now_ns () - start_ns;
+
+  htr_bench_add (bench, key, size, ns);
+
+  return rc;
+}
+
+static void htr_bench_commit (void *userdata, MAYBE_UNUSED rfile_info_ctx_t *rfile_info_ctx, int rc)
+{
+  htr_bench_t *bench = (htr_bench_t *) userdata;
+
+  if (rc == -1) bench->failed_cnt++;
+}
+
+static int htr_bench_sample_cmp (const void *a, const void *b)
+{
+  const htr_bench_sample_t *x = (const htr_bench_sample_t *) a;
+  const htr_bench_sample_t *y = (const htr_bench_sample_t *) b;
+
+  const int cmp = strcmp (x->key, y->key);
+
+  if (cmp != 0) return cmp;
+
+  if (x->ns != y->ns) return (x->ns < y->ns) ? -1 : 1;
+
+  return 0;
+}
+
+// nearest rank, samples sorted
+static double htr_bench_pct_ms (const htr_bench_sample_t *samples, const u64 cnt, const u32 pct)
+{
+  u64 rank = (cnt * pct + 99) / 100;
+
+  if (rank == 0) rank = 1;
+
+  return (double) samples[rank - 1].ns / 1e6;
+}
+
+static void htr_bench_report (htr_bench_t *bench)
+{
+  qsort (bench->samples, bench->samples_cnt, sizeof (htr_bench_sample_t), htr_bench_sample_cmp);
+
+  printf ("\n%-16s %8s %10s %10s %10s %10s %10s\n", "hash mode", "files", "MB", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+  for (u64 i = 0; i < bench->samples_cnt;)
+  {
+    u64 j = i;
+
+    u64 bytes = 0;
+
+    while (j < bench->samples_cnt && strcmp (bench->samples[i].key, bench->samples[j].key) == 0)
+    {
+      bytes += bench->samples[j].size;
+
+      j++;
+    }
+
+    const htr_bench_sample_t *group = &bench->samples[i];
+
+    const u64 cnt = j - i;
+
+    printf ("%-16s %8" PRIu64 " %10.2f %10.3f %10.3f %10.3f %10.3f\n", group->key, cnt, (double) bytes / (1024 * 1024),
+      htr_bench_pct_ms (group, cnt, 50),
+      htr_bench_pct_ms (group, cnt, 90),
+      htr_bench_pct_ms (group, cnt, 99),
+      (double) group[cnt - 1].ns / 1e6);
+
+    i = j;
+  }
+}
+
+int main (int argc, char **argv)
+{
+  u32 workers_cnt = 1;
+  u32 rounds_cnt  = 3;
+
+  const struct option long_options[] =
+  {
+    {"workers", required_argument, 0, 'j'},
+    {"rounds",  required_argument, 0, 'r'},
+    {"help",    no_argument,       0, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  int c;
+
+  while ((c = getopt_long (argc, argv, "j:r:h", long_options, NULL)) != -1)
+  {
+    switch (c)
+    {
+    case 'j':
+      workers_cnt = atoi (optarg);
+      break;
+    case 'r':
+      rounds_cnt = atoi (optarg);
+      break;
+    case 'h':
+      print_usage ();
+      return 0;
+    default:
+      print_usage ();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind == argc)
+  {
+    print_usage ();
+
+    return EXIT_FAILURE;
+  }
+
+  if (workers_cnt == 0) workers_cnt = 1;
+  if (workers_cnt > HTR_WORKERS_MAX) workers_cnt = HTR_WORKERS_MAX;
+  if (rounds_cnt  == 0) rounds_cnt  = 1;
+
+  cap2hc_set_threads (workers_cnt);
+
+  htr_bench_t bench;
+
+  memset (&bench, 0, sizeof (htr_bench_t));
+
+  pthread_mutex_init (&bench.mux, NULL);
+
+  // the first round reads from disk, the others mostly from the page cache
+
+  u64 wall_ns = 0;
+
+  for (u32 round = 0; round < rounds_cnt; round++)
+  {
+    htr_src_t src;
+
+    htr_src_init (&src, argv + optind, argc - optind, NULL, false);
+
+    const u64 start_ns = htr_bench_now_ns ();
+
+    htr_pool_run (workers_cnt, &src, htr_bench_extract, htr_bench_commit, &bench);
+
+    wall_ns += htr_bench_now_ns () - start_ns;
+
+    htr_src_destory (&src);
+  }
+
+  if (bench.oom == true) fprintf (stderr, "htr_bench: %s, some samples are missing\n", MSG_ENOMEM);
+
+  u64 bytes = 0;
+
+  for (u64 i = 0; i < bench.samples_cnt; i++) bytes += bench.samples[i].size;
+
+  const double wall_sec = (double) wall_ns / 1e9;
+
+  printf ("\n[htr_bench]: %" PRIu64 " files, %u rounds, %u workers\n", bench.samples_cnt, rounds_cnt, workers_cnt);
+
+  printf ("[htr_bench]: %.3f s, %.1f files/s, %.2f MB/s, %" PRIu64 " failed\n", wall_sec,
+    (wall_sec > 0) ? (double) bench.samples_cnt / wall_sec : 0.0,
+    (wall_sec > 0) ? (double) bytes / (1024 * 1024) / wall_sec : 0.0,
+    bench.failed_cnt);
+
+  if (bench.samples_cnt > 0) htr_bench_report (&bench);
+
+  jmfree (bench.samples);
+
+  pthread_mutex_destroy (&bench.mux);
+
+  return (bench.failed_cnt == 0) ? 0 : EXIT_FAILURE;
+}
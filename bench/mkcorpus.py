@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+#
+# synthetic encrypted corpus for htr_bench
+#
+# every format hash_extr supports, at several sizes, a few files each. the
+# files are only as real as the converters need: headers, salts and
+# verifiers are well formed, the "encrypted" payloads are random bytes. the
+# same seed always gives the same corpus, byte for byte
+#
+#   mkcorpus.py [-s 4k,256k,4m] [-n 4] [--seed 1] outdir
+#
+# writes outdir/<format>/<size>/<n>.<ext>
+
+import argparse
+import base64
+import os
+import random
+import struct
+import zlib
+
+rng = random.Random ()
+
+def rb (n):
+    return rng.getrandbits (8 * n).to_bytes (n, 'little') if n > 0 else b''
+
+def b64 (b):
+    return base64.b64encode (b).decode ()
+
+#
+# wpa, a pcap (or pcapng) with a beacon and a 4-way handshake, data frames up to size
+#
+
+def wpa_mac (i):
+    return bytes ([0x02, 0, 0, 0, (i >> 8) & 0xff, i & 0xff])
+
+def wpa_beacon (bssid, ssid):
+    hdr  = struct.pack ('<HH', 0x0080, 0) + b'\xff' * 6 + bssid + bssid + struct.pack ('<H', 0)
+    body = struct.pack ('<QHH', 0, 100, 0x431) + bytes ([0, len (ssid)]) + ssid + bytes ([1, 1, 0x82])
+    return hdr + body
+
+def wpa_eapol (ap, sta, msg, rc, nonce, data=b''):
+    ki, fc, a1, a2 = {
+        1: (0x008a, 0x0208, sta, ap),
+        2: (0x010a, 0x0108, ap, sta),
+        3: (0x13ca, 0x0208, sta, ap),
+        4: (0x030a, 0x0108, ap, sta),
+    }[msg]
+    hdr  = struct.pack ('<HH', fc, 0) + a1 + a2 + ap + struct.pack ('<H', 0)
+    llc  = bytes ([0xaa, 0xaa, 3, 0, 0, 0]) + struct.pack ('>H', 0x888e)
+    mic  = rb (16) if msg != 1 else b'\0' * 16
+    auth = struct.pack ('>BBHBHHQ', 2, 3, 95 + len (data), 2, ki, 16, rc) + nonce + b'\0' * 32 + mic + struct.pack ('>H', len (data)) + data
+    return hdr + llc + auth
+
+def wpa_data (ap, sta, n):
+    return struct.pack ('<HH', 0x4208, 0) + sta + ap + ap + struct.pack ('<H', 0) + rb (n)
+
+def wpa_pkts (size, i, overhead):
+    ap, sta = wpa_mac (i), wpa_mac (0x1000 + i)
+    anonce  = rb (32)
+    pkts = [
+        wpa_beacon (ap, b'bench%d' % i),
+        wpa_eapol (ap, sta, 1, 1, anonce),
+        wpa_eapol (ap, sta, 2, 1, rb (32), rb (22)),
+        wpa_eapol (ap, sta, 3, 2, anonce, rb (56)),
+        wpa_eapol (ap, sta, 4, 2, rb (32)),
+    ]
+    total = sum (len (p) + overhead for p in pkts)
+    while total < size:
+        pkts.append (wpa_data (ap, sta, min (1500, max (1, size - total - 40))))
+        total += len (pkts[-1]) + overhead
+    return pkts
+
+def mk_wpa (size, i):
+    out = bytearray (struct.pack ('<IHHIIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 105))
+    for p in wpa_pkts (size - len (out), i, 16):
+        out.extend (struct.pack ('<IIII', 1600000000, 0, len (p), len (p)) + p)
+    return bytes (out)
+
+def pcapng_block (btype, body):
+    body += b'\0' * (-len (body) % 4)
+    return struct.pack ('<II', btype, 12 + len (body)) + body + struct.pack ('<I', 12 + len (body))
+
+def mk_wpa_pcapng (size, i):
+    out = bytearray (pcapng_block (0x0a0d0d0a, struct.pack ('<IHHq', 0x1a2b3c4d, 1, 0, -1)))
+    # nanosecond timestamps, if_tsresol 9
+    out.extend (pcapng_block (1, struct.pack ('<HHI', 105, 0, 65535) + struct.pack ('<HHB3xHH', 9, 1, 9, 0, 0)))
+    ts = 1600000000 * 1000000000
+    for p in wpa_pkts (size - len (out), i, 32):
+        out.extend (pcapng_block (6, struct.pack ('<IIIII', 0, ts >> 32, ts & 0xffffffff, len (p), len (p)) + p))
+    return bytes (out)
+
+#
+# office, an ole2 compound file with EncryptionInfo and EncryptedPackage
+#
+
+CFB_ENDC = 0xfffffffe
+CFB_FREE = 0xffffffff
+CFB_FATS = 0xfffffffd
+CFB_DIFS = 0xfffffffc
+CFB_NOS  = 0xffffffff
+
+def cfb (streams):
+    ssz, per = 512, 128
+    chains, ents = [], []
+    mini, minifat = b'', []
+    for name, data in streams:
+        if len (data) < 4096:
+            n = (len (data) + 63) // 64
+            start = len (mini) // 64 if data else CFB_ENDC
+            for k in range (n):
+                minifat.append (len (minifat) + 1 if k < n - 1 else CFB_ENDC)
+            mini += data + b'\0' * (n * 64 - len (data))
+            ents.append ((name, len (data), 'mini', start))
+        else:
+            chains.append ([data[k:k + ssz] for k in range (0, len (data), ssz)])
+            ents.append ((name, len (data), 'reg', len (chains) - 1))
+    split = lambda b: [b[k:k + ssz] for k in range (0, len (b), ssz)]
+    ms_idx = len (chains); chains.append (split (mini))
+    mf = b''.join (struct.pack ('<I', x) for x in minifat)
+    mf += struct.pack ('<I', CFB_FREE) * ((-len (mf) // 4) % per)
+    mf_idx = len (chains); chains.append (split (mf))
+    # red-black tree of the entries, a balanced one will do
+    order = sorted (range (len (ents)), key=lambda k: (len (ents[k][0]), ents[k][0].upper ()))
+    left, right = {}, {}
+    def build (lo, hi):
+        if lo >= hi:
+            return CFB_NOS
+        mid = (lo + hi) // 2
+        left[order[mid]] = build (lo, mid)
+        right[order[mid]] = build (mid + 1, hi)
+        return order[mid] + 1
+    root_child = build (0, len (order))
+    ndir = ((1 + len (ents)) * 128 + ssz - 1) // ssz
+    n = sum (len (c) for c in chains) + ndir
+    sid, fat, starts = 0, {}, []
+    for c in chains:
+        ids = list (range (sid, sid + len (c))); sid += len (c)
+        for a, b in zip (ids, ids[1:]):
+            fat[a] = b
+        if ids:
+            fat[ids[-1]] = CFB_ENDC
+        starts.append (ids[0] if ids else CFB_ENDC)
+    dirs = list (range (sid, sid + ndir))
+    for a, b in zip (dirs, dirs[1:]):
+        fat[a] = b
+    fat[dirs[-1]] = CFB_ENDC
+    nfat, ndif = 1, 0
+    while True:
+        nfat2 = (n + nfat + ndif + per - 1) // per
+        ndif2 = max (0, (nfat2 - 109 + per - 2) // (per - 1))
+        if (nfat2, ndif2) == (nfat, ndif):
+            break
+        nfat, ndif = nfat2, ndif2
+    fatsec = list (range (n, n + nfat))
+    difsec = list (range (n + nfat, n + nfat + ndif))
+    for s in fatsec:
+        fat[s] = CFB_FATS
+    for s in difsec:
+        fat[s] = CFB_DIFS
+    def dirent (name, typ, start, size, l=CFB_NOS, r=CFB_NOS, child=CFB_NOS):
+        nm = name.encode ('utf-16-le') + b'\0\0'
+        return nm + b'\0' * (64 - len (nm)) + struct.pack ('<HBBIII', len (nm), typ, 1, l, r, child) + b'\0' * 36 + struct.pack ('<IQ', start, size)
+    d = dirent ('Root Entry', 5, starts[ms_idx], len (mini), child=root_child)
+    for k, (name, size, kind, st) in enumerate (ents):
+        d += dirent (name, 2, st if kind == 'mini' else starts[st], size, left.get (k, CFB_NOS), right.get (k, CFB_NOS))
+    d += (b'\0' * 64 + struct.pack ('<HBBIII', 0, 0, 0, CFB_NOS, CFB_NOS, CFB_NOS) + b'\0' * 48) * ((-len (d) // 128) % (ssz // 128))
+    body = b''.join (b + b'\0' * (ssz - len (b)) for c in chains for b in c) + d
+    fatarr = [fat.get (k, CFB_FREE) for k in range (nfat * per)]
+    body += b''.join (struct.pack ('<I', x) for x in fatarr)
+    rest = fatsec[109:]
+    for k in range (ndif):
+        chunk = rest[k * (per - 1):(k + 1) * (per - 1)]
+        chunk += [CFB_FREE] * (per - 1 - len (chunk))
+        body += b''.join (struct.pack ('<I', x) for x in chunk) + struct.pack ('<I', difsec[k + 1] if k + 1 < ndif else CFB_ENDC)
+    hdr  = b'\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1' + b'\0' * 16 + struct.pack ('<HHHHH', 0x3e, 3, 0xfffe, 9, 6) + b'\0' * 6
+    hdr += struct.pack ('<IIIIIIIII', 0, nfat, dirs[0], 0, 4096, starts[mf_idx] if minifat else CFB_ENDC, len (mf) // ssz if minifat else 0, difsec[0] if ndif else CFB_ENDC, ndif)
+    hdr += b''.join (struct.pack ('<I', x) for x in fatsec[:109] + [CFB_FREE] * (109 - len (fatsec[:109])))
+    return hdr + body
+
+def office_standard ():
+    csp = 'Microsoft Enhanced RSA and AES Cryptographic Provider\0'.encode ('utf-16-le')
+    hdr = struct.pack ('<IIIIIIII', 0x24, 0, 0x660e, 0x8004, 128, 0x18, 0, 0) + csp
+    ver = struct.pack ('<I', 16) + rb (16) + rb (16) + struct.pack ('<I', 20) + rb (32)
+    return struct.pack ('<HHI', 3, 2, 0x24) + struct.pack ('<I', len (hdr)) + hdr + ver
+
+def office_agile (alg, bits):
+    hs = 64 if alg == 'SHA512' else 20
+    ek = ('<p:encryptedKey spinCount="100000" saltSize="16" blockSize="16" keyBits="%d" hashSize="%d" cipherAlgorithm="AES" '
+          'cipherChaining="ChainingModeCBC" hashAlgorithm="%s" saltValue="%s" encryptedVerifierHashInput="%s" '
+          'encryptedVerifierHashValue="%s" encryptedKeyValue="%s"/>') % (bits, hs, alg, b64 (rb (16)), b64 (rb (16)), b64 (rb (64 if alg == 'SHA512' else 32)), b64 (rb (bits // 8)))
+    x = ('<?xml version="1.0" encoding="UTF-8" standalone="yes"?>\r\n'
+         '<encryption xmlns="http://schemas.microsoft.com/office/2006/encryption" '
+         'xmlns:p="http://schemas.microsoft.com/office/2006/keyEncryptor/password">'
+         '<keyData saltSize="16" blockSize="16" keyBits="%d" hashSize="%d" cipherAlgorithm="AES" cipherChaining="ChainingModeCBC" hashAlgorithm="%s" saltValue="%s"/>'
+         '<dataIntegrity encryptedHmacKey="%s" encryptedHmacValue="%s"/>'
+         '<keyEncryptors><keyEncryptor uri="http://schemas.microsoft.com/office/2006/keyEncryptor/password">%s</keyEncryptor></keyEncryptors>'
+         '</encryption>') % (bits, hs, alg, b64 (rb (16)), b64 (rb (64)), b64 (rb (64)), ek)
+    return struct.pack ('<HHI', 4, 4, 0x40) + x.encode ()
+
+def mk_office (info):
+    def mk (size, i):
+        return cfb ([('EncryptionInfo', info ()), ('\x06DataSpaces', b''), ('EncryptedPackage', struct.pack ('<Q', size) + rb (size))])
+    return mk
+
+#
+# pdf, standard security handler revisions 2 to 6, a binary stream up to size
+#
+
+def pdf_hex (b):
+    return b'<' + b.hex ().encode () + b'>'
+
+def mk_pdf (rev):
+    def mk (size, i):
+        if rev == 2:
+            enc = b'<< /Filter /Standard /V 1 /R 2 /O ' + pdf_hex (rb (32)) + b' /U ' + pdf_hex (rb (32)) + b' /P -44 >>'
+        elif rev == 3:
+            enc = b'<< /Filter /Standard /V 2 /R 3 /Length 128 /O ' + pdf_hex (rb (32)) + b' /U ' + pdf_hex (rb (32)) + b' /P -3904 >>'
+        elif rev == 4:
+            enc = (b'<< /Filter /Standard /V 4 /R 4 /Length 128 /CF << /StdCF << /AuthEvent /DocOpen /CFM /AESV2 /Length 16 >> >> '
+                   b'/StmF /StdCF /StrF /StdCF /O ' + pdf_hex (rb (32)) + b' /U ' + pdf_hex (rb (32)) + b' /P -1028 >>')
+        else:
+            enc = (b'<< /Filter /Standard /V 5 /R %d /Length 256 /CF << /StdCF << /AuthEvent /DocOpen /CFM /AESV3 /Length 32 >> >> '
+                   b'/StmF /StdCF /StrF /StdCF /O ' % rev + pdf_hex (rb (48)) + b' /U ' + pdf_hex (rb (48)) +
+                   b' /OE ' + pdf_hex (rb (32)) + b' /UE ' + pdf_hex (rb (32)) + b' /P -1028 /Perms ' + pdf_hex (rb (16)) + b' >>')
+        body = rb (size)
+        objs = [
+            b'<< /Type /Catalog /Pages 2 0 R >>',
+            b'<< /Type /Pages /Kids [] /Count 0 >>',
+            enc,
+            b'<< /Length %d >>\nstream\n' % len (body) + body + b'\nendstream',
+        ]
+        parts = [b'%PDF-' + { 2: b'1.4', 3: b'1.5', 4: b'1.6' }.get (rev, b'1.7') + b'\n%\xe2\xe3\xcf\xd3\n']
+        offs = []
+        for k, o in enumerate (objs):
+            offs.append (sum (map (len, parts)))
+            parts.append (b'%d 0 obj\n' % (k + 1) + o + b'\nendobj\n')
+        xref = sum (map (len, parts))
+        t = b'xref\n0 %d\n0000000000 65535 f \n' % (len (objs) + 1)
+        t += b''.join (b'%010d 00000 n \n' % o for o in offs)
+        idv = pdf_hex (rb (16))
+        t += b'trailer\n<< /Size %d /Root 1 0 R /Encrypt 3 0 R /ID [ %s %s ] >>\nstartxref\n%d\n%%%%EOF\n' % (len (objs) + 1, idv, idv, xref)
+        return b''.join (parts) + t
+    return mk
+
+#
+# 7z, a plain header, the payload in an unencrypted folder ahead of an AES +
+# LZMA2 one, 7z2hashcat takes at most a few hundred KB of encrypted stream
+#
+
+SZIP_ENC_MAX = 64 * 1024
+
+def szip_num (v):
+    for k in range (9):
+        if k == 8:
+            return b'\xff' + struct.pack ('<Q', v)
+        if v < (1 << (7 * (k + 1))):
+            first = ((0xff << (8 - k)) & 0xff) | (v >> (8 * k))
+            return bytes ([first]) + v.to_bytes (8, 'little')[:k]
+
+def szip_coder (cid, props):
+    return bytes ([0x20 | len (cid)]) + cid + szip_num (len (props)) + props
+
+def mk_7z (size, i):
+    enc   = rb (max (16, min (size, SZIP_ENC_MAX) // 16 * 16))
+    plain = rb (max (0, size - len (enc)))
+    aes   = szip_coder (b'\x06\xf1\x07\x01', bytes ([19 | 0x40, 0x0f]) + rb (16))
+    lzma2 = szip_coder (b'\x21', b'\x18')
+    folders = [szip_num (1) + lzma2, szip_num (2) + aes + lzma2 + szip_num (1) + szip_num (0)]
+    usizes  = [len (plain), len (enc), len (enc) - 8]
+    packs   = [len (plain), len (enc)] if plain else [len (enc)]
+    if not plain:
+        folders, usizes = folders[1:], usizes[1:]
+    st  = b'\x06' + szip_num (0) + szip_num (len (packs)) + b'\x09' + b''.join (szip_num (n) for n in packs) + b'\x00'
+    st += b'\x07\x0b' + szip_num (len (folders)) + b'\x00' + b''.join (folders)
+    st += b'\x0c' + b''.join (szip_num (n) for n in usizes)
+    st += b'\x0a\x01' + b''.join (struct.pack ('<I', rng.getrandbits (32)) for f in folders) + b'\x00\x00'
+    names = b'\x00' + b''.join (n.encode ('utf-16-le') + b'\0\0' for n in ['plain.bin', 'bench.bin'][-len (folders):])
+    files = szip_num (len (folders)) + b'\x11' + szip_num (len (names)) + names + b'\x00'
+    hdr = b'\x01\x04' + st + b'\x05' + files + b'\x00'
+    sh  = struct.pack ('<QQI', len (plain) + len (enc), len (hdr), zlib.crc32 (hdr))
+    return b'7z\xbc\xaf\x27\x1c\x00\x04' + struct.pack ('<I', zlib.crc32 (sh)) + sh + plain + enc + hdr
+
+#
+# rar, 3.x and 5.0, with encrypted headers (-hp) or an encrypted file
+#
+
+def rar3_block (typ, flags, body):
+    hdr = bytes ([typ]) + struct.pack ('<HH', flags, 7 + len (body)) + body
+    return struct.pack ('<H', zlib.crc32 (hdr) & 0xffff) + hdr
+
+def mk_rar3_hp (size, i):
+    out = b'Rar!\x1a\x07\x00' + rar3_block (0x73, 0x0080, b'\0' * 6)
+    return out + rb (max (24, size - len (out)))
+
+def mk_rar3 (size, i):
+    data = rb (max (16, size - size % 16))
+    name = b'bench.bin'
+    body = struct.pack ('<IIBIIBBHI', len (data), len (data) - 8, 2, rng.getrandbits (32), 0, 0x1d, 0x33, len (name), 0x20) + name + rb (8)
+    out  = b'Rar!\x1a\x07\x00' + rar3_block (0x73, 0, b'\0' * 6)
+    out += rar3_block (0x74, 0x8000 | 0x0400 | 0x0004, body) + data
+    return out + rar3_block (0x7b, 0x4000, b'')
+
+def rar5_vint (v):
+    out = b''
+    while True:
+        b = v & 0x7f; v >>= 7
+        if v == 0:
+            return out + bytes ([b])
+        out += bytes ([b | 0x80])
+
+def rar5_block (typ, flags, body, extra=b'', data_size=None):
+    fl = flags | (0x01 if extra else 0) | (0x02 if data_size is not None else 0)
+    h  = rar5_vint (typ) + rar5_vint (fl)
+    if extra:
+        h += rar5_vint (len (extra))
+    if data_size is not None:
+        h += rar5_vint (data_size)
+    h += body + extra
+    h = rar5_vint (len (h)) + h
+    return struct.pack ('<I', zlib.crc32 (h)) + h
+
+def mk_rar5_hp (size, i):
+    crypt = rar5_vint (0) + rar5_vint (1) + bytes ([15]) + rb (16) + rb (8) + rb (4)
+    out = b'Rar!\x1a\x07\x01\x00' + rar5_block (4, 0, crypt)
+    return out + rb (max (32, size - len (out)))
+
+def mk_rar5 (size, i):
+    data  = rb (max (16, size - size % 16))
+    name  = b'bench.bin'
+    crypt = rar5_vint (1) + rar5_vint (0) + rar5_vint (1) + bytes ([15]) + rb (16) + rb (16) + rb (8) + rb (4)
+    extra = rar5_vint (len (crypt)) + crypt
+    body  = rar5_vint (0) + rar5_vint (len (data)) + rar5_vint (0x20) + rar5_vint (0) + rar5_vint (0) + rar5_vint (len (name)) + name
+    out  = b'Rar!\x1a\x07\x01\x00' + rar5_block (1, 0, rar5_vint (0))
+    out += rar5_block (2, 0, body, extra, len (data)) + data
+    return out + rar5_block (5, 0, rar5_vint (0))
+
+#
+# zip, traditional pkware encryption and winzip aes, one stored entry
+#
+
+def zip_archive (version, flags, method, crc, data, usize, extra=b''):
+    name = b'bench.bin'
+    lh = struct.pack ('<IHHHHHIIIHH', 0x04034b50, version, flags, method, 0, 0, crc, len (data), usize, len (name), len (extra)) + name + extra
+    cd = struct.pack ('<IHHHHHHIIIHHHHHII', 0x02014b50, version, version, flags, method, 0, 0, crc, len (data), usize, len (name), len (extra), 0, 0, 0, 0, 0) + name + extra
+    end = struct.pack ('<IHHHHIIH', 0x06054b50, 0, 0, 1, 1, len (cd), len (lh) + len (data), 0)
+    return lh + data + cd + end
+
+def mk_zipcrypto (size, i):
+    plain = rb (max (16, size))
+    crc   = zlib.crc32 (plain)
+    head  = rb (11) + bytes ([crc >> 24])
+    return zip_archive (20, 1, 0, crc, head + rb (len (plain)), len (plain))
+
+def mk_zipaes (size, i):
+    n = max (16, size)
+    extra = struct.pack ('<HHHH', 0x9901, 7, 2, 0x4541) + bytes ([3]) + struct.pack ('<H', 0)
+    data  = rb (16) + rb (2) + rb (n) + rb (10)
+    return zip_archive (51, 1, 99, 0, data, n, extra)
+
+FORMATS = [
+    ('wpa',        'pcap',   mk_wpa),
+    ('wpa-pcapng', 'pcapng', mk_wpa_pcapng),
+    ('office2007', 'docx',   mk_office (office_standard)),
+    ('office2010', 'docx',   mk_office (lambda: office_agile ('SHA1', 128))),
+    ('office2013', 'docx',   mk_office (lambda: office_agile ('SHA512', 256))),
+    ('pdf-r2',     'pdf',    mk_pdf (2)),
+    ('pdf-r3',     'pdf',    mk_pdf (3)),
+    ('pdf-r5',     'pdf',    mk_pdf (5)),
+    ('pdf-r6',     'pdf',    mk_pdf (6)),
+    ('7z',         '7z',     mk_7z),
+    ('rar3-hp',    'rar',    mk_rar3_hp),
+    ('rar3',       'rar',    mk_rar3),
+    ('rar5-hp',    'rar',    mk_rar5_hp),
+    ('rar5',       'rar',    mk_rar5),
+    ('zipcrypto',  'zip',    mk_zipcrypto),
+    ('zipaes',     'zip',    mk_zipaes),
+]
+
+def parse_size (s):
+    s = s.strip ().lower ()
+    mul = { 'k': 1 << 10, 'm': 1 << 20, 'g': 1 << 30 }.get (s[-1:], 1)
+    return int (s[:-1] if s[-1:] in 'kmg' else s) * mul
+
+def main ():
+    ap = argparse.ArgumentParser (description='synthetic encrypted corpus for htr_bench')
+    ap.add_argument ('-s', '--sizes', default='4k,256k,4m', help='payload sizes, comma separated (default 4k,256k,4m)')
+    ap.add_argument ('-n', '--count', type=int, default=4, help='files per format and size (default 4)')
+    ap.add_argument ('-f', '--formats', default=None, help='only these formats, comma separated')
+    ap.add_argument ('--seed', type=int, default=1)
+    ap.add_argument ('outdir')
+    args = ap.parse_args ()
+
+    only = set (args.formats.split (',')) if args.formats else None
+
+    for size_str in args.sizes.split (','):
+        size = parse_size (size_str)
+        for name, ext, mk in FORMATS:
+            if only is not None and name not in only:
+                continue
+            # each (format, size) has a stream of its own, adding one leaves the others as they were
+            rng.seed ('%d/%s/%d' % (args.seed, name, size))
+            dpath = os.path.join (args.outdir, name, size_str.strip ())
+            os.makedirs (dpath, exist_ok=True)
+            for i in range (args.count):
+                with open (os.path.join (dpath, '%d.%s' % (i, ext)), 'wb') as fp:
+                    fp.write (mk (size, i))
+
+if __name__ == '__main__':
+    main ()
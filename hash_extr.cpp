@@ -10,6 +10,10 @@
 #include "common.h"
 #include "hccvt.h"
 #include "inicfg.h"
+#include "htrpool.h"
+#include "htrcache.h"
+#include "htrdedup.h"
+#include "htrout.h"
 
 /**
  * Name........: ini_infor.cpp
@@ -26,47 +30,39 @@ typedef enum htr_op_mode
   HTR_OP_MODE_CONFIG = 10,
 } htr_op_mode_t;
 
+typedef enum htr_extract_status
+{
+  HTR_EXTRACT_OK = 0,
+  HTR_EXTRACT_UNKNOWN_FTYPE = 1,
+  HTR_EXTRACT_CVT_FAILED = 2,
+} htr_extract_status_t;
+
 
 static void print_usage ()
 {
   /* printf ("Usage: hash_extr -t task-type -f orig-file -o hash-file --hash-type\n"); */
 
-  printf ("Usage: hash_extr -s op file...[MAX:256] [options] \n\n" "support: wpa office pdf szip rar pkzip \n " "\n" "-s select operation: \n " "\t0      [default mode]extract hash, print to console\n" "\t1      [single mode]extract from single file, then rename[-o]\n"
+  printf ("Usage: hash_extr -s op [file|dir|-]... [options] \n\n" "support: wpa office pdf szip rar pkzip \n " "\n" "-s select operation: \n " "\t0      [default mode]extract hash, print to console\n" "\t1      [single mode]extract from single file, then rename[-o]\n"
           // "1 extract tbc_files to [hchash | ihchash] file"
           // "1 extract single type[same version] of files \n "
           // "2 extract mixed types of files \n "
           // "5 category hchash file by hash_mode [one hash one line] \n "
           // "6 category ihchash file by hash_mode [full hash info] \n "
-          "\t10     [config mode]category by config file\n" "");
+          "\t10     [config mode]category by config file\n" "\n" "-j N   extract with N parallel workers, large captures are split across them [default: 1, MAX:%d]\n" "-f file read more paths from file, - for stdin [one per line]\n" "-0     paths in -f file and on stdin are NUL-delimited\n" "\n" "directories are walked recursively, - reads paths from stdin\n" "-C file keep extracted hashes in file, unchanged and duplicate files are served from it\n" "-W N   wpa: only the N best handshakes of every (essid, ap, sta), with nonce error correction hints [default: 0, all, MAX:%d]\n" "", HTR_WORKERS_MAX, CAP2HC_BEST_MAX);
 }
 
 static int rfile_init (htr_ctx_t * htr_ctx)
 {
   rfile_info_ctx_t *rfile_info_ctx = htr_ctx->rfile_info_ctx;
 
-  rfile_info_ctx->hash_ctx = (hash_ctx_t *) jmmalloc (sizeof (hash_ctx_t));
-
-  rfile_info_ctx->file_encryption = FILE_ENCRYPTION_UNKNOWN;
-
-  memset (rfile_info_ctx->tmp_fpath, 0, sizeof (rfile_info_ctx->tmp_fpath));
-  memset (rfile_info_ctx->type, 0, sizeof (rfile_info_ctx->type));
-  memset (rfile_info_ctx->version, 0, sizeof (rfile_info_ctx->version));
-  memset (rfile_info_ctx->path, 0, sizeof (rfile_info_ctx->path));
-
-  strcpy (rfile_info_ctx->tmp_fpath, "extract_hchash_tmp.txt");
-
-  hash_ctx_init (rfile_info_ctx->hash_ctx);
-
-  return 1;
+  return rfile_info_ctx_init (rfile_info_ctx);
 }
 
 static void rfile_destory (htr_ctx_t * htr_ctx)
 {
   rfile_info_ctx_t *rfile_info_ctx = htr_ctx->rfile_info_ctx;
 
-  jmfree (rfile_info_ctx->hash_ctx);
-
-  hash_ctx_destory (rfile_info_ctx->hash_ctx);
+  rfile_info_ctx_destory (rfile_info_ctx);
 }
 
 static int htr_user_options_init (htr_ctx_t * htr_ctx)
@@ -77,8 +73,17 @@ static int htr_user_options_init (htr_ctx_t * htr_ctx)
 
   user_options->config_fpath = NULL;
 
+  user_options->workers_cnt = 1;
+
+  user_options->cache_fpath = NULL;
+
+  user_options->wpa_best_cnt = 0;
+
   user_options->tbc_fpaths_cnt = 0;
-  user_options->tbc_fpaths = (char **) jmcalloc (256, sizeof (char *));
+  user_options->tbc_fpaths = NULL;
+
+  user_options->manifest_fpath = NULL;
+  user_options->null_delim = false;
 
   return 1;
 }
@@ -87,7 +92,7 @@ static void htr_user_options_destory (htr_ctx_t * htr_ctx)
 {
   htr_user_options_t *user_options = htr_ctx->user_options;
 
-  jmfree (user_options->tbc_fpaths);
+  user_options->tbc_fpaths = NULL;
 }
 
 static int htr_init (htr_ctx_t * htr_ctx)
@@ -110,13 +115,72 @@ static int htr_session_init (htr_ctx_t * htr_ctx)
   htr_ctx->log_fpath = "hash_extr.log";
   htr_ctx->valid_hashes_cnt = 0;
 
+  // a large capture may use the workers that have nothing else to do
+
+  cap2hc_set_threads (htr_ctx->user_options->workers_cnt);
+
+  cap2hc_set_best (htr_ctx->user_options->wpa_best_cnt);
+
   rfile_init (htr_ctx);
 
+  htr_user_options_t *user_options = htr_ctx->user_options;
+
+  htr_ctx->src = (htr_src_t *) jmmalloc (sizeof (htr_src_t));
+
+  if (htr_ctx->src == NULL)
+  {
+    exit (EXIT_FAILURE);
+  }
+
+  htr_src_init (htr_ctx->src, user_options->tbc_fpaths, user_options->tbc_fpaths_cnt, user_options->manifest_fpath, user_options->null_delim);
+
+  htr_ctx->dedup = (htr_dedup_t *) jmmalloc (sizeof (htr_dedup_t));
+
+  if (htr_ctx->dedup == NULL)
+  {
+    exit (EXIT_FAILURE);
+  }
+
+  htr_dedup_init (htr_ctx->dedup);
+
+  htr_ctx->cache = NULL;
+
+  if (user_options->cache_fpath != NULL)
+  {
+    htr_ctx->cache = (htr_cache_t *) jmmalloc (sizeof (htr_cache_t));
+
+    if (htr_ctx->cache == NULL || htr_cache_open (htr_ctx->cache, user_options->cache_fpath) == -1)
+    {
+      exit (EXIT_FAILURE);
+    }
+  }
+
   return 1;
 }
 
 static int htr_session_destory (htr_ctx_t * htr_ctx)
 {
+  htr_dedup_destory (htr_ctx->dedup);
+
+  jmfree (htr_ctx->dedup);
+
+  htr_ctx->dedup = NULL;
+
+  if (htr_ctx->cache != NULL)
+  {
+    htr_cache_close (htr_ctx->cache);
+
+    jmfree (htr_ctx->cache);
+
+    htr_ctx->cache = NULL;
+  }
+
+  htr_src_destory (htr_ctx->src);
+
+  jmfree (htr_ctx->src);
+
+  htr_ctx->src = NULL;
+
   rfile_destory (htr_ctx);
 
   return 1;
@@ -134,6 +198,11 @@ static int user_options_get_opt (htr_ctx_t * htr_ctx, int argc, char **argv)
     {"selectop", required_argument, 0, 's'},
     {"configfile", required_argument, 0, 'c'},
     {"outputfile", required_argument, 0, 'o'},
+    {"jobs", required_argument, 0, 'j'},
+    {"cache", required_argument, 0, 'C'},
+    {"wpa-best", required_argument, 0, 'W'},
+    {"files-from", required_argument, 0, 'f'},
+    {"null", no_argument, 0, '0'},
     {"help", no_argument, 0, 'h'},
     // {"hashmode", required_argument, 0, 'm'},
     // {"unftdhashfile", required_argument, 0, 'u'},
@@ -143,7 +212,7 @@ static int user_options_get_opt (htr_ctx_t * htr_ctx, int argc, char **argv)
   };
 
 
-  while ((c = getopt_long (argc, argv, "s:c:o:h", long_options, &option_index)) != -1)
+  while ((c = getopt_long (argc, argv, "s:c:o:j:C:W:f:0h", long_options, &option_index)) != -1)
   {
     switch (c)
     {
@@ -156,12 +225,29 @@ static int user_options_get_opt (htr_ctx_t * htr_ctx, int argc, char **argv)
     case 'o':
       user_options->out_fpath = optarg;
       break;
+    case 'j':
+      user_options->workers_cnt = atoi (optarg);
+      break;
+    case 'C':
+      user_options->cache_fpath = optarg;
+      break;
+    case 'W':
+      user_options->wpa_best_cnt = atoi (optarg);
+      break;
+    case 'f':
+      user_options->manifest_fpath = optarg;
+      break;
+    case '0':
+      user_options->null_delim = true;
+      break;
     case 'h':
       user_options->usage = true;
       break;
     default:
-      user_options->usage = true;
-      return EXIT_FAILURE;
+      // nothing runs on half parsed options
+      fprintf (stderr, "see --help\n");
+
+      exit (EXIT_FAILURE);
     }
   }
 
@@ -170,32 +256,35 @@ static int user_options_get_opt (htr_ctx_t * htr_ctx, int argc, char **argv)
     print_usage();
   }
 
-  for (option_index = optind; option_index < argc; option_index++)
-  {
-    // is path valid
+  // checked while they are enumerated, missing ones are reported and skipped
 
-    if (is_file_exist (argv[option_index]) == -1)
-    {
-      fprintf (stderr, "%s: file does not exist, see --help\n", argv[option_index]);
+  user_options->tbc_fpaths     = argv + optind;
+  user_options->tbc_fpaths_cnt = argc - optind;
 
-      exit (EXIT_FAILURE);
-    }
+  // printf ("user_options %d \n", user_options->op_mode);
 
-    user_options->tbc_fpaths[user_options->tbc_fpaths_cnt++] = argv[option_index];
+  if (user_options->op_mode != 0 && user_options->op_mode != 1 && user_options->op_mode != 10)
+  {
+    fprintf (stderr, "see --help\n");
 
-    // printf ("tbc_paths: %s\n", argv[option_index]);
+    exit (EXIT_FAILURE);
   }
 
-  // printf ("user_options %d \n", user_options->op_mode);
+  if (user_options->workers_cnt < 1 || user_options->workers_cnt > HTR_WORKERS_MAX)
+  {
+    fprintf (stderr, "-j must be between 1 and %d, see --help\n", HTR_WORKERS_MAX);
 
-  if (user_options->op_mode != 0 && user_options->op_mode != 1 && user_options->op_mode != 10)
+    exit (EXIT_FAILURE);
+  }
+
+  if (user_options->wpa_best_cnt > CAP2HC_BEST_MAX)
   {
-    fprintf (stderr, "see --help\n");
+    fprintf (stderr, "-W must be between 0 and %d, see --help\n", CAP2HC_BEST_MAX);
 
     exit (EXIT_FAILURE);
   }
 
-  if (user_options->tbc_fpaths_cnt == 0)
+  if (user_options->tbc_fpaths_cnt == 0 && user_options->manifest_fpath == NULL)
   {
     fprintf (stderr, "please specify at least one tbc file, see --help\n");
 
@@ -215,173 +304,238 @@ static int user_options_get_opt (htr_ctx_t * htr_ctx, int argc, char **argv)
   return 1;
 }
 
-static int extract_hash_by_config (htr_ctx_t * htr_ctx)
+// runs in a worker, anything shared must stay out of here, the cache locks itself
+
+static int extract_rfile (htr_ctx_t * htr_ctx, rfile_info_ctx_t *rfile_info_ctx)
 {
-  htr_user_options *user_options = htr_ctx->user_options;
+  htr_cache_t *cache = htr_ctx->cache;
 
-  rfile_info_ctx_t *rfile_info_ctx = htr_ctx->rfile_info_ctx;
+  // get vague mode by checking file header
 
-  hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+  if (get_rw_rfile_ftype (rfile_info_ctx) == -1) return HTR_EXTRACT_UNKNOWN_FTYPE;
 
-  // config mode logging
+  // unchanged files and copies of known ones are not converted again
+
+  if ((cache != NULL) && (htr_cache_lookup (cache, rfile_info_ctx) == 1))
+  {
+    jmprobe_close (&rfile_info_ctx->probe);
+
+    // a copy of a cached file is stored under its own (dev, inode, size, mtime) for next time
+
+    htr_cache_store (cache, rfile_info_ctx);
+
+    return HTR_EXTRACT_OK;
+  }
+
+  // nor are copies of a file seen earlier in this run
+
+  u32 dedup_idx = 0;
 
-  FILE *log_fp = fopen (htr_ctx->log_fpath, "a");
+  int rc = HTR_EXTRACT_OK;
 
-  if (log_fp == NULL)
+  const htr_dedup_role_t role = htr_dedup_claim (htr_ctx->dedup, rfile_info_ctx, &dedup_idx, &rc);
+
+  if (role == HTR_DEDUP_COPY)
   {
-    fprintf (stderr, "%s: open file failed \n", htr_ctx->log_fpath);
+    jmprobe_close (&rfile_info_ctx->probe);
+  }
+  else if (extract_hchash_vaguemode (rfile_info_ctx) == -1)
+  {
+    rc = HTR_EXTRACT_CVT_FAILED;
+  }
 
-    return -1;
+  if (role == HTR_DEDUP_OWNER) htr_dedup_publish (htr_ctx->dedup, dedup_idx, rfile_info_ctx, rc);
+
+  if ((cache != NULL) && (rc == HTR_EXTRACT_OK)) htr_cache_store (cache, rfile_info_ctx);
+
+  return rc;
+}
+
+static int extract_rfile_by_default (void *userdata, rfile_info_ctx_t *rfile_info_ctx)
+{
+  return extract_rfile ((htr_ctx_t *) userdata, rfile_info_ctx);
+}
+
+struct htr_config_commit_ctx {
+  htr_ctx_t *htr_ctx;
+
+  // outfiles and the log, opened once, written through buffers
+
+  htr_out_t      *out;
+  htr_out_dst_t  *log;
+  htr_out_dst_t **sink_dsts;  // per sink of the config, opened on first use
+
+  const htr_config_inicfg_t *htr_config_inicfg;
+};
+
+typedef struct htr_config_commit_ctx htr_config_commit_ctx_t;
+
+static int extract_rfile_by_config (void *userdata, rfile_info_ctx_t *rfile_info_ctx)
+{
+  return extract_rfile (((htr_config_commit_ctx_t *) userdata)->htr_ctx, rfile_info_ctx);
+}
+
+static void commit_rfile_by_config (void *userdata, rfile_info_ctx_t *rfile_info_ctx, int rc)
+{
+  htr_config_commit_ctx_t *commit_ctx = (htr_config_commit_ctx_t *) userdata;
+
+  htr_ctx_t *htr_ctx = commit_ctx->htr_ctx;
+
+  htr_out_dst_t *log = commit_ctx->log;
+
+  // outfiles are flushed and synced every HTR_OUT_COMMIT_CNT files
+
+  htr_out_mark (commit_ctx->out);
+
+  if (rc == HTR_EXTRACT_UNKNOWN_FTYPE)
+  {
+    fprintf (stderr, "%s: convert failed, not supported file type, skip\n", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, not supported file type, skip\n", rfile_info_ctx->path);
+
+    return;
   }
 
-  // read config
+  if (rc == HTR_EXTRACT_CVT_FAILED)
+  {
+    fprintf (stderr, "%s: convert failed, extract_hchash_vaguemode failed, skip", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, extract_hchash_vaguemode failed, skip", rfile_info_ctx->path);
 
-  htr_config_inicfg_t htr_config_inicfg;
+    return;
+  }
 
-  memset (&htr_config_inicfg, 0, sizeof (htr_config_inicfg_t));
+  if (rfile_info_ctx->file_encryption == FILE_UNENCRYPTED)
+  {
+    fprintf (stderr, "%s: convert failed, file length 0, might be unencrypted, skip\n", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, file length 0, might be unencrypted, skip\n", rfile_info_ctx->path);
 
-  read_htr_config_file (&htr_config_inicfg, user_options->config_fpath);
+    return;
+  }
 
-  size_t tbc_file_idx = 0;
+  hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
 
-  for (tbc_file_idx = 0; tbc_file_idx < user_options->tbc_fpaths_cnt; tbc_file_idx++)
+  const int sink = htr_config_route (commit_ctx->htr_config_inicfg, hash_ctx->hash_mode);
+
+  // write to file
+
+  if (sink == -1)
   {
-    strcpy (rfile_info_ctx->path, user_options->tbc_fpaths[tbc_file_idx]);
+    fprintf (stderr, "%s: convert failed, out_fpath == NULL, skip\n", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, out_fpath == NULL, skip\n", rfile_info_ctx->path);
 
-    hash_ctx_init (rfile_info_ctx->hash_ctx);
+    return;
+  }
 
-    // get vague mode by checking file header
+  const char *out_fpath = commit_ctx->htr_config_inicfg->sinks[sink];
 
-    if (get_rw_rfile_ftype (rfile_info_ctx) == -1)
-    {
-      fprintf (stderr, "%s: convert failed, not supported file type, skip\n", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, not supported file type, skip\n", rfile_info_ctx->path);
+  if (commit_ctx->sink_dsts[sink] == NULL) commit_ctx->sink_dsts[sink] = htr_out_open (commit_ctx->out, out_fpath);
 
-      continue;
-    }
+  htr_out_dst_t *out = commit_ctx->sink_dsts[sink];
 
-    if (extract_hchash_vaguemode (rfile_info_ctx) == -1)
-    {
-      fprintf (stderr, "%s: convert failed, extract_hchash_vaguemode failed, skip", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, extract_hchash_vaguemode failed, skip", rfile_info_ctx->path);
+  if (out == NULL)
+  {
+    fprintf (stderr, "%s: convert failed, open file failed, skip\n", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, open file[%s] failed, skip\n", rfile_info_ctx->path, out_fpath);
 
-      continue;
-    }
+    return;
+  }
 
-    if (rfile_info_ctx->file_encryption == FILE_UNENCRYPTED)
-    {
-      fprintf (stderr, "%s: convert failed, file length 0, might be unencrypted, skip\n", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, file length 0, might be unencrypted, skip\n", rfile_info_ctx->path);
+  hash_rec_t *hash = hash_ctx->hash;
+
+  if ((hash != NULL) && (hash->len > 0))
+  {
+    htr_out_write (out, hash->val, hash->len);
 
-      continue;
+    if (hash_ctx->hash_mode != 2500)
+    {
+      htr_out_write (out, EOL, strlen (EOL));
     }
 
-    char *out_fpath = NULL;
+    printf ("%s: convert success !\n", rfile_info_ctx->path);
 
-    switch (hash_ctx->hash_mode)
-    {
-    case 2500:
-      out_fpath = htr_config_inicfg.wpa2500;
-      break;
+    htr_out_printf (log, "%s: convert success ! [%d] [len: %zu] [", rfile_info_ctx->path, hash_ctx->hash_mode, hash->len);
+    htr_out_write  (log, hash->val, hash->len);
+    htr_out_printf (log, "]\n");
 
-    case 9400:
-      out_fpath = htr_config_inicfg.office9400;
-      break;
-    case 9500:
-      out_fpath = htr_config_inicfg.office9500;
-      break;
-    case 9600:
-      out_fpath = htr_config_inicfg.office9600;
-      break;
+    htr_ctx->valid_hashes_cnt++;
+  }
+  else
+  {
+    fprintf (stderr, "%s: convert failed, hash_len <= 0 \n, skip", rfile_info_ctx->path);
+    htr_out_printf (log, "%s: convert failed, hash_len <= 0 \n, skip", rfile_info_ctx->path);
+  }
+}
 
-    case 10400:
-      out_fpath = htr_config_inicfg.pdf10400;
-      break;
-    case 10410:
-      out_fpath = htr_config_inicfg.pdf10410;
-      break;
-    case 10420:
-      out_fpath = htr_config_inicfg.pdf10420;
-      break;
-    case 10500:
-      out_fpath = htr_config_inicfg.pdf10500;
-      break;
-    case 10600:
-      out_fpath = htr_config_inicfg.pdf10600;
-      break;
-    case 10700:
-      out_fpath = htr_config_inicfg.pdf10700;
-      break;
+static int extract_hash_by_config (htr_ctx_t * htr_ctx)
+{
+  htr_user_options *user_options = htr_ctx->user_options;
 
-    case 11600:
-      out_fpath = htr_config_inicfg.szip11600;
-      break;
-    case 12500:
-      out_fpath = htr_config_inicfg.rar12500;
-      break;
-    case 13000:
-      out_fpath = htr_config_inicfg.rar13000;
-      break;
-    case 13600:
-      out_fpath = htr_config_inicfg.pkzip13600;
-      break;
-    default:
-      break;
-    }
+  htr_out_t out;
 
-    // write to file
+  htr_out_init (&out);
 
-    if (out_fpath == NULL)
-    {
-      fprintf (stderr, "%s: convert failed, out_fpath == NULL, skip\n", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, out_fpath == NULL, skip\n", rfile_info_ctx->path);
+  // config mode logging
 
-      continue;
-    }
+  htr_out_dst_t *log = htr_out_open (&out, htr_ctx->log_fpath);
 
-    FILE *out = fopen (out_fpath, "ab");
+  if (log == NULL)
+  {
+    fprintf (stderr, "%s: open file failed \n", htr_ctx->log_fpath);
 
-    if (out == NULL)
-    {
-      fprintf (stderr, "%s: convert failed, open file failed, skip\n", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, open file[%s] failed, skip\n", rfile_info_ctx->path, out_fpath);
+    htr_out_destory (&out);
 
-      continue;
-    }
+    return -1;
+  }
 
-    hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+  // read config
 
-    if (hash_ctx->len > 0)
-    {
-      fwrite (hash_ctx->hash_val, hash_ctx->len, 1, out);
+  htr_config_inicfg_t htr_config_inicfg;
 
-      if (hash_ctx->hash_mode != 2500)
-      {
-        fprintf (out, EOL);
-      }
+  memset (&htr_config_inicfg, 0, sizeof (htr_config_inicfg_t));
 
-      printf ("%s: convert success !\n", rfile_info_ctx->path);
+  if (read_htr_config_file (&htr_config_inicfg, user_options->config_fpath) == -1)
+  {
+    htr_out_destory (&out);
 
-      fprintf (log_fp, "%s: convert success ! [%d] [len: %d] [", rfile_info_ctx->path, hash_ctx->hash_mode, hash_ctx->len);
-      fwrite (hash_ctx->hash_val, hash_ctx->len, 1, log_fp);
-      fprintf (log_fp, "]\n");
+    return -1;
+  }
 
-      htr_ctx->valid_hashes_cnt++;
-    }
-    else
-    {
-      fprintf (stderr, "%s: convert failed, hash_len <= 0 \n, skip", rfile_info_ctx->path);
-      fprintf (log_fp, "%s: convert failed, hash_len <= 0 \n, skip", rfile_info_ctx->path);
-    }
+  htr_config_commit_ctx_t commit_ctx;
 
-    fclose (out);
+  commit_ctx.htr_ctx           = htr_ctx;
+  commit_ctx.out               = &out;
+  commit_ctx.log               = log;
+  commit_ctx.sink_dsts         = (htr_out_dst_t **) jmcalloc (htr_config_inicfg.sinks_cnt + 1, sizeof (htr_out_dst_t *));
+  commit_ctx.htr_config_inicfg = &htr_config_inicfg;
+
+  if (commit_ctx.sink_dsts == NULL)
+  {
+    htr_config_inicfg_destory (&htr_config_inicfg);
 
-    hash_ctx_destory (rfile_info_ctx->hash_ctx);
+    htr_out_destory (&out);
+
+    return -1;
   }
 
-  printf ("[hash_extr]: converted %d/%d hashes\n", htr_ctx->valid_hashes_cnt, htr_ctx->user_options->tbc_fpaths_cnt);
+  htr_pool_run (user_options->workers_cnt, htr_ctx->src, extract_rfile_by_config, commit_rfile_by_config, &commit_ctx);
+
+  // last commit point, before the summary claims anything
 
-  fclose (log_fp);
+  htr_out_commit (&out);
+
+  printf ("[hash_extr]: converted %d/%" PRIu64 " hashes\n", htr_ctx->valid_hashes_cnt, htr_ctx->src->files_cnt);
+
+  printf ("[hash_extr]: %" PRIu64 " duplicates extracted once\n", htr_ctx->dedup->copies_cnt);
+
+  if (htr_ctx->cache != NULL)
+  {
+    printf ("[hash_extr]: %" PRIu64 " served from cache %s\n", htr_ctx->cache->hits_cnt, user_options->cache_fpath);
+  }
+
+  jmfree (commit_ctx.sink_dsts);
+
+  htr_config_inicfg_destory (&htr_config_inicfg);
+
+  htr_out_destory (&out);
 
   return 1;
 }
@@ -392,7 +546,25 @@ static int extract_hash_by_single (htr_ctx_t * htr_ctx)
 
   rfile_info_ctx_t *rfile_info_ctx = htr_ctx->rfile_info_ctx;
 
-  strcpy (rfile_info_ctx->path, user_options->tbc_fpaths[0]);
+  char fpath[FILE_PATH_MAXLEN];
+
+  if (htr_src_next (htr_ctx->src, fpath, sizeof (fpath)) == 0)
+  {
+    fprintf (stderr, "[single mode]: no tbc file\n");
+
+    exit (EXIT_FAILURE);
+  }
+
+  char fpath_more[FILE_PATH_MAXLEN];
+
+  if (htr_src_next (htr_ctx->src, fpath_more, sizeof (fpath_more)) == 1)
+  {
+    fprintf (stderr, "[single mode]: too many tbc files\n");
+
+    exit (EXIT_FAILURE);
+  }
+
+  rfile_info_ctx_reset (rfile_info_ctx, fpath);
 
   // get vague mode by checking file header
 
@@ -414,48 +586,37 @@ static int extract_hash_by_single (htr_ctx_t * htr_ctx)
     exit (EXIT_FAILURE);
   }
 
-  hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+  hash_rec_t *hash = rfile_info_ctx->hash_ctx->hash;
 
-  fwrite (hash_ctx->hash_val, hash_ctx->len, 1, out);
+  if (hash != NULL) fwrite (hash->val, hash->len, 1, out);
 
   fclose (out);
 
   return 1;
 }
 
-static int extract_hash_by_default (htr_ctx_t * htr_ctx)
+static void commit_rfile_by_default (MAYBE_UNUSED void *userdata, rfile_info_ctx_t *rfile_info_ctx, int rc)
 {
-  htr_user_options *user_options = htr_ctx->user_options;
-
-  rfile_info_ctx_t *rfile_info_ctx = htr_ctx->rfile_info_ctx;
-
-  size_t tbc_file_idx = 0;
-
-  for (tbc_file_idx = 0; tbc_file_idx < user_options->tbc_fpaths_cnt; tbc_file_idx++)
+  if (rc == HTR_EXTRACT_UNKNOWN_FTYPE)
   {
-    strcpy (rfile_info_ctx->path, user_options->tbc_fpaths[tbc_file_idx]);
-
-    char *tbc_fpath_nos = get_filename_nosuffix (rfile_info_ctx->path);
-
+    fprintf (stderr, "%s: not supported file type\n", rfile_info_ctx->path);
 
-    if (get_rw_rfile_ftype (rfile_info_ctx) == -1)
-    {
-      fprintf (stderr, "%s: not supported file type\n", rfile_info_ctx->path);
-
-      continue;
-    }
+    return;
+  }
 
-    extract_hchash_vaguemode (rfile_info_ctx);
+  // write to stdout
 
-    // write to stdout
+  hash_rec_t *hash = rfile_info_ctx->hash_ctx->hash;
 
-    hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+  if (hash != NULL) fwrite (hash->val, hash->len, 1, stdout);
+  printf("\n");
+}
 
-    fwrite (hash_ctx->hash_val, hash_ctx->len, 1, stdout);
-    printf("\n");
+static int extract_hash_by_default (htr_ctx_t * htr_ctx)
+{
+  htr_user_options *user_options = htr_ctx->user_options;
 
-    free (tbc_fpath_nos);
-  }
+  htr_pool_run (user_options->workers_cnt, htr_ctx->src, extract_rfile_by_default, commit_rfile_by_default, htr_ctx);
 
   return 1;
 }
@@ -475,13 +636,6 @@ static int htr_session_execute (htr_ctx_t * htr_ctx)
 
   if (user_options->op_mode == 1)
   {
-    if (user_options->tbc_fpaths_cnt > 1)
-    {
-      fprintf (stderr, "[single mode]: too many tbc files\n");
-
-      exit (EXIT_FAILURE);
-    }
-
     if (user_options->out_fpath == NULL)
     {
       fprintf (stderr, "[single mode]: -o output_file is required\n");
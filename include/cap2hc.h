@@ -0,0 +1,447 @@
+#ifndef _CAP2HC_H
+#define _CAP2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * in-process port of hashcat-utils' cap2hccapx (src/cap2hccapx.c),
+ * walks a pcap held in memory and appends hccapx_t records to a membuf_t
+ */
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BIG_ENDIAN_HOST
+#endif
+
+// from pcap.h
+
+#define PCAP_TCPDUMP_MAGIC 0xa1b2c3d4
+#define PCAP_TCPDUMP_CIGAM 0xd4c3b2a1
+
+#define TCPDUMP_DECODE_LEN 65535
+
+#define DLT_IEEE802_11         105 /* IEEE 802.11 wireless */
+#define DLT_IEEE802_11_PRISM   119
+#define DLT_IEEE802_11_RADIO   127
+#define DLT_IEEE802_11_PPI_HDR 192
+
+// struct pcap_file_header comes from types.h
+
+struct pcap_pkthdr {
+  u32 tv_sec;   /* timestamp seconds */
+  u32 tv_usec;  /* timestamp microseconds */
+  u32 caplen;   /* length of portion present */
+  u32 len;      /* length this packet (off wire) */
+};
+
+typedef struct pcap_file_header pcap_file_header_t;
+typedef struct pcap_pkthdr pcap_pkthdr_t;
+
+// from the pcapng spec, draft-ietf-opsawg-pcapng
+
+#define PCAPNG_BLOCK_SHB 0x0a0d0d0a   /* section header, the same in either byte order */
+#define PCAPNG_BLOCK_IDB 0x00000001   /* interface description */
+#define PCAPNG_BLOCK_SPB 0x00000003   /* simple packet */
+#define PCAPNG_BLOCK_EPB 0x00000006   /* enhanced packet */
+
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+
+#define PCAPNG_OPT_ENDOFOPT   0
+#define PCAPNG_OPT_IF_TSRESOL 9
+
+struct pcapng_block_header {
+  u32 block_type;
+  u32 block_total_length;   /* repeated after the body */
+};
+
+struct pcapng_shb {
+  u32 byte_order_magic;
+  u16 major_version;
+  u16 minor_version;
+  u64 section_length;
+};
+
+struct pcapng_idb {
+  u16 linktype;
+  u16 reserved;
+  u32 snaplen;
+};
+
+struct pcapng_epb {
+  u32 interface_id;
+  u32 timestamp_high;
+  u32 timestamp_low;
+  u32 caplen;
+  u32 len;
+};
+
+struct pcapng_spb {
+  u32 len;
+};
+
+typedef struct pcapng_block_header pcapng_block_header_t;
+typedef struct pcapng_shb pcapng_shb_t;
+typedef struct pcapng_idb pcapng_idb_t;
+typedef struct pcapng_epb pcapng_epb_t;
+typedef struct pcapng_spb pcapng_spb_t;
+
+// from linux/ieee80211.h
+
+struct ieee80211_hdr_3addr {
+  u16 frame_control;
+  u16 duration_id;
+  u8  addr1[6];
+  u8  addr2[6];
+  u8  addr3[6];
+  u16 seq_ctrl;
+
+} __attribute__((packed));
+
+struct ieee80211_qos_hdr {
+  u16 frame_control;
+  u16 duration_id;
+  u8  addr1[6];
+  u8  addr2[6];
+  u8  addr3[6];
+  u16 seq_ctrl;
+  u16 qos_ctrl;
+
+} __attribute__((packed));
+
+typedef struct ieee80211_hdr_3addr ieee80211_hdr_3addr_t;
+typedef struct ieee80211_qos_hdr   ieee80211_qos_hdr_t;
+
+struct ieee80211_llc_snap_header {
+  /* LLC part: */
+  u8  dsap;      /**< Destination SAP ID */
+  u8  ssap;      /**< Source SAP ID */
+  u8  ctrl;      /**< Control information */
+
+  /* SNAP part: */
+  u8  oui[3];    /**< Organization code, usually 0 */
+  u16 ethertype; /**< Ethernet Type field */
+
+} __attribute__((packed));
+
+typedef struct ieee80211_llc_snap_header ieee80211_llc_snap_header_t;
+
+#define IEEE80211_FCTL_FTYPE          0x000c
+#define IEEE80211_FCTL_STYPE          0x00f0
+#define IEEE80211_FCTL_TODS           0x0100
+#define IEEE80211_FCTL_FROMDS         0x0200
+
+#define IEEE80211_FTYPE_MGMT          0x0000
+#define IEEE80211_FTYPE_DATA          0x0008
+
+#define IEEE80211_STYPE_ASSOC_REQ     0x0000
+#define IEEE80211_STYPE_REASSOC_REQ   0x0020
+#define IEEE80211_STYPE_PROBE_REQ     0x0040
+#define IEEE80211_STYPE_PROBE_RESP    0x0050
+#define IEEE80211_STYPE_BEACON        0x0080
+#define IEEE80211_STYPE_QOS_DATA      0x0080
+
+#define IEEE80211_LLC_DSAP             0xAA
+#define IEEE80211_LLC_SSAP             0xAA
+#define IEEE80211_LLC_CTRL             0x03
+#define IEEE80211_DOT1X_AUTHENTICATION 0x8E88
+
+/* Management Frame Information Element Types */
+#define MFIE_TYPE_SSID      0
+
+// from ks7010/eap_packet.h
+
+#define WBIT(n) (1 << (n))
+
+#define WPA_KEY_INFO_TYPE_MASK (WBIT(0) | WBIT(1) | WBIT(2))
+#define WPA_KEY_INFO_INSTALL   WBIT(6) /* pairwise */
+#define WPA_KEY_INFO_ACK       WBIT(7)
+#define WPA_KEY_INFO_MIC       WBIT(8)
+#define WPA_KEY_INFO_SECURE    WBIT(9)
+
+// radiotap header from http://www.radiotap.org/
+
+struct ieee80211_radiotap_header {
+  u8  it_version; /* set to 0 */
+  u8  it_pad;
+  u16 it_len;     /* entire length */
+  u32 it_present; /* fields present */
+
+} __attribute__((packed));
+
+typedef struct ieee80211_radiotap_header ieee80211_radiotap_header_t;
+
+// prism header
+
+#define WLAN_DEVNAMELEN_MAX 16
+
+struct prism_item {
+  u32 did;
+  u16 status;
+  u16 len;
+  u32 data;
+
+} __attribute__((packed));
+
+struct prism_header {
+  u32 msgcode;
+  u32 msglen;
+
+  char devname[WLAN_DEVNAMELEN_MAX];
+
+  struct prism_item hosttime;
+  struct prism_item mactime;
+  struct prism_item channel;
+  struct prism_item rssi;
+  struct prism_item sq;
+  struct prism_item signal;
+  struct prism_item noise;
+  struct prism_item rate;
+  struct prism_item istx;
+  struct prism_item frmlen;
+
+} __attribute__((packed));
+
+typedef struct prism_item prism_item_t;
+typedef struct prism_header prism_header_t;
+
+/* CACE PPI headers */
+struct ppi_packet_header {
+  u8  pph_version;
+  u8  pph_flags;
+  u16 pph_len;
+  u32 pph_dlt;
+
+} __attribute__((packed));
+
+typedef struct ppi_packet_header ppi_packet_header_t;
+
+// management frame bodies in front of the tagged parameters
+
+struct beaconinfo {
+  u64 beacon_timestamp;
+  u16 beacon_interval;
+  u16 beacon_capabilities;
+
+} __attribute__((packed));
+
+typedef struct beaconinfo beacon_t;
+
+struct associationreqf {
+  u16 client_capabilities;
+  u16 client_listeninterval;
+
+} __attribute__((packed));
+
+typedef struct associationreqf assocreq_t;
+
+struct reassociationreqf {
+  u16 client_capabilities;
+  u16 client_listeninterval;
+  u8  addr[6];
+
+} __attribute__((packed));
+
+typedef struct reassociationreqf reassocreq_t;
+
+struct auth_packet {
+  u8  version;
+  u8  type;
+  u16 length;
+  u8  key_descriptor;
+  u16 key_information;
+  u16 key_length;
+  u64 replay_counter;
+  u8  wpa_key_nonce[32];
+  u8  wpa_key_iv[16];
+  u8  wpa_key_rsc[8];
+  u8  wpa_key_id[8];
+  u8  wpa_key_mic[16];
+  u16 wpa_key_data_length;
+
+} __attribute__((packed));
+
+typedef struct auth_packet auth_packet_t;
+
+#define MAX_ESSID_LEN 32
+
+typedef enum essid_source
+{
+  ESSID_SOURCE_USER           = 1,
+  ESSID_SOURCE_REASSOC        = 2,
+  ESSID_SOURCE_ASSOC          = 3,
+  ESSID_SOURCE_PROBE          = 4,
+  ESSID_SOURCE_DIRECTED_PROBE = 5,
+  ESSID_SOURCE_BEACON         = 6,
+
+} essid_source_t;
+
+struct essid {
+  u8   bssid[6];
+  char essid[MAX_ESSID_LEN + 4];
+  int  essid_len;
+  int  essid_source;
+};
+
+typedef struct essid essid_t;
+
+#define EAPOL_TTL 1
+
+typedef enum exc_pkt_num
+{
+  EXC_PKT_NUM_1 = 1,
+  EXC_PKT_NUM_2 = 2,
+  EXC_PKT_NUM_3 = 3,
+  EXC_PKT_NUM_4 = 4,
+
+} exc_pkt_num_t;
+
+typedef enum message_pair
+{
+  MESSAGE_PAIR_M12E2 = 0,
+  MESSAGE_PAIR_M14E4 = 1,
+  MESSAGE_PAIR_M32E2 = 2,
+  MESSAGE_PAIR_M32E3 = 3,
+  MESSAGE_PAIR_M34E3 = 4,
+  MESSAGE_PAIR_M34E4 = 5,
+
+} message_pair_t;
+
+// nonce error correction hints in the high bits of message_pair, as hashcat reads them
+
+#define MESSAGE_PAIR_NC_LE 0x20   // the ap counts its anonces up little endian
+#define MESSAGE_PAIR_NC_BE 0x40   // big endian
+#define MESSAGE_PAIR_NC    0x80   // replay counters differ, corrections are needed
+
+#define CAP2HC_NC_DIST_MAX 1024   // anonces further apart are not taken as counted up
+
+#define BROADCAST_MAC "\xff\xff\xff\xff\xff\xff"
+
+struct excpkt {
+  int excpkt_num;
+
+  u32 tv_sec;
+  u32 tv_usec;
+
+  u64 replay_counter;
+
+  u8  mac_ap[6];
+  u8  mac_sta[6];
+
+  u8  nonce[32];
+
+  u16 eapol_len;
+  u8  eapol[256];
+
+  u8  keyver;
+  u8  keymic[16];
+};
+
+typedef struct excpkt excpkt_t;
+
+// output
+
+#define HCCAPX_VERSION   4
+#define HCCAPX_SIGNATURE 0x58504348 // HCPX
+
+struct hccapx {
+  u32 signature;
+  u32 version;
+  u8  message_pair;
+  u8  essid_len;
+  u8  essid[32];
+  u8  keyver;
+  u8  keymic[16];
+  u8  mac_ap[6];
+  u8  nonce_ap[32];
+  u8  mac_sta[6];
+  u8  nonce_sta[32];
+  u16 eapol_len;
+  u8  eapol[256];
+
+} __attribute__((packed));
+
+typedef struct hccapx hccapx_t;
+
+// databases, they start small and grow as needed, each with a hash index
+// of its own: essids by bssid, eapol frames by everything that tells two
+// of them apart. the indexes are at most half full, which limits the count
+
+#define DB_ESSID_MAX    (1u << 30)
+#define DB_EXCPKT_MAX   (1u << 30)
+
+#define DB_ESSID_INIT   16
+#define DB_EXCPKT_INIT  64
+
+// open addressing, slots hold index + 1, 0 is free
+struct cap2hc_index {
+  u32 *slots;
+  u32  size;   // a power of 2
+};
+
+typedef struct cap2hc_index cap2hc_index_t;
+
+// sharded parsing
+
+#define CAP2HC_SHARD_MIN  (32 * 1024 * 1024)
+#define CAP2HC_SHARDS_MAX 64
+
+// everything cap2hccapx kept in globals, one per capture (or reused across captures)
+
+struct cap2hc_ctx {
+  essid_t  *essids;
+  u32       essids_cnt;
+  u32       essids_avail;
+
+  cap2hc_index_t essids_by_bssid;
+
+  excpkt_t *excpkts;
+  u32       excpkts_cnt;
+  u32       excpkts_avail;
+
+  cap2hc_index_t excpkts_by_key;
+
+  // only export networks with this essid, NULL for all
+
+  const char *essid_filter;
+
+  // 0 exports every pair as cap2hccapx does, N only the N best of every
+  // (essid, ap, sta), with nonce error correction hints
+
+  u32 best_cnt;
+};
+
+typedef struct cap2hc_ctx cap2hc_ctx_t;
+
+int  cap2hc_ctx_init    (cap2hc_ctx_t *ctx);
+void cap2hc_ctx_reset   (cap2hc_ctx_t *ctx);
+void cap2hc_ctx_destory (cap2hc_ctx_t *ctx);
+
+int  cap2hc_add_essid (cap2hc_ctx_t *ctx, char *s);
+
+// captures of CAP2HC_SHARD_MIN bytes and more are cut into shards and
+// parsed by up to threads_cnt threads at once, shared by all captures
+// being parsed, 1 (no sharding) by default. set it before any parse
+void cap2hc_set_threads (const u32 threads_cnt);
+
+#define CAP2HC_BEST_MAX 255
+
+// the best_cnt of the captures cap2hc_extract () converts, 0 by default
+void cap2hc_set_best (const u32 best_cnt);
+u32  cap2hc_get_best (void);
+
+// pcap or pcapng, buf is only read, the packets are looked at where they are, never copied
+int  cap2hc_parse (cap2hc_ctx_t *ctx, const u8 *buf, const size_t len, const char *name);
+int  cap2hc_write (cap2hc_ctx_t *ctx, membuf_t *out);
+
+int  cap2hc_extract_buf (cap2hc_ctx_t *ctx, const u8 *buf, const size_t len, const char *name, membuf_t *out);
+int  cap2hc_extract (const jmprobe_t *probe, membuf_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CAP2HC_H
@@ -14,6 +14,7 @@ extern "C" {
 #include <stdbool.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <stdarg.h>
 
 #include "types.h"
 
@@ -122,6 +123,9 @@ but this is nededed for VS compiler which doesn't have inline keyword but has __
 #define HCBUFSIZ_TINY       0x1000
 #define HCBUFSIZ_LARGE      0x50000
 
+#define JMARENA_ALIGN       16
+#define JMARENA_CHUNK_HDR   ((sizeof (struct jmarena_chunk) + JMARENA_ALIGN - 1) & ~((size_t) JMARENA_ALIGN - 1))
+
 #define CPT_CACHE           0x20000
 #define PARAMCNT            64
 #define DEVICES_MAX         128
@@ -148,6 +152,41 @@ but this is nededed for VS compiler which doesn't have inline keyword but has __
 // #define HAVE_STRSEP
 // #endif
 
+// growable in-memory buffer, buf is always 0-terminated at buf[len]
+
+struct membuf {
+  char  *buf;
+  size_t len;
+  size_t size;
+};
+
+typedef struct membuf membuf_t;
+
+// a child process spawned without a shell, its stdout is readable from fd
+
+struct jmproc {
+#if defined (_POSIX)
+  pid_t pid;
+  int   fd;
+#elif defined (_WIN)
+  FILE *fp;
+#endif
+};
+
+typedef struct jmproc jmproc_t;
+
+// a read-only view of a whole file, mapped where possible, read into memory otherwise
+
+struct jmmap {
+  const uint8_t *buf;
+  size_t         len;
+
+  bool           mapped;
+  membuf_t       mb;
+};
+
+typedef struct jmmap jmmap_t;
+
 int strlist_init(char ***outputs, int num_of_outputs, int output_len);
 
 void strlist_copy(char ***outputs, char **old, int start, int end, int output_len);
@@ -173,8 +212,6 @@ void jmfree (void *ptr);
 
 // file
 
-int copy_file (char *old_filename, char *new_filename);
-
 int get_file_len (const char *fpath, int *file_len);
 
 char *jm_base_to_absolute_path(const char *base, const char *relative);
@@ -189,6 +226,66 @@ FILE *jmpopen(const char *cmd, const char *mode);
 
 FILE *jmpclose(FILE *p);
 
+int jmpopenv (jmproc_t *proc, char *const argv[]);
+
+int jmpclosev (jmproc_t *proc);
+
+int jmpcapture (char *const argv[], membuf_t *out);
+
+// memory buffer
+
+int  membuf_init (membuf_t *mb, const size_t size);
+
+int  membuf_reserve (membuf_t *mb, const size_t add);
+
+int  membuf_append (membuf_t *mb, const void *data, const size_t len);
+
+void membuf_reset (membuf_t *mb);
+
+void membuf_destory (membuf_t *mb);
+
+int  membuf_read_file (membuf_t *mb, const char *fpath);
+
+int  membuf_appendf (membuf_t *mb, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+int  membuf_vappendf (membuf_t *mb, const char *fmt, va_list ap) __attribute__ ((format (printf, 2, 0)));
+
+int  membuf_append_hex (membuf_t *mb, const uint8_t *data, const size_t len);
+
+// mapped files
+
+int  jmmap_open (jmmap_t *map, const char *fpath);
+
+int  jmmap_open_fd (jmmap_t *map, const int fd, const uint64_t size, const char *fpath);
+
+void jmmap_close (jmmap_t *map);
+
+// probes, jmprobe_t is in types.h (it is part of rfile_info_ctx_t)
+
+struct jmprobe;
+
+int   jmprobe_open (struct jmprobe *probe, const char *fpath);
+
+void  jmprobe_close (struct jmprobe *probe);
+
+int   jmprobe_map (const struct jmprobe *probe, jmmap_t *map);
+
+FILE *jmprobe_fdopen (const struct jmprobe *probe);
+
+int   jmprobe_read_at (const struct jmprobe *probe, const uint64_t offset, void *buf, const size_t len);
+
+// arenas, jmarena_t is in types.h (it is part of hash_ctx_t)
+
+struct jmarena;
+
+int   jmarena_init (struct jmarena *arena, const size_t chunk_size);
+
+void *jmarena_alloc (struct jmarena *arena, const size_t len);
+
+void  jmarena_reset (struct jmarena *arena);
+
+void  jmarena_destory (struct jmarena *arena);
+
 #ifdef __cplusplus
 }
 #endif
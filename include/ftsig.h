@@ -0,0 +1,66 @@
+#ifndef _FTSIG_H
+#define _FTSIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * file type signatures
+ *
+ * all magics of the table are looked for in one pass over the probe head
+ * with an Aho-Corasick automaton, built once, so detecting a file costs
+ * the same however many formats are listed
+ *
+ * a signature is anchored at an exact offset, or may start anywhere up to
+ * an offset (PDF allows junk before the header), or is embedded behind an
+ * SFX stub, those are searched for in a bounded window of the whole file
+ * if nothing else matched and the file starts like an executable
+ */
+
+#define FTSIG_MAX          64                 // the automaton's outputs are a u64 mask
+#define FTSIG_SFX_STUB     "MZ"
+#define FTSIG_SFX_STUB_LEN 2
+#define FTSIG_SFX_WINDOW   (4 * 1024 * 1024)  // 7-Zip and WinRAR stubs are a few hundred KB
+
+typedef enum ftsig_kind
+{
+  FTSIG_ANCHORED = 0,   // magic at offset
+  FTSIG_WINDOW   = 1,   // magic at offset or before
+  FTSIG_EMBEDDED = 2,   // magic anywhere in FTSIG_SFX_WINDOW behind an SFX stub
+
+} ftsig_kind_t;
+
+struct ftsig {
+  const char  *name;
+
+  const char  *magic;
+  u32          magic_len;
+
+  ftsig_kind_t kind;
+  u32          offset;    // within JMPROBE_HEAD_LEN, unused for embedded ones
+
+  int          hash_mode;
+};
+
+typedef struct ftsig ftsig_t;
+
+struct ftsig_match {
+  const ftsig_t *sig;
+
+  u64 offset;   // where the magic starts in the file
+};
+
+typedef struct ftsig_match ftsig_match_t;
+
+// 1 found, 0 unknown type, -1 error, the earliest table entry wins
+int ftsig_detect (const jmprobe_t *probe, ftsig_match_t *match);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FTSIG_H
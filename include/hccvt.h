@@ -18,6 +18,13 @@ extern "C" {
 #include "hccvt.h"
 #include "common.h"
 #include "types.h"
+#include "rar2hc.h"
+#include "zip2hc.h"
+#include "cap2hc.h"
+#include "pdf2hc.h"
+#include "office2hc.h"
+#include "szip2hc.h"
+#include "ftsig.h"
 
 #define CUT_CHALLENG_LEN 32
 #define RESPONSEDATA     8
@@ -29,34 +36,18 @@ extern "C" {
 
 #define ERROR_NUM_WARNING 0x00000011
 
+// most hashes are well below this, longer ones get a chunk of their own
+#define HASH_ARENA_CHUNK_SIZE HCBUFSIZ_TINY
 
 
-#if defined (_POSIX)
-
-// #if defined (__unix__)
-// #define SZIP_TO_JOHN_PATH      "./cvttools/posix/7z2hashcat_centos7"                              //    7ZIP
-// #elif defined (__APPLE__)
-#define SZIP_TO_JOHN_PATH      "./cvttools/posix/7z2hashcat.pl"                              //    7ZIP
-// #endif
 
-#define CAP_TO_HCCPAX_PATH     "./cvttools/posix/hashcat-utils-master/src/cap2hccapx.bin" //    WPA
-#define RAR_TO_JOHN_PATH       "./cvttools/posix/JohnTheRipper/run/rar2john"              //    RAR
-#define ZIP_TO_JOHN_PATH       "./cvttools/posix/JohnTheRipper/run/zip2john"              //    ZIP
+#if defined (_POSIX)
 
-#define OFFICE_TO_JOHN_PATH    "./cvttools/posix/office2john.py"                          //    GPU_OFFICE
-#define PDF_TO_HASHCAT_PATH    "./cvttools/posix/pdf2hashcat.py"                          //    PDF
 #define TRUECRYPT_TO_JOHN_PATH "./cvttools/posix/truecrypt2john.py"                       //    TRUECRYPT
 
 #elif defined (_WIN)
 
-#define RAR_TO_JOHN_PATH       ".\\cvttools\\windows\\rar2john.exe" //    RAR
-#define ZIP_TO_JOHN_PATH       ".\\cvttools\\windows\\zip2john.exe" //    ZIP
-
-#define CAP_TO_HCCPAX_PATH     ".\\cvttools\\windows\\cap2hccapx.exe"     //    WPA
-#define OFFICE_TO_JOHN_PATH    ".\\cvttools\\windows\\office2john.exe"    //    GPU_OFFICE
 #define TRUECRYPT_TO_JOHN_PATH ".\\cvttools\\windows\\truecrypt2john.exe" //    TRUECRYPT
-#define PDF_TO_HASHCAT_PATH    ".\\cvttools\\windows\\pdf2hashcat.exe"    //    PDF
-#define SZIP_TO_JOHN_PATH      ".\\cvttools\\windows\\7z2hashcat32.exe"        //    7ZIP
 
 #define SYNC_EXE_PATH      ".\\cvttools\\windows\\sync32.exe"
 
@@ -66,8 +57,22 @@ extern "C" {
 int extract_hchash_vaguemode (rfile_info_ctx_t *rfile_info_ctx);
 int get_rw_rfile_ftype (rfile_info_ctx_t *rfile_info_ctx);
 
-int hash_ctx_init (hash_ctx_t *hash_ctx);
-int hash_ctx_destory (hash_ctx_t *hash_ctx);
+int  hash_ctx_init (hash_ctx_t *hash_ctx);
+void hash_ctx_reset (hash_ctx_t *hash_ctx);
+int  hash_ctx_destory (hash_ctx_t *hash_ctx);
+
+int  rfile_info_ctx_init (rfile_info_ctx_t *rfile_info_ctx);
+void rfile_info_ctx_reset (rfile_info_ctx_t *rfile_info_ctx, const char *fpath);
+void rfile_info_ctx_destory (rfile_info_ctx_t *rfile_info_ctx);
+
+// a result taken over from elsewhere (cache, a copy of the file), hash is copied
+int  rfile_info_ctx_set_result (rfile_info_ctx_t *rfile_info_ctx, const int hash_mode, const file_encryption_t file_encryption, const char *hash, const size_t hash_len);
+
+// false if the hash names the file (rar archive names), it is then only valid for this path
+bool rfile_hash_is_path_free (const rfile_info_ctx_t *rfile_info_ctx);
+
+// the converter setting hashes of hash_mode are made with, 0 for the default one (wpa: cap2hc_get_best ())
+u32  hccvt_variant (const int hash_mode);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,123 @@
+#ifndef _HTRCACHE_H
+#define _HTRCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * extraction cache
+ *
+ * what a file was extracted to (mode, encryption, hash) is appended to a
+ * log file and loaded back by the next run, files found in it are not
+ * converted again
+ *
+ * a file is found by (dev, inode, size, mtime), or else by the sha1 of its
+ * content, which also serves copies under another path or another mount.
+ * the stat match is only trusted if the file had been left alone for
+ * HTR_CACHE_RACY_SEC when it was cached, one modified just before might
+ * have changed again without its mtime moving, it is digested and looked
+ * up by content like a new file
+ *
+ * some converters put the archive's name into the hash (rar3 -hp, rar5),
+ * those entries are only served for the path they were extracted from, and
+ * hashes made with another converter setting (hccvt_variant ()) not at all
+ */
+
+#define HTR_CACHE_MAGIC      "HTRCACHE"
+#define HTR_CACHE_MAGIC_LEN  8
+#define HTR_CACHE_VERSION    1
+#define HTR_CACHE_BYTE_ORDER 0x01020304            // records are in host byte order
+#define HTR_CACHE_RACY_SEC   2                     // FAT and SMB keep mtime to 2 s
+#define HTR_CACHE_HASH_MAX   (16 * 1024 * 1024)    // longer ones are taken as a damaged record
+#define HTR_CACHE_TABLE_MIN  1024
+
+#define HTR_CACHE_REC_PATH_FREE     (1u << 0)   // the hash does not mention the file's name
+#define HTR_CACHE_REC_VARIANT_SHIFT 8           // the bits above hold the hccvt_variant () of the hash
+
+// on disk, the header, then records one after another, each followed by its hash
+
+struct htr_cache_hdr {
+  char magic[HTR_CACHE_MAGIC_LEN];
+  u32  version;
+  u32  byte_order;
+};
+
+typedef struct htr_cache_hdr htr_cache_hdr_t;
+
+struct htr_cache_rec {
+  u64     dev;
+  u64     ino;
+  u64     size;
+  u64     mtime;
+  u64     stamp;    // when the file was read, seconds since the epoch
+  u64     path_hash;
+
+  u8      digest[RFILE_DIGEST_LEN];
+
+  int32_t hash_mode;
+  int32_t file_encryption;
+  u32     hash_len;
+
+  u32     crc;      // crc32 of the record (crc 0) and the hash, a torn append does not pass
+  u32     flags;
+};
+
+typedef struct htr_cache_rec htr_cache_rec_t;
+
+struct htr_cache_ent {
+  htr_cache_rec_t rec;
+
+  const char     *hash;   // in arena, 0-terminated
+};
+
+typedef struct htr_cache_ent htr_cache_ent_t;
+
+struct htr_cache {
+  const char *fpath;
+
+  int fd;   // open for appending
+
+  htr_cache_ent_t *ents;
+  u32              ents_cnt;
+  u32              ents_size;
+
+  // open addressing, entry index + 1, 0 is free, later entries replace earlier ones
+
+  u32 *by_stat;
+  u32 *by_digest;
+  u32  table_size;
+
+  jmarena_t arena;
+
+  u64 loaded_cnt;
+  u64 hits_cnt;
+
+  // workers look up and store at the same time
+
+  pthread_mutex_t mux;
+};
+
+typedef struct htr_cache htr_cache_t;
+
+// loads fpath, created if missing, damaged tails are cut off
+int  htr_cache_open (htr_cache_t *cache, const char *fpath);
+
+void htr_cache_close (htr_cache_t *cache);
+
+// 1 served (hash_ctx and file_encryption are set), 0 to be extracted, the digest is kept for htr_cache_store ()
+int  htr_cache_lookup (htr_cache_t *cache, rfile_info_ctx_t *rfile_info_ctx);
+
+// after a successful extraction, or a hit by content under a new stat key
+int  htr_cache_store (htr_cache_t *cache, const rfile_info_ctx_t *rfile_info_ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HTRCACHE_H
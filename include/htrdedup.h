@@ -0,0 +1,111 @@
+#ifndef _HTRDEDUP_H
+#define _HTRDEDUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * duplicate inputs within a run
+ *
+ * the first file of a size is extracted right away, its digest is only
+ * taken once another file of the same size shows up, files with the same
+ * digest as an earlier one wait for its result and take it over instead of
+ * running the converter again
+ *
+ * results are kept for sizes that have a second file by the time the owner
+ * is done, a file of the same size claiming while the owner extracts is
+ * enough. lone files keep small results while HTR_DEDUP_LONE_BUDGET
+ * lasts, a duplicate of a lone file that was not kept is extracted again.
+ * results that name the file (rar archive names) are not kept, those
+ * copies are extracted on their own
+ */
+
+#define HTR_DEDUP_TABLE_MIN 1024
+#define HTR_DEDUP_HASH_MAX  (16 * 1024 * 1024)   // longer results, raw hash dumps mostly, are extracted again
+
+#define HTR_DEDUP_LONE_MAX    (64 * 1024)         // results of lone files kept at most, each
+#define HTR_DEDUP_LONE_BUDGET (64 * 1024 * 1024)  // and all together
+
+typedef enum htr_dedup_role
+{
+  HTR_DEDUP_ALONE = 0,   // extract, nothing to publish
+  HTR_DEDUP_OWNER = 1,   // extract, then htr_dedup_publish ()
+  HTR_DEDUP_COPY  = 2,   // result and rc were taken over, nothing to do
+
+} htr_dedup_role_t;
+
+typedef enum htr_dedup_digest
+{
+  HTR_DEDUP_DIGEST_NONE = 0,   // not needed yet
+  HTR_DEDUP_DIGEST_OK   = 1,
+  HTR_DEDUP_DIGEST_BAD  = -1,  // could not be read again, or changed since, never matches
+
+} htr_dedup_digest_t;
+
+struct htr_dedup_ent {
+  u64 size;
+  u64 mtime;         // of the owner as it was extracted, a late digest must see the same
+  u32 next;          // next one of the same size, index + 1
+
+  const char *fpath; // the owner's, in arena, only for the first of a size, the one digested late
+
+  htr_dedup_digest_t digest_state;
+  u8                 digest[RFILE_DIGEST_LEN];
+
+  // the owner's result, once done, only if kept
+
+  bool               wanted;  // another file of the size claimed before done
+  bool               done;
+  bool               kept;
+  int                rc;
+  int                hash_mode;
+  file_encryption_t  file_encryption;
+  char              *hash;   // own allocation
+  size_t             hash_len;
+};
+
+typedef struct htr_dedup_ent htr_dedup_ent_t;
+
+struct htr_dedup {
+  htr_dedup_ent_t *ents;
+  u32              ents_cnt;
+  u32              ents_size;
+
+  // size to the first entry of that size, index + 1
+
+  u32 *by_size;
+  u32  table_size;
+
+  jmarena_t arena;   // paths
+
+  u64 copies_cnt;
+
+  u64 lone_len;      // bytes of kept results of lone files
+
+  pthread_mutex_t mux;
+  pthread_cond_t  cond_done;
+};
+
+typedef struct htr_dedup htr_dedup_t;
+
+int  htr_dedup_init (htr_dedup_t *dedup);
+
+void htr_dedup_destory (htr_dedup_t *dedup);
+
+// rfile_info_ctx must have its probe open, ent_idx is set for owners
+htr_dedup_role_t htr_dedup_claim (htr_dedup_t *dedup, rfile_info_ctx_t *rfile_info_ctx, u32 *ent_idx, int *rc);
+
+// owners must publish whatever came out, copies are waiting on it
+void htr_dedup_publish (htr_dedup_t *dedup, const u32 ent_idx, const rfile_info_ctx_t *rfile_info_ctx, const int rc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HTRDEDUP_H
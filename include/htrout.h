@@ -0,0 +1,67 @@
+#ifndef _HTROUT_H
+#define _HTROUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * buffered output files
+ *
+ * each destination is opened once for the whole run and written to
+ * through a buffer, one write () whenever it fills up. every
+ * HTR_OUT_COMMIT_CNT committed results, and at the end, all of them are
+ * flushed and synced, a crash loses at most the results since the last
+ * commit point
+ */
+
+#define HTR_OUT_BUFSIZ     (64 * 1024)
+#define HTR_OUT_COMMIT_CNT 1024
+
+struct htr_out_dst {
+  char    *fpath;
+  int      fd;
+
+  membuf_t buf;
+
+  bool     dirty;   // written to since the last sync
+};
+
+typedef struct htr_out_dst htr_out_dst_t;
+
+struct htr_out {
+  htr_out_dst_t **dsts;
+  u32             dsts_cnt;
+  u32             dsts_size;
+
+  u32 pending_cnt;  // results since the last commit point
+};
+
+typedef struct htr_out htr_out_t;
+
+int  htr_out_init (htr_out_t *out);
+
+// commits, then closes everything
+void htr_out_destory (htr_out_t *out);
+
+// the open destination for fpath, opened for appending on first use, NULL if it can not be
+htr_out_dst_t *htr_out_open (htr_out_t *out, const char *fpath);
+
+int  htr_out_write (htr_out_dst_t *dst, const void *data, const size_t len);
+
+int  htr_out_printf (htr_out_dst_t *dst, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+// a result was committed, commits the outputs every HTR_OUT_COMMIT_CNT of them
+int  htr_out_mark (htr_out_t *out);
+
+// flush and sync all destinations
+int  htr_out_commit (htr_out_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HTROUT_H
@@ -0,0 +1,69 @@
+#ifndef _HTRPOOL_H
+#define _HTRPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "common.h"
+#include "types.h"
+#include "htrsrc.h"
+
+#define HTR_WORKERS_MAX  256
+
+// each worker may run this many jobs ahead of the commit point
+#define HTR_SLOTS_PER_WORKER 2
+
+// runs in a worker thread, must only touch rfile_info_ctx
+typedef int  (*htr_pool_extract_fn) (void *userdata, rfile_info_ctx_t *rfile_info_ctx);
+
+// runs in the calling thread, strictly in input order
+typedef void (*htr_pool_commit_fn)  (void *userdata, rfile_info_ctx_t *rfile_info_ctx, int rc);
+
+struct htr_pool_slot {
+  rfile_info_ctx_t rfile_info_ctx;
+
+  int  rc;
+  bool done;
+};
+
+typedef struct htr_pool_slot htr_pool_slot_t;
+
+struct htr_pool {
+  u32 workers_cnt;
+  u32 slots_cnt;
+
+  pthread_t       *workers;
+  htr_pool_slot_t *slots;
+  u32              slots_init_cnt;  // slots with their rfile_info_ctx set up, the ones to tear down
+
+  // pulled from by the workers, under mux
+
+  htr_src_t *src;
+  bool       src_done;
+
+  // next job to hand out, next job to commit
+
+  u64 next_idx;
+  u64 commit_idx;
+
+  pthread_mutex_t mux;
+  pthread_cond_t  cond_done;
+  pthread_cond_t  cond_free;
+
+  htr_pool_extract_fn extract;
+  htr_pool_commit_fn  commit;
+  void               *userdata;
+};
+
+typedef struct htr_pool htr_pool_t;
+
+int htr_pool_run (u32 workers_cnt, htr_src_t *src, htr_pool_extract_fn extract, htr_pool_commit_fn commit, void *userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HTRPOOL_H
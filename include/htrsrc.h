@@ -0,0 +1,75 @@
+#ifndef _HTRSRC_H
+#define _HTRSRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * input enumeration
+ *
+ * paths come from the command line operands, then from a manifest (a file
+ * or stdin, one path per line or NUL-delimited), directories among them
+ * are walked recursively, one entry at a time, so the pool can start on
+ * the first file while the rest of a large tree is still unread
+ */
+
+#define HTR_SRC_STDIN        "-"
+#define HTR_SRC_DEPTH_MAX    64           // open directories at once, deeper ones are skipped
+#define HTR_SRC_DENTS_BUFSIZ (32 * 1024)  // one getdents64 () call
+
+struct htr_src_dir {
+  size_t path_len;   // of the directory's path in htr_src_t.path, without the trailing '/'
+
+#if defined (__linux__)
+  int    fd;
+  u8    *dents;
+  size_t dents_pos;
+  size_t dents_len;
+#else
+  void  *dir;        // DIR *
+#endif
+};
+
+typedef struct htr_src_dir htr_src_dir_t;
+
+struct htr_src {
+  char **operands;
+  u32    operands_cnt;
+  u32    operand_idx;
+
+  // -f FILE, read once the operands are used up
+
+  const char *manifest_fpath;
+  bool        manifest_done;
+
+  FILE  *manifest;
+  char   delim;
+  char  *line;
+  size_t line_size;
+
+  htr_src_dir_t dirs[HTR_SRC_DEPTH_MAX];
+  u32           dirs_cnt;
+
+  char path[FILE_PATH_MAXLEN];
+
+  u64 files_cnt;
+};
+
+typedef struct htr_src htr_src_t;
+
+void htr_src_init (htr_src_t *src, char **operands, const u32 operands_cnt, const char *manifest_fpath, const bool null_delim);
+
+void htr_src_destory (htr_src_t *src);
+
+// 1 fpath is the next file, 0 no more files, errors on single entries are printed and skipped
+int  htr_src_next (htr_src_t *src, char *fpath, const size_t fpath_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HTRSRC_H
@@ -21,11 +21,23 @@ typedef struct crack_info_inicfg crack_info_inicfg_t;
 
 struct inicfg_ctx {
   CSimpleIniA *inifile_ptr;
-  FILE *tmplock;
+  FILE *tmplock;  // opened read only, share locked while it is parsed
 };
 
 typedef struct inicfg_ctx inicfg_ctx_t;
 
-int read_htr_config_file (htr_config_inicfg_t *inicfg, char *htr_config_fpath);
+// [Output_HCHash_Files], keys are the names of the first config files
+// ("rar3"), hash modes ("12501") or globs of them ("125*", "*" for
+// everything else), values the outfiles
+//
+// the file is never written, once loaded the routes do not change and may
+// be read from any thread without locking
+
+int read_htr_config_file (htr_config_inicfg_t *inicfg, const char *htr_config_fpath);
+
+void htr_config_inicfg_destory (htr_config_inicfg_t *inicfg);
+
+// sink index of hash_mode, -1 if its hashes go nowhere
+int htr_config_route (const htr_config_inicfg_t *inicfg, const int hash_mode);
 
 #endif
@@ -0,0 +1,103 @@
+#ifndef _OFFICE2HC_H
+#define _OFFICE2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * native replacement for office2john.py, Office 2007 / 2010 / 2013 only
+ *
+ * encrypted OOXML files are compound files (CFB) with an EncryptionInfo
+ * stream next to the EncryptedPackage, this reads the header, looks the
+ * stream up in the directory tree and follows its sector chain, nothing
+ * else of the file is touched
+ *
+ * compound files without EncryptionInfo are Office 97-2003 documents, or
+ * not documents at all. only the encryption flag of the Word, Excel or
+ * PowerPoint stream is read, encrypted ones are reported as unsupported,
+ * anything that can not be told is an error, never unencrypted
+ */
+
+#define CFB_SIGNATURE        "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1"
+
+#define CFB_HEADER_LEN       512
+#define CFB_DIFAT_HEADER_CNT 109
+#define CFB_DIRENT_LEN       128
+
+#define CFB_MAXREGSECT       0xfffffffa
+#define CFB_ENDOFCHAIN       0xfffffffe
+#define CFB_NOSTREAM         0xffffffff
+
+#define CFB_TYPE_STREAM      2
+
+// Office 97-2003 encryption flags
+
+#define WORD_FIB_ENCRYPTED   0x0100       // FibBase.fEncrypted
+#define BIFF_FILEPASS        0x002f
+#define BIFF_EOF             0x000a
+#define PPT_TOKEN_ENCRYPTED  0xf3d1c4df   // CurrentUserAtom.headerToken
+
+// EncryptionInfo is a few KB at most, the package itself is never read
+
+#define OFFICE2HC_STREAM_MAXLEN (1024 * 1024)
+
+// the flags are all near the start of their stream
+
+#define OFFICE2HC_LEGACY_HEADLEN 4096
+
+typedef enum office2hc_legacy
+{
+  OFFICE2HC_LEGACY_WORD       = 0,
+  OFFICE2HC_LEGACY_EXCEL      = 1,
+  OFFICE2HC_LEGACY_POWERPOINT = 2,
+
+} office2hc_legacy_t;
+
+#define OFFICE2HC_PASSWORD_NS "http://schemas.microsoft.com/office/2006/keyEncryptor/password"
+
+struct office2hc_info {
+  int version;     // 2007, 2010 or 2013, 0 if the file is not encrypted
+  u32 spin_count;
+  u32 key_bits;
+  u32 salt_size;
+};
+
+typedef struct office2hc_info office2hc_info_t;
+
+struct office2hc_ctx {
+  const char *fpath;
+
+  const u8 *buf;
+  size_t    len;
+
+  u32 sect_size;
+  u32 mini_sect_size;
+  u32 mini_cutoff;
+
+  // sectors in the file, every chain walk is bounded by it against loops
+
+  u32 sect_cnt;
+
+  u32 dir_start;
+  u32 minifat_start;
+  u32 difat_start;
+  u32 difat_cnt;
+
+  // the mini stream is the root entry's stream
+
+  u32 ministream_start;
+};
+
+typedef struct office2hc_ctx office2hc_ctx_t;
+
+int office2hc_extract (const jmprobe_t *probe, membuf_t *out, office2hc_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _OFFICE2HC_H
@@ -0,0 +1,62 @@
+#ifndef _PDF2HC_H
+#define _PDF2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * native replacement for pdf2hashcat.py, prints the same $pdf$ line
+ *
+ * the file is mapped, and only what is needed to get to the /Encrypt
+ * dictionary is parsed: startxref, the xref sections (tables or streams)
+ * along the /Prev chain, and the one object (or object stream) holding it
+ */
+
+#define PDF2HC_TAIL_LEN       1024  // startxref is searched for in this many bytes at the end
+#define PDF2HC_SECTIONS_MAX   64    // xref sections followed along /Prev, against loops
+#define PDF2HC_DEPTH_MAX      32    // nesting of arrays and dictionaries
+#define PDF2HC_STRING_MAXLEN  1024
+#define PDF2HC_INFLATE_MAX    (64 * 1024 * 1024) // decoded size of one stream
+
+// one xref entry, type 1 is (offset, gen), type 2 is (object stream, index)
+
+struct pdf2hc_xref_entry {
+  u32 type;
+  u64 field2;
+  u64 field3;
+};
+
+typedef struct pdf2hc_xref_entry pdf2hc_xref_entry_t;
+
+struct pdf2hc_ctx {
+  const char *fpath;
+
+  const u8 *buf;
+  size_t    len;
+
+  int spec_major;
+  int spec_minor;
+
+  // startxref, 0 if the xref could not be used and objects are searched for instead
+
+  size_t startxref;
+
+  // decoded stream data, the xref stream and object stream being looked at
+
+  membuf_t xrefstm;
+  membuf_t objstm;
+};
+
+typedef struct pdf2hc_ctx pdf2hc_ctx_t;
+
+int pdf2hc_extract (const jmprobe_t *probe, membuf_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _PDF2HC_H
@@ -0,0 +1,76 @@
+#ifndef _RAR2HC_H
+#define _RAR2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * in-process port of JohnTheRipper's rar2john (src/rar2john.c),
+ * prints the same line rar2john would, but into a membuf_t
+ */
+
+#define RAR2HC_CHUNK_SIZE    4096
+#define RAR2HC_LINE_SIZE     0x400
+
+// rar5 constants
+
+#define RAR5_HFL_EXTRA              1
+#define RAR5_HFL_DATA               2
+
+#define RAR5_CRYPT_VERSION          0
+#define RAR5_CHFL_CRYPT_PSWCHECK    1
+#define RAR5_KDF_LG2_COUNT_MAX      24
+#define RAR5_SIZE_SALT50            16
+#define RAR5_SIZE_PSWCHECK          8
+#define RAR5_SIZE_PSWCHECK_CSUM     4
+#define RAR5_SIZE_INITV             16
+
+#define RAR5_HEAD_MARK              0x00
+#define RAR5_HEAD_MAIN              0x01
+#define RAR5_HEAD_FILE              0x02
+#define RAR5_HEAD_SERVICE           0x03
+#define RAR5_HEAD_CRYPT             0x04
+#define RAR5_HEAD_ENDARC            0x05
+
+#define RAR5_MHFL_VOLNUMBER         0x0002
+
+#define RAR5_FHFL_UTIME             0x0002
+#define RAR5_FHFL_CRC32             0x0004
+
+#define RAR5_FHEXTRA_CRYPT          0x01
+#define RAR5_FHEXTRA_CRYPT_PSWCHECK 0x01
+
+// everything rar2john kept in file-scope statics lives here, one per call
+
+struct rar2hc_ctx {
+  const char *archive_name;
+  const char *base_aname;
+
+  membuf_t *out;
+
+  bool done;
+
+  // rar5
+
+  bool encrypted;
+  bool use_pswcheck;
+
+  u32  rar5_iterations;
+
+  u8   rar5_salt[RAR5_SIZE_SALT50];
+  u8   pswcheck[RAR5_SIZE_PSWCHECK];
+};
+
+typedef struct rar2hc_ctx rar2hc_ctx_t;
+
+int rar2hc_extract (const jmprobe_t *probe, membuf_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RAR2HC_H
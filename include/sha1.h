@@ -0,0 +1,43 @@
+#ifndef _SHA1_H
+#define _SHA1_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * sha1, streaming
+ *
+ * only used to tell file contents apart (the extraction cache), not for
+ * anything that has to resist an attacker
+ */
+
+#define SHA1_BLOCK_LEN  64
+#define SHA1_DIGEST_LEN 20
+
+struct sha1_ctx {
+  u32 state[5];
+  u64 len;      // bytes hashed so far
+
+  u8  block[SHA1_BLOCK_LEN];
+};
+
+typedef struct sha1_ctx sha1_ctx_t;
+
+void sha1_init   (sha1_ctx_t *ctx);
+
+void sha1_update (sha1_ctx_t *ctx, const void *data, size_t len);
+
+void sha1_final  (sha1_ctx_t *ctx, u8 digest[SHA1_DIGEST_LEN]);
+
+// the whole file, mapped
+int  sha1_probe  (const jmprobe_t *probe, u8 digest[SHA1_DIGEST_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SHA1_H
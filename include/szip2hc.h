@@ -0,0 +1,153 @@
+#ifndef _SZIP2HC_H
+#define _SZIP2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * native replacement for 7z2hashcat.pl, prints the same $7z$ line
+ *
+ * the archive is mapped and only the headers are parsed, an encoded (LZMA
+ * or LZMA2 compressed) header is unpacked with the LZMA SDK vendored in
+ * deps/hashcat, the first AES-256 + SHA-256 coder found gives the hash
+ */
+
+#define SZIP2HC_MAGIC          "7z\xbc\xaf\x27\x1c"
+#define SZIP2HC_MAGIC_LEN      6
+#define SZIP2HC_SIGNATURE_LEN  32   // magic, version, start header crc, next header offset / size / crc
+
+#define SZIP2HC_SFX_ALIGN      512  // sfx stubs put the archive on a sector boundary
+#define SZIP2HC_CODEC_ID_MAXLEN 8
+#define SZIP2HC_STREAMS_MAX    64   // coders and coder streams in one folder, as in 7-Zip
+#define SZIP2HC_DEFAULT_POWER  19
+#define SZIP2HC_IV_LEN         16
+
+#define SZIP2HC_HEADER_MAXLEN  (64 * 1024 * 1024) // unpacked size of an encoded header
+#define SZIP2HC_DATA_LIMIT     655056             // longest hex data hashcat accepts
+
+// the number after $7z$, what has to be done to the data after decrypting it
+
+#define SZIP2HC_UNCOMPRESSED   0
+#define SZIP2HC_LZMA1          1
+#define SZIP2HC_LZMA2          2
+#define SZIP2HC_PPMD           3
+#define SZIP2HC_BCJ            4
+#define SZIP2HC_BCJ2           5
+#define SZIP2HC_BZIP2          6
+#define SZIP2HC_DEFLATE        7
+
+// property ids
+
+#define SZIP2HC_ID_END               0x00
+#define SZIP2HC_ID_HEADER            0x01
+#define SZIP2HC_ID_ARCHIVE_PROPS     0x02
+#define SZIP2HC_ID_ADD_STREAMS_INFO  0x03
+#define SZIP2HC_ID_MAIN_STREAMS_INFO 0x04
+#define SZIP2HC_ID_PACK_INFO         0x06
+#define SZIP2HC_ID_UNPACK_INFO       0x07
+#define SZIP2HC_ID_SUBSTREAMS_INFO   0x08
+#define SZIP2HC_ID_SIZE              0x09
+#define SZIP2HC_ID_CRC               0x0a
+#define SZIP2HC_ID_FOLDER            0x0b
+#define SZIP2HC_ID_CODERS_UNPACK_SIZE 0x0c
+#define SZIP2HC_ID_NUM_UNPACK_STREAM 0x0d
+#define SZIP2HC_ID_ENCODED_HEADER    0x17
+
+// cursor over a header, the raw one in the file or an unpacked one
+
+struct szip2hc_reader {
+  const u8 *buf;
+  size_t    len;
+  size_t    pos;
+};
+
+typedef struct szip2hc_reader szip2hc_reader_t;
+
+struct szip2hc_coder {
+  u8  id[SZIP2HC_CODEC_ID_MAXLEN];
+  u32 id_len;
+
+  // points into the header the coder was read from
+
+  const u8 *props;
+  u64       props_len;
+};
+
+typedef struct szip2hc_coder szip2hc_coder_t;
+
+struct szip2hc_folder {
+  u64 first_coder;
+  u64 coder_cnt;
+
+  // coder outputs, the unpack sizes of a folder are listed per output
+
+  u64 first_out;
+  u64 out_cnt;
+  u64 main_out;
+};
+
+typedef struct szip2hc_folder szip2hc_folder_t;
+
+struct szip2hc_digest {
+  u32 crc;
+  int defined;
+};
+
+typedef struct szip2hc_digest szip2hc_digest_t;
+
+struct szip2hc_streams {
+  u64  pack_pos;
+  u64  pack_cnt;
+  u64 *pack_sizes;
+
+  u64               folder_cnt;
+  szip2hc_folder_t *folders;
+
+  // szip2hc_coder_t entries of all folders, grown while reading
+
+  u64      coder_cnt;
+  membuf_t coders;
+
+  u64  unpack_cnt;
+  u64 *unpack_sizes;
+
+  // folder crcs, only if the unpack info lists them
+
+  u64               digest_cnt;
+  szip2hc_digest_t *digests;
+
+  // the files inside the folders
+
+  u64  sub_size_cnt;
+  u64 *sub_sizes;
+
+  u64               sub_digest_cnt;
+  szip2hc_digest_t *sub_digests;
+};
+
+typedef struct szip2hc_streams szip2hc_streams_t;
+
+struct szip2hc_ctx {
+  const char *fpath;
+
+  const u8 *buf;
+  size_t    len;
+
+  // where the pack streams start, right after the signature header
+
+  size_t data_offset;
+};
+
+typedef struct szip2hc_ctx szip2hc_ctx_t;
+
+int szip2hc_extract (const jmprobe_t *probe, membuf_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SZIP2HC_H
@@ -14,7 +14,6 @@ extern "C" {
 #define BUF_MAXLEN 8192
 
 
-#define FILES_MAX       256
 #define FILE_PATH_MAXLEN 512
 
 
@@ -33,6 +32,7 @@ extern "C" {
 
 #define TCPDUMP_MAGIC "\xa1\xb2\xc3\xd4"
 #define TCPDUMP_CIGAM "\xd4\xc3\xb2\xa1"
+#define PCAPNG_MAGIC  "\x0a\x0d\x0d\x0a"
 
 // pptp des
 
@@ -185,34 +185,125 @@ struct pcap_file_header {
   u32 linktype; /* data link type (LINKTYPE_*) */
 };
 
-struct unknown_file_header {
-  char magic[10];
+// bump allocator, whatever was taken from it is given back at once
+
+struct jmarena_chunk {
+  struct jmarena_chunk *next;
+
+  size_t size;
+  size_t used;
+
+  // data follows
+};
+
+typedef struct jmarena_chunk jmarena_chunk_t;
+
+struct jmarena {
+  jmarena_chunk_t *head;
+
+  size_t chunk_size;
 };
 
-typedef struct unknown_file_header unknown_file_header_t;
+typedef struct jmarena jmarena_t;
+
+// an input file, opened and stat'ed once, detection and the converters
+// all work from it instead of opening the path again
+
+#ifndef JMPROBE_HEAD_LEN
+#define JMPROBE_HEAD_LEN 4096
+#endif
+
+struct jmprobe {
+  const char *fpath;
+
+  int fd;     // -1 if not open
+
+  u64 size;
+  u64 dev;
+  u64 ino;
+  u64 mtime;  // ns since the epoch, as precise as the filesystem keeps it
+
+  // the first bytes of the file, less if the file is shorter
+
+  u8     head[JMPROBE_HEAD_LEN];
+  size_t head_len;
+};
+
+typedef struct jmprobe jmprobe_t;
+
+// a hash, len bytes at val. built ones are in the arena and 0-terminated at
+// val[len], a raw hash file's is its mapping and is not
+
+struct hash_rec {
+  size_t      len;
+  const char *val;
+};
+
+typedef struct hash_rec hash_rec_t;
 
 struct hash_ctx
 {
   bool  is_valid;
 
-  char  hash_val[BUF_MAXLEN];
-  int   len;
-  int   hash_mode;
+  // NULL until a hash was extracted, lives in arena
+
+  hash_rec_t *hash;
+  int         hash_mode;
+
+  // rewound for every file, released with the ctx
+
+  jmarena_t   arena;
+
+  // a raw hash file, hash points into it until the next reset
+
+  struct jmmap *map;
 
   // char  checksum[32];
 };
 
 typedef struct hash_ctx hash_ctx_t;
 
+// what the extraction cache made of a file, see htrcache.h
+
+#define RFILE_DIGEST_LEN 20   // sha1
+
+enum rfile_cache_state {
+  RFILE_CACHE_OFF=0,          // no cache, or the file could not be digested
+  RFILE_CACHE_MISS=1,         // extracted, digest is set
+  RFILE_CACHE_HIT_STAT=2,     // served, same file as last time
+  RFILE_CACHE_HIT_DIGEST=3,   // served, same content as a cached file
+};
+
+typedef enum rfile_cache_state rfile_cache_state_t;
+
+struct rfile_cache_info {
+  rfile_cache_state_t state;
+
+  u64 stamp;                  // when the file was looked at, seconds since the epoch
+  u64 path_hash;
+
+  u8  digest[RFILE_DIGEST_LEN];
+};
+
+typedef struct rfile_cache_info rfile_cache_info_t;
+
 struct rfile_info_ctx {
   file_encryption_t file_encryption;
 
-  char tmp_fpath[BUF_MINLEN];
-
   char type[16];
   char version[16];
   char path[FILE_PATH_MAXLEN];
 
+  // path is opened once, by get_rw_rfile_ftype ()
+
+  jmprobe_t probe;
+
+  // where the type's signature starts, not 0 behind an sfx stub
+
+  u64 magic_offset;
+
+  rfile_cache_info_t cache;
+
   hash_ctx_t *hash_ctx;
 };
 
@@ -228,11 +319,28 @@ struct htr_user_options {
 
   char  *config_fpath;
 
+  // operands, files or directories, "-" reads paths from stdin
+
   char **tbc_fpaths;
   u32    tbc_fpaths_cnt;
 
+  // -f, more paths, one per line or NUL-delimited with -0
+
+  char  *manifest_fpath;
+  bool   null_delim;
+
   char  *out_fpath;
 
+  u32    workers_cnt;
+
+  // -C, extraction cache file
+
+  char  *cache_fpath;
+
+  // -W, best wpa handshakes per station, 0 for all
+
+  u32    wpa_best_cnt;
+
   bool usage;
 
   // char *unftd_hash_fpath;
@@ -247,6 +355,16 @@ struct htr_ctx {
   const char *log_fpath;
   int valid_hashes_cnt;
 
+  struct htr_src *src;
+
+  // -C, NULL without one
+
+  struct htr_cache *cache;
+
+  // copies within the run
+
+  struct htr_dedup *dedup;
+
   htr_user_options_t *user_options;
   rfile_info_ctx_t *rfile_info_ctx;
 };
@@ -255,21 +373,21 @@ typedef struct htr_ctx htr_ctx_t;
 
 
 
+// config mode, which outfile the hashes of each mode go to
+
+#define HTR_ROUTE_MODES 100000  // routed through a flat table, larger modes only reach the default
+
 struct htr_config_inicfg {
-  char wpa2500[BUF_MINLEN];
-  char office9400[BUF_MINLEN];
-  char office9500[BUF_MINLEN];
-  char office9600[BUF_MINLEN];
-  char pdf10400[BUF_MINLEN];
-  char pdf10410[BUF_MINLEN];
-  char pdf10420[BUF_MINLEN];
-  char pdf10500[BUF_MINLEN];
-  char pdf10600[BUF_MINLEN];
-  char pdf10700[BUF_MINLEN];
-  char szip11600[BUF_MINLEN];
-  char rar12500[BUF_MINLEN];
-  char rar13000[BUF_MINLEN];
-  char pkzip13600[BUF_MINLEN];
+  // distinct outfiles
+
+  char **sinks;
+  u32    sinks_cnt;
+
+  // per mode, sink index + 1, 0 for none, globs and the default already applied
+
+  u16   *route;
+
+  u32    default_sink;  // sink index + 1 of "*", for modes past the table
 };
 
 typedef struct htr_config_inicfg htr_config_inicfg_t;
@@ -0,0 +1,108 @@
+#ifndef _ZIP2HC_H
+#define _ZIP2HC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "types.h"
+
+/*
+ * in-process port of JohnTheRipper's zip2john (src/zip2john.c)
+ *
+ * unlike zip2john the hash is returned bare, without the leading
+ * "archive:" and the trailing ":::::name" fields, the rest of the
+ * zip2john line comes back as structured data in zip2hc_info_t
+ */
+
+#define ZIP2HC_FNAME_MAXLEN    1024
+#define ZIP2HC_HASHES_MAX      3
+
+#define ZIP2HC_AES_EXTRA_LEN   11
+#define ZIP2HC_AES_AUTH_LEN    10
+
+#define ZIP2HC_LOCAL_HEADER    0x04034b50UL
+#define ZIP2HC_DATA_DESCRIPTOR 0x08074b50UL
+#define ZIP2HC_CENTRAL_DIR     0x02014b50UL
+#define ZIP2HC_END_CENTRAL_DIR 0x06054b50UL
+
+typedef enum zip2hc_kind
+{
+  ZIP2HC_KIND_NONE   = 0,
+  ZIP2HC_KIND_AES    = 1, // $zip2$, WinZip AES
+  ZIP2HC_KIND_STRONG = 2, // $zip3$, PKWARE strong encryption
+  ZIP2HC_KIND_PKZIP  = 3, // $pkzip2$, traditional ZipCrypto
+
+} zip2hc_kind_t;
+
+// the entry the hash was taken from
+
+struct zip2hc_info {
+  zip2hc_kind_t kind;
+
+  char fname[ZIP2HC_FNAME_MAXLEN];
+
+  u16  cmptype;      // compression method of the entry, for AES the actual one
+  u64  offset;       // offset of the local header
+  u64  offex;        // offset of the data, relative to the local header
+  u64  cmp_len;
+  u64  decomp_len;
+  u32  crc;
+
+  u8   aes_strength; // 1 2 3 for 128/192/256 bit
+  u32  hashes_cnt;   // pkzip only, number of entries in the hash
+};
+
+typedef struct zip2hc_info zip2hc_info_t;
+
+// one traditional pkzip entry, zip2john's zip_ptr
+
+struct zip2hc_blob {
+  u8  *hash_data;
+
+  u32  crc;
+  u64  offset;
+  u64  offex;
+  u64  cmp_len;
+  u64  decomp_len;
+  u16  cmptype;
+
+  char chksum[5];
+  char chksum2[5];
+
+  char fname[ZIP2HC_FNAME_MAXLEN];
+};
+
+typedef struct zip2hc_blob zip2hc_blob_t;
+
+// everything zip2john kept in statics or locals across entries, one per call
+
+struct zip2hc_ctx {
+  const char *archive_name;
+
+  FILE *fp;
+
+  membuf_t *out;
+
+  zip2hc_info_t *info;
+
+  // pkzip only
+
+  int check_in_crc;
+  int check_bytes;
+
+  zip2hc_blob_t hashes[ZIP2HC_HASHES_MAX];
+
+  u32 hashes_cnt;
+};
+
+typedef struct zip2hc_ctx zip2hc_ctx_t;
+
+int zip2hc_extract (const jmprobe_t *probe, membuf_t *out, zip2hc_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _ZIP2HC_H
@@ -0,0 +1,2028 @@
+/*
+ * cap2hc, in-process version of cap2hccapx.
+ *
+ * Based on cap2hccapx.c from hashcat-utils:
+ *   Autor.......: Jens Steube <jens.steube@gmail.com>, Philipp "philsmd" Schmidt <philsmd@hashcat.net>
+ *   License.....: MIT
+ *
+ * The hccapx records are the same cap2hccapx writes, they are appended to
+ * a membuf_t instead of a file. The essid and eapol databases live in a
+ * cap2hc_ctx_t and grow on demand instead of being allocated at their
+ * maximum size on every run.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "cap2hc.h"
+
+#if defined (_POSIX)
+#include <sys/mman.h>
+#endif
+
+static u8 hex_convert (const u8 c)
+{
+  return (c & 15) + (c >> 6) * 9;
+}
+
+static u8 hex_to_u8 (const u8 hex[2])
+{
+  u8 v = 0;
+
+  v |= ((u8) hex_convert (hex[1]) << 0);
+  v |= ((u8) hex_convert (hex[0]) << 4);
+
+  return (v);
+}
+
+static u16 byte_swap_16 (const u16 n)
+{
+  return (n & 0xff00) >> 8
+       | (n & 0x00ff) << 8;
+}
+
+static u32 byte_swap_32 (const u32 n)
+{
+  return (n & 0xff000000) >> 24
+       | (n & 0x00ff0000) >>  8
+       | (n & 0x0000ff00) <<  8
+       | (n & 0x000000ff) << 24;
+}
+
+static u64 byte_swap_64 (const u64 n)
+{
+  return (n & 0xff00000000000000ULL) >> 56
+       | (n & 0x00ff000000000000ULL) >> 40
+       | (n & 0x0000ff0000000000ULL) >> 24
+       | (n & 0x000000ff00000000ULL) >>  8
+       | (n & 0x00000000ff000000ULL) <<  8
+       | (n & 0x0000000000ff0000ULL) << 24
+       | (n & 0x000000000000ff00ULL) << 40
+       | (n & 0x00000000000000ffULL) << 56;
+}
+
+static int comp_excpkt (const excpkt_t *e1, const excpkt_t *e2)
+{
+  const int excpkt_diff = e1->excpkt_num - e2->excpkt_num;
+
+  if (excpkt_diff != 0) return excpkt_diff;
+
+  const int rc_nonce = memcmp (e1->nonce, e2->nonce, 32);
+
+  if (rc_nonce != 0) return rc_nonce;
+
+  const int rc_mac_ap = memcmp (e1->mac_ap, e2->mac_ap, 6);
+
+  if (rc_mac_ap != 0) return rc_mac_ap;
+
+  const int rc_mac_sta = memcmp (e1->mac_sta, e2->mac_sta, 6);
+
+  if (rc_mac_sta != 0) return rc_mac_sta;
+
+  if (e1->replay_counter < e2->replay_counter) return  1;
+  if (e1->replay_counter > e2->replay_counter) return -1;
+
+  return 0;
+}
+
+/**************************************************************************
+ * hash indexes
+ *************************************************************************/
+
+#define CAP2HC_INDEX_MIN 16
+
+// fnv-1a
+static u64 cap2hc_hash (u64 h, const void *data, const size_t len)
+{
+  const u8 *p = (const u8 *) data;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ull;
+  }
+
+  return h;
+}
+
+#define CAP2HC_HASH_INIT 0xcbf29ce484222325ull
+
+static u64 hash_bssid (const u8 bssid[6])
+{
+  return cap2hc_hash (CAP2HC_HASH_INIT, bssid, 6);
+}
+
+static u64 hash_macs (const u8 mac_ap[6], const u8 mac_sta[6])
+{
+  return cap2hc_hash (cap2hc_hash (CAP2HC_HASH_INIT, mac_ap, 6), mac_sta, 6);
+}
+
+// all of what comp_excpkt () compares
+static u64 hash_excpkt (const excpkt_t *excpkt)
+{
+  u64 h = hash_macs (excpkt->mac_ap, excpkt->mac_sta);
+
+  h = cap2hc_hash (h, &excpkt->excpkt_num, sizeof (excpkt->excpkt_num));
+  h = cap2hc_hash (h, &excpkt->replay_counter, sizeof (excpkt->replay_counter));
+  h = cap2hc_hash (h, excpkt->nonce, 32);
+
+  return h;
+}
+
+static void cap2hc_index_free (cap2hc_index_t *index)
+{
+  free (index->slots);
+
+  index->slots = NULL;
+  index->size  = 0;
+}
+
+static void cap2hc_index_clear (cap2hc_index_t *index)
+{
+  if (index->slots != NULL) memset (index->slots, 0, index->size * sizeof (u32));
+}
+
+// sized for at least cnt entries at most half full, the slots are cleared
+static int cap2hc_index_alloc (cap2hc_index_t *index, const u32 cnt)
+{
+  u32 size = CAP2HC_INDEX_MIN;
+
+  while (size / 2 < cnt) size *= 2;
+
+  u32 *slots = (u32 *) calloc (size, sizeof (u32));
+
+  if (slots == NULL)
+  {
+    fprintf (stderr, "%s: %s\n", __func__, strerror (errno));
+
+    return -1;
+  }
+
+  free (index->slots);
+
+  index->slots = slots;
+  index->size  = size;
+
+  return 1;
+}
+
+// the slot of the essid with this bssid, or the free one it would go to
+static u32 *essid_slot (const cap2hc_ctx_t *ctx, const cap2hc_index_t *index, const u8 bssid[6])
+{
+  const u32 mask = index->size - 1;
+
+  for (u32 pos = (u32) hash_bssid (bssid) & mask;; pos = (pos + 1) & mask)
+  {
+    u32 *slot = &index->slots[pos];
+
+    if (*slot == 0) return slot;
+
+    if (memcmp (ctx->essids[*slot - 1].bssid, bssid, 6) == 0) return slot;
+  }
+}
+
+static u32 *excpkt_slot (const cap2hc_ctx_t *ctx, const cap2hc_index_t *index, const excpkt_t *excpkt)
+{
+  const u32 mask = index->size - 1;
+
+  for (u32 pos = (u32) hash_excpkt (excpkt) & mask;; pos = (pos + 1) & mask)
+  {
+    u32 *slot = &index->slots[pos];
+
+    if (*slot == 0) return slot;
+
+    if (comp_excpkt (&ctx->excpkts[*slot - 1], excpkt) == 0) return slot;
+  }
+}
+
+// grows a database by doubling, never beyond its limit
+static int db_grow (void **db, u32 *avail, const u32 init, const u32 limit, const size_t elem_size)
+{
+  u32 new_avail = (*avail == 0) ? init : *avail * 2;
+
+  if (new_avail > limit) new_avail = limit;
+
+  void *new_db = realloc (*db, (size_t) new_avail * elem_size);
+
+  if (new_db == NULL)
+  {
+    fprintf (stderr, "%s: %s\n", __func__, strerror (errno));
+
+    return -1;
+  }
+
+  *db    = new_db;
+  *avail = new_avail;
+
+  return 1;
+}
+
+static int db_excpkt_add (cap2hc_ctx_t *ctx, excpkt_t *excpkt, const u32 tv_sec, const u32 tv_usec, const u8 mac_ap[6], const u8 mac_sta[6])
+{
+  excpkt->tv_sec  = tv_sec;
+  excpkt->tv_usec = tv_usec;
+
+  memcpy (excpkt->mac_ap,  mac_ap,  6);
+  memcpy (excpkt->mac_sta, mac_sta, 6);
+
+  if (ctx->excpkts_cnt == DB_EXCPKT_MAX)
+  {
+    fprintf (stderr, "Too many excpkt in dumpfile, aborting...\n");
+
+    return -1;
+  }
+
+  // one more must still leave the index at most half full
+
+  if ((ctx->excpkts_cnt + 1) > ctx->excpkts_by_key.size / 2)
+  {
+    if (cap2hc_index_alloc (&ctx->excpkts_by_key, ctx->excpkts_cnt + 1) == -1) return -1;
+
+    for (u32 i = 0; i < ctx->excpkts_cnt; i++)
+    {
+      *excpkt_slot (ctx, &ctx->excpkts_by_key, &ctx->excpkts[i]) = i + 1;
+    }
+  }
+
+  u32 *slot = excpkt_slot (ctx, &ctx->excpkts_by_key, excpkt);
+
+  if (*slot != 0) return 1;
+
+  if (ctx->excpkts_cnt == ctx->excpkts_avail)
+  {
+    if (db_grow ((void **) &ctx->excpkts, &ctx->excpkts_avail, DB_EXCPKT_INIT, DB_EXCPKT_MAX, sizeof (excpkt_t)) == -1) return -1;
+  }
+
+  memcpy (&ctx->excpkts[ctx->excpkts_cnt++], excpkt, sizeof (excpkt_t));
+
+  *slot = ctx->excpkts_cnt;
+
+  return 1;
+}
+
+static int db_essid_add (cap2hc_ctx_t *ctx, essid_t *essid, const u8 addr3[6], const int essid_source)
+{
+  if (essid->essid_len == 0) return 1;
+
+  if (essid->essid[0] == 0) return 1;
+
+  memcpy (essid->bssid, addr3, 6);
+
+  if (ctx->essids_cnt == DB_ESSID_MAX)
+  {
+    fprintf (stderr, "Too many essid in dumpfile, aborting...\n");
+
+    return -1;
+  }
+
+  if ((ctx->essids_cnt + 1) > ctx->essids_by_bssid.size / 2)
+  {
+    if (cap2hc_index_alloc (&ctx->essids_by_bssid, ctx->essids_cnt + 1) == -1) return -1;
+
+    for (u32 i = 0; i < ctx->essids_cnt; i++)
+    {
+      *essid_slot (ctx, &ctx->essids_by_bssid, ctx->essids[i].bssid) = i + 1;
+    }
+  }
+
+  u32 *slot = essid_slot (ctx, &ctx->essids_by_bssid, essid->bssid);
+
+  if (*slot != 0)
+  {
+    essid_t *essid_old = &ctx->essids[*slot - 1];
+
+    if (essid_source > essid_old->essid_source)
+    {
+      memcpy (essid_old, essid, sizeof (essid_t));
+
+      essid_old->essid_source = essid_source;
+    }
+
+    return 1;
+  }
+
+  if (ctx->essids_cnt == ctx->essids_avail)
+  {
+    if (db_grow ((void **) &ctx->essids, &ctx->essids_avail, DB_ESSID_INIT, DB_ESSID_MAX, sizeof (essid_t)) == -1) return -1;
+  }
+
+  essid->essid_source = essid_source;
+
+  memcpy (&ctx->essids[ctx->essids_cnt++], essid, sizeof (essid_t));
+
+  *slot = ctx->essids_cnt;
+
+  return 1;
+}
+
+static int handle_llc (const ieee80211_llc_snap_header_t *ieee80211_llc_snap_header)
+{
+  if (ieee80211_llc_snap_header->dsap != IEEE80211_LLC_DSAP) return -1;
+  if (ieee80211_llc_snap_header->ssap != IEEE80211_LLC_SSAP) return -1;
+  if (ieee80211_llc_snap_header->ctrl != IEEE80211_LLC_CTRL) return -1;
+
+  #ifdef BIG_ENDIAN_HOST
+  const u16 ethertype = byte_swap_16 (ieee80211_llc_snap_header->ethertype);
+  #else
+  const u16 ethertype = ieee80211_llc_snap_header->ethertype;
+  #endif
+
+  if (ethertype != IEEE80211_DOT1X_AUTHENTICATION) return -1;
+
+  return 0;
+}
+
+static int handle_auth (const auth_packet_t *auth_packet, const int pkt_offset, const int pkt_size, excpkt_t *excpkt)
+{
+  // eapol is big endian on the wire
+
+  #ifdef BIG_ENDIAN_HOST
+  const u16 ap_length               = auth_packet->length;
+  const u16 ap_key_information      = auth_packet->key_information;
+  const u64 ap_replay_counter       = auth_packet->replay_counter;
+  const u16 ap_wpa_key_data_length  = auth_packet->wpa_key_data_length;
+  #else
+  const u16 ap_length               = byte_swap_16 (auth_packet->length);
+  const u16 ap_key_information      = byte_swap_16 (auth_packet->key_information);
+  const u64 ap_replay_counter       = byte_swap_64 (auth_packet->replay_counter);
+  const u16 ap_wpa_key_data_length  = byte_swap_16 (auth_packet->wpa_key_data_length);
+  #endif
+
+  if (ap_length == 0) return -1;
+
+  // determine handshake exchange number
+
+  int excpkt_num = 0;
+
+  if (ap_key_information & WPA_KEY_INFO_ACK)
+  {
+    if (ap_key_information & WPA_KEY_INFO_INSTALL)
+    {
+      excpkt_num = EXC_PKT_NUM_3;
+    }
+    else
+    {
+      excpkt_num = EXC_PKT_NUM_1;
+    }
+  }
+  else
+  {
+    if (ap_key_information & WPA_KEY_INFO_SECURE)
+    {
+      excpkt_num = EXC_PKT_NUM_4;
+    }
+    else
+    {
+      excpkt_num = EXC_PKT_NUM_2;
+    }
+  }
+
+  // we're only interested in packets carrying a nonce
+
+  char zero[32] = { 0 };
+
+  if (memcmp (auth_packet->wpa_key_nonce, zero, 32) == 0) return -1;
+
+  // copy data
+
+  memcpy (excpkt->nonce, auth_packet->wpa_key_nonce, 32);
+
+  excpkt->replay_counter = ap_replay_counter;
+
+  excpkt->excpkt_num = excpkt_num;
+
+  excpkt->eapol_len = sizeof (auth_packet_t) + ap_wpa_key_data_length;
+
+  if ((pkt_offset + excpkt->eapol_len) > pkt_size) return -1;
+
+  if ((sizeof (auth_packet_t) + ap_wpa_key_data_length) > sizeof (excpkt->eapol)) return -1;
+
+  // we need to copy the auth_packet_t but have to clear the keymic
+
+  auth_packet_t auth_packet_orig;
+
+  memcpy (&auth_packet_orig, auth_packet, sizeof (auth_packet_t));
+
+  memset (auth_packet_orig.wpa_key_mic, 0, 16);
+
+  memcpy (excpkt->eapol, &auth_packet_orig, sizeof (auth_packet_t));
+  memcpy (excpkt->eapol + sizeof (auth_packet_t), auth_packet + 1, ap_wpa_key_data_length);
+
+  memcpy (excpkt->keymic, auth_packet->wpa_key_mic, 16);
+
+  excpkt->keyver = ap_key_information & WPA_KEY_INFO_TYPE_MASK;
+
+  if ((excpkt_num == EXC_PKT_NUM_3) || (excpkt_num == EXC_PKT_NUM_4))
+  {
+    excpkt->replay_counter--;
+  }
+
+  return 0;
+}
+
+static int get_essid_from_tag (const u8 *packet, const pcap_pkthdr_t *header, u32 length_skip, essid_t *essid)
+{
+  if (length_skip > header->caplen) return -1;
+
+  u32 length = header->caplen - length_skip;
+
+  const u8 *beacon = packet + length_skip;
+
+  const u8 *cur = beacon;
+  const u8 *end = beacon + length;
+
+  while (cur < end)
+  {
+    if ((cur + 2) >= end) break;
+
+    u8 tagtype = *cur++;
+    u8 taglen  = *cur++;
+
+    if ((cur + taglen) >= end) break;
+
+    if (tagtype == MFIE_TYPE_SSID)
+    {
+      if (taglen < MAX_ESSID_LEN)
+      {
+        memcpy (essid->essid, cur, taglen);
+
+        essid->essid_len = taglen;
+
+        return 0;
+      }
+    }
+
+    cur += taglen;
+  }
+
+  return -1;
+}
+
+// packet points into the capture, it is read, never written to
+
+static int process_packet (cap2hc_ctx_t *ctx, const u8 *packet, const pcap_pkthdr_t *header)
+{
+  if (header->caplen < sizeof (ieee80211_hdr_3addr_t)) return 1;
+
+  // our first header: ieee80211
+
+  const ieee80211_hdr_3addr_t *ieee80211_hdr_3addr = (const ieee80211_hdr_3addr_t *) packet;
+
+  #ifdef BIG_ENDIAN_HOST
+  const u16 frame_control = byte_swap_16 (ieee80211_hdr_3addr->frame_control);
+  #else
+  const u16 frame_control = ieee80211_hdr_3addr->frame_control;
+  #endif
+
+  if ((frame_control & IEEE80211_FCTL_FTYPE) == IEEE80211_FTYPE_MGMT)
+  {
+    if (memcmp (ieee80211_hdr_3addr->addr3, BROADCAST_MAC, 6) == 0) return 1;
+
+    u32 length_skip  = 0;
+    int essid_source = 0;
+
+    const int stype = frame_control & IEEE80211_FCTL_STYPE;
+
+    switch (stype)
+    {
+    case IEEE80211_STYPE_BEACON:
+      length_skip  = sizeof (ieee80211_hdr_3addr_t) + sizeof (beacon_t);
+      essid_source = ESSID_SOURCE_BEACON;
+      break;
+    case IEEE80211_STYPE_PROBE_REQ:
+      length_skip  = sizeof (ieee80211_hdr_3addr_t);
+      essid_source = ESSID_SOURCE_PROBE;
+      break;
+    case IEEE80211_STYPE_PROBE_RESP:
+      length_skip  = sizeof (ieee80211_hdr_3addr_t) + sizeof (beacon_t);
+      essid_source = ESSID_SOURCE_PROBE;
+      break;
+    case IEEE80211_STYPE_ASSOC_REQ:
+      length_skip  = sizeof (ieee80211_hdr_3addr_t) + sizeof (assocreq_t);
+      essid_source = ESSID_SOURCE_ASSOC;
+      break;
+    case IEEE80211_STYPE_REASSOC_REQ:
+      length_skip  = sizeof (ieee80211_hdr_3addr_t) + sizeof (reassocreq_t);
+      essid_source = ESSID_SOURCE_REASSOC;
+      break;
+    default:
+      return 1;
+    }
+
+    essid_t essid;
+
+    memset (&essid, 0, sizeof (essid_t));
+
+    if (get_essid_from_tag (packet, header, length_skip, &essid) == -1) return 1;
+
+    return db_essid_add (ctx, &essid, ieee80211_hdr_3addr->addr3, essid_source);
+  }
+
+  if ((frame_control & IEEE80211_FCTL_FTYPE) != IEEE80211_FTYPE_DATA) return 1;
+
+  // process header: ieee80211
+
+  int set = 0;
+
+  if (frame_control & IEEE80211_FCTL_TODS)   set++;
+  if (frame_control & IEEE80211_FCTL_FROMDS) set++;
+
+  if (set != 1) return 1;
+
+  // find offset to llc/snap header
+
+  int llc_offset;
+
+  if ((frame_control & IEEE80211_FCTL_STYPE) == IEEE80211_STYPE_QOS_DATA)
+  {
+    llc_offset = sizeof (ieee80211_qos_hdr_t);
+  }
+  else
+  {
+    llc_offset = sizeof (ieee80211_hdr_3addr_t);
+  }
+
+  // process header: the llc/snap header
+
+  if (header->caplen < (llc_offset + sizeof (ieee80211_llc_snap_header_t))) return 1;
+
+  const ieee80211_llc_snap_header_t *ieee80211_llc_snap_header = (const ieee80211_llc_snap_header_t *) &packet[llc_offset];
+
+  if (handle_llc (ieee80211_llc_snap_header) == -1) return 1;
+
+  // process header: the auth header
+
+  const int auth_offset = llc_offset + sizeof (ieee80211_llc_snap_header_t);
+
+  if (header->caplen < (auth_offset + sizeof (auth_packet_t))) return 1;
+
+  const auth_packet_t *auth_packet = (const auth_packet_t *) &packet[auth_offset];
+
+  excpkt_t excpkt;
+
+  memset (&excpkt, 0, sizeof (excpkt_t));
+
+  if (handle_auth (auth_packet, auth_offset, header->caplen, &excpkt) == -1) return 1;
+
+  if ((excpkt.excpkt_num == EXC_PKT_NUM_1) || (excpkt.excpkt_num == EXC_PKT_NUM_3))
+  {
+    return db_excpkt_add (ctx, &excpkt, header->tv_sec, header->tv_usec, ieee80211_hdr_3addr->addr2, ieee80211_hdr_3addr->addr1);
+  }
+
+  return db_excpkt_add (ctx, &excpkt, header->tv_sec, header->tv_usec, ieee80211_hdr_3addr->addr1, ieee80211_hdr_3addr->addr2);
+}
+
+int cap2hc_ctx_init (cap2hc_ctx_t *ctx)
+{
+  memset (ctx, 0, sizeof (cap2hc_ctx_t));
+
+  return 1;
+}
+
+// forget what was found, but keep the databases for the next capture
+void cap2hc_ctx_reset (cap2hc_ctx_t *ctx)
+{
+  ctx->essids_cnt  = 0;
+  ctx->excpkts_cnt = 0;
+
+  cap2hc_index_clear (&ctx->essids_by_bssid);
+  cap2hc_index_clear (&ctx->excpkts_by_key);
+
+  ctx->essid_filter = NULL;
+  ctx->best_cnt     = 0;
+}
+
+void cap2hc_ctx_destory (cap2hc_ctx_t *ctx)
+{
+  free (ctx->essids);
+  free (ctx->excpkts);
+
+  cap2hc_index_free (&ctx->essids_by_bssid);
+  cap2hc_index_free (&ctx->excpkts_by_key);
+
+  memset (ctx, 0, sizeof (cap2hc_ctx_t));
+}
+
+// manual beacon, s is "MyESSID:d110391a58ac" and gets modified
+int cap2hc_add_essid (cap2hc_ctx_t *ctx, char *s)
+{
+  char *man_essid = s;
+  char *man_bssid = strchr (man_essid, ':');
+
+  if (man_bssid == NULL)
+  {
+    fprintf (stderr, "Invalid format (%s), should be: MyESSID:d110391a58ac\n", s);
+
+    return -1;
+  }
+
+  *man_bssid = 0;
+
+  man_bssid++;
+
+  if (strlen (man_essid) >= 32)
+  {
+    fprintf (stderr, "Invalid format (%s), essid is too long\n", s);
+
+    return -1;
+  }
+
+  if (strlen (man_bssid) != 12)
+  {
+    fprintf (stderr, "Invalid format (%s), bssid must have length 12\n", s);
+
+    return -1;
+  }
+
+  essid_t essid;
+
+  memset (&essid, 0, sizeof (essid_t));
+
+  strncpy (essid.essid, man_essid, 32);
+
+  essid.essid_len = strlen (essid.essid);
+
+  u8 bssid[6];
+
+  for (int i = 0; i < 6; i++, man_bssid += 2)
+  {
+    bssid[i] = hex_to_u8 ((u8 *) man_bssid);
+  }
+
+  return db_essid_add (ctx, &essid, bssid, ESSID_SOURCE_USER);
+}
+
+// strips the link layer header in front of a frame and hands the rest to
+// process_packet, 1 next packet, 0 stop walking the capture, -1 error
+
+static int process_frame (cap2hc_ctx_t *ctx, const u32 linktype, const u8 *packet, pcap_pkthdr_t *header, const char *name)
+{
+  if (header->caplen >= TCPDUMP_DECODE_LEN)
+  {
+    fprintf (stderr, "%s: Oversized packet detected\n", name);
+
+    return 0;
+  }
+
+  u32 link_len = 0;
+
+  if (linktype == DLT_IEEE802_11_PRISM)
+  {
+    if (header->caplen < sizeof (prism_header_t))
+    {
+      fprintf (stderr, "%s: Could not read prism header\n", name);
+
+      return 0;
+    }
+
+    const prism_header_t *prism_header = (const prism_header_t *) packet;
+
+    #ifdef BIG_ENDIAN_HOST
+    link_len = byte_swap_32 (prism_header->msglen);
+    #else
+    link_len = prism_header->msglen;
+    #endif
+  }
+  else if (linktype == DLT_IEEE802_11_RADIO)
+  {
+    if (header->caplen < sizeof (ieee80211_radiotap_header_t))
+    {
+      fprintf (stderr, "%s: Could not read radiotap header\n", name);
+
+      return 0;
+    }
+
+    const ieee80211_radiotap_header_t *ieee80211_radiotap_header = (const ieee80211_radiotap_header_t *) packet;
+
+    if (ieee80211_radiotap_header->it_version != 0)
+    {
+      fprintf (stderr, "%s: Invalid radiotap header\n", name);
+
+      return 0;
+    }
+
+    #ifdef BIG_ENDIAN_HOST
+    link_len = byte_swap_16 (ieee80211_radiotap_header->it_len);
+    #else
+    link_len = ieee80211_radiotap_header->it_len;
+    #endif
+  }
+  else if (linktype == DLT_IEEE802_11_PPI_HDR)
+  {
+    if (header->caplen < sizeof (ppi_packet_header_t))
+    {
+      fprintf (stderr, "%s: Could not read ppi header\n", name);
+
+      return 0;
+    }
+
+    const ppi_packet_header_t *ppi_packet_header = (const ppi_packet_header_t *) packet;
+
+    link_len = ppi_packet_header->pph_len;
+  }
+
+  // a link header longer than the packet would leave nothing to look at
+
+  if (link_len > header->caplen) return 1;
+
+  header->caplen -= link_len;
+  header->len    -= link_len;
+
+  if (process_packet (ctx, packet + link_len, header) == -1) return -1;
+
+  return 1;
+}
+
+static bool linktype_supported (const u32 linktype)
+{
+  return (linktype == DLT_IEEE802_11)
+      || (linktype == DLT_IEEE802_11_PRISM)
+      || (linktype == DLT_IEEE802_11_RADIO)
+      || (linktype == DLT_IEEE802_11_PPI_HDR);
+}
+
+static void zero_timestamps_msg (const char *name)
+{
+  fprintf (stderr, "Zero value timestamps detected in file: %s.\n", name);
+  fprintf (stderr, "This prevents correct EAPOL-Key timeout calculation.\n");
+  fprintf (stderr, "Do not use preprocess the capture file with tools such as wpaclean.\n");
+}
+
+// classic pcap, the file header, the packets start right behind it
+
+static int pcap_open (const u8 *buf, const size_t len, const char *name, u32 *linktype, int *bitness)
+{
+  pcap_file_header_t pcap_file_header;
+
+  if (len < sizeof (pcap_file_header_t))
+  {
+    fprintf (stderr, "%s: Could not read pcap header\n", name);
+
+    return -1;
+  }
+
+  memcpy (&pcap_file_header, buf, sizeof (pcap_file_header_t));
+
+  #ifdef BIG_ENDIAN_HOST
+  pcap_file_header.magic          = byte_swap_32 (pcap_file_header.magic);
+  pcap_file_header.version_major  = byte_swap_16 (pcap_file_header.version_major);
+  pcap_file_header.version_minor  = byte_swap_16 (pcap_file_header.version_minor);
+  pcap_file_header.thiszone       = byte_swap_32 (pcap_file_header.thiszone);
+  pcap_file_header.sigfigs        = byte_swap_32 (pcap_file_header.sigfigs);
+  pcap_file_header.snaplen        = byte_swap_32 (pcap_file_header.snaplen);
+  pcap_file_header.linktype       = byte_swap_32 (pcap_file_header.linktype);
+  #endif
+
+  if (pcap_file_header.magic == PCAP_TCPDUMP_MAGIC)
+  {
+    *bitness = 0;
+  }
+  else if (pcap_file_header.magic == PCAP_TCPDUMP_CIGAM)
+  {
+    *bitness = 1;
+  }
+  else
+  {
+    fprintf (stderr, "%s: Invalid pcap header\n", name);
+
+    return -1;
+  }
+
+  if (*bitness == 1)
+  {
+    pcap_file_header.magic          = byte_swap_32 (pcap_file_header.magic);
+    pcap_file_header.version_major  = byte_swap_16 (pcap_file_header.version_major);
+    pcap_file_header.version_minor  = byte_swap_16 (pcap_file_header.version_minor);
+    pcap_file_header.thiszone       = byte_swap_32 (pcap_file_header.thiszone);
+    pcap_file_header.sigfigs        = byte_swap_32 (pcap_file_header.sigfigs);
+    pcap_file_header.snaplen        = byte_swap_32 (pcap_file_header.snaplen);
+    pcap_file_header.linktype       = byte_swap_32 (pcap_file_header.linktype);
+  }
+
+  if (linktype_supported (pcap_file_header.linktype) == false)
+  {
+    fprintf (stderr, "%s: Unsupported linktype detected\n", name);
+
+    return -1;
+  }
+
+  *linktype = pcap_file_header.linktype;
+
+  return 1;
+}
+
+static void pcap_pkthdr_read (const u8 *p, const int bitness, pcap_pkthdr_t *header)
+{
+  memcpy (header, p, sizeof (pcap_pkthdr_t));
+
+  #ifdef BIG_ENDIAN_HOST
+  header->tv_sec   = byte_swap_32 (header->tv_sec);
+  header->tv_usec  = byte_swap_32 (header->tv_usec);
+  header->caplen   = byte_swap_32 (header->caplen);
+  header->len      = byte_swap_32 (header->len);
+  #endif
+
+  if (bitness == 1)
+  {
+    header->tv_sec   = byte_swap_32 (header->tv_sec);
+    header->tv_usec  = byte_swap_32 (header->tv_usec);
+    header->caplen   = byte_swap_32 (header->caplen);
+    header->len      = byte_swap_32 (header->len);
+  }
+}
+
+// walks the packets from pos to end, 1 all done, 0 stopped early, -1 error
+static int pcap_walk (cap2hc_ctx_t *ctx, const u8 *buf, size_t pos, const size_t end, const u32 linktype, const int bitness, const char *name)
+{
+  while (pos + sizeof (pcap_pkthdr_t) <= end)
+  {
+    pcap_pkthdr_t header;
+
+    pcap_pkthdr_read (buf + pos, bitness, &header);
+
+    pos += sizeof (pcap_pkthdr_t);
+
+    if ((header.tv_sec == 0) && (header.tv_usec == 0))
+    {
+      zero_timestamps_msg (name);
+
+      return -1;
+    }
+
+    if (header.caplen > end - pos)
+    {
+      fprintf (stderr, "%s: Could not read pcap packet data\n", name);
+
+      return 0;
+    }
+
+    // no copy, the headers are read where they are
+
+    const u8 *packet = buf + pos;
+
+    pos += header.caplen;
+
+    const int rc = process_frame (ctx, linktype, packet, &header, name);
+
+    if (rc != 1) return rc;
+  }
+
+  return 1;
+}
+
+// pcapng, every section has a byte order and interfaces of its own, every
+// interface a linktype and a timestamp unit
+
+struct pcapng_if {
+  u32 linktype;
+  u64 units_per_sec;  // 0 if the resolution can not be handled
+};
+
+typedef struct pcapng_if pcapng_if_t;
+
+struct pcapng_walk {
+  bool swap;
+
+  pcapng_if_t *ifs;
+  u32          ifs_cnt;
+  u32          ifs_avail;
+
+  u32 tv_sec;         // of the last timestamped packet, simple packets have none
+  u32 tv_usec;
+
+  bool supported;     // saw an interface we can read
+};
+
+typedef struct pcapng_walk pcapng_walk_t;
+
+static u16 pcapng_16 (const pcapng_walk_t *walk, const u8 *p)
+{
+  u16 v;
+
+  memcpy (&v, p, sizeof (v));
+
+  return (walk->swap == true) ? byte_swap_16 (v) : v;
+}
+
+static u32 pcapng_32 (const pcapng_walk_t *walk, const u8 *p)
+{
+  u32 v;
+
+  memcpy (&v, p, sizeof (v));
+
+  return (walk->swap == true) ? byte_swap_32 (v) : v;
+}
+
+static void pcapng_walk_free (pcapng_walk_t *walk)
+{
+  free (walk->ifs);
+
+  memset (walk, 0, sizeof (pcapng_walk_t));
+}
+
+static int pcapng_walk_copy (pcapng_walk_t *dst, const pcapng_walk_t *src)
+{
+  memcpy (dst, src, sizeof (pcapng_walk_t));
+
+  dst->ifs       = NULL;
+  dst->ifs_avail = 0;
+
+  if (src->ifs_cnt == 0) return 1;
+
+  dst->ifs = (pcapng_if_t *) malloc (src->ifs_cnt * sizeof (pcapng_if_t));
+
+  if (dst->ifs == NULL) return -1;
+
+  memcpy (dst->ifs, src->ifs, src->ifs_cnt * sizeof (pcapng_if_t));
+
+  dst->ifs_avail = src->ifs_cnt;
+
+  return 1;
+}
+
+// if_tsresol, a power of 10, or of 2 with the top bit set, microseconds by default
+static u64 pcapng_tsresol (const u8 tsresol)
+{
+  const u32 exp = tsresol & 0x7f;
+
+  if (tsresol & 0x80) return (exp < 64) ? (1ull << exp) : 0;
+
+  if (exp > 19) return 0;
+
+  u64 units_per_sec = 1;
+
+  for (u32 i = 0; i < exp; i++) units_per_sec *= 10;
+
+  return units_per_sec;
+}
+
+// a section header, 1 ok, 0 cut short, -1 not one, a new section starts without interfaces
+static int pcapng_shb (pcapng_walk_t *walk, const u8 *block, const size_t avail)
+{
+  if (avail < sizeof (pcapng_block_header_t) + sizeof (pcapng_shb_t)) return 0;
+
+  u32 byte_order_magic;
+
+  memcpy (&byte_order_magic, block + sizeof (pcapng_block_header_t), sizeof (u32));
+
+  if (byte_order_magic == PCAPNG_BYTE_ORDER_MAGIC)
+  {
+    walk->swap = false;
+  }
+  else if (byte_order_magic == byte_swap_32 (PCAPNG_BYTE_ORDER_MAGIC))
+  {
+    walk->swap = true;
+  }
+  else
+  {
+    return -1;
+  }
+
+  walk->ifs_cnt = 0;
+
+  return 1;
+}
+
+static bool pcapng_block_len_ok (const u32 block_len, const size_t avail)
+{
+  if (block_len < sizeof (pcapng_block_header_t) + 4) return false;
+
+  if (block_len % 4) return false;
+
+  return block_len <= avail;
+}
+
+static int pcapng_add_if (pcapng_walk_t *walk, const u8 *body, const u32 body_len)
+{
+  if (body_len < sizeof (pcapng_idb_t)) return -1;
+
+  if (walk->ifs_cnt == walk->ifs_avail)
+  {
+    const u32 ifs_avail = (walk->ifs_avail == 0) ? 4 : walk->ifs_avail * 2;
+
+    pcapng_if_t *ifs = (pcapng_if_t *) realloc (walk->ifs, ifs_avail * sizeof (pcapng_if_t));
+
+    if (ifs == NULL) return -1;
+
+    walk->ifs       = ifs;
+    walk->ifs_avail = ifs_avail;
+  }
+
+  pcapng_if_t *pcapng_if = &walk->ifs[walk->ifs_cnt++];
+
+  pcapng_if->linktype      = pcapng_16 (walk, body + offsetof (pcapng_idb_t, linktype));
+  pcapng_if->units_per_sec = 1000000;
+
+  if (linktype_supported (pcapng_if->linktype) == true) walk->supported = true;
+
+  // options, code and length, the value padded to 32 bits
+
+  for (u32 pos = sizeof (pcapng_idb_t); pos + 4 <= body_len;)
+  {
+    const u16 code = pcapng_16 (walk, body + pos);
+    const u16 len  = pcapng_16 (walk, body + pos + 2);
+
+    pos += 4;
+
+    if (code == PCAPNG_OPT_ENDOFOPT) break;
+
+    if (len > body_len - pos) break;
+
+    if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) pcapng_if->units_per_sec = pcapng_tsresol (body[pos]);
+
+    pos += (len + 3) & ~3u;
+  }
+
+  return 1;
+}
+
+// the pcap header of an enhanced packet, 1 ok, 0 skip it, remembers the timestamp for simple packets
+static int pcapng_epb_read (pcapng_walk_t *walk, const u8 *body, const u32 body_len, pcap_pkthdr_t *header, u32 *if_id)
+{
+  if (body_len < sizeof (pcapng_epb_t)) return 0;
+
+  *if_id = pcapng_32 (walk, body + offsetof (pcapng_epb_t, interface_id));
+
+  if (*if_id >= walk->ifs_cnt) return 0;
+
+  const u64 units_per_sec = walk->ifs[*if_id].units_per_sec;
+
+  if (units_per_sec == 0) return 0;
+
+  const u64 ts = ((u64) pcapng_32 (walk, body + offsetof (pcapng_epb_t, timestamp_high)) << 32)
+               |  (u64) pcapng_32 (walk, body + offsetof (pcapng_epb_t, timestamp_low));
+
+  header->tv_sec  = (u32) (ts / units_per_sec);
+  header->tv_usec = (u32) ((double) (ts % units_per_sec) * 1000000 / units_per_sec);
+  header->caplen  = pcapng_32 (walk, body + offsetof (pcapng_epb_t, caplen));
+  header->len     = pcapng_32 (walk, body + offsetof (pcapng_epb_t, len));
+
+  walk->tv_sec  = header->tv_sec;
+  walk->tv_usec = header->tv_usec;
+
+  return 1;
+}
+
+// walks the blocks from pos to end, 1 all done, 0 stopped early, -1 error
+static int pcapng_walk (cap2hc_ctx_t *ctx, const u8 *buf, size_t pos, const size_t end, pcapng_walk_t *walk, const char *name)
+{
+  while (pos + sizeof (pcapng_block_header_t) <= end)
+  {
+    const u8 *block = buf + pos;
+
+    const u32 block_type = pcapng_32 (walk, block);
+
+    // the byte order is only known once a section header has been read
+
+    if (block_type == PCAPNG_BLOCK_SHB)
+    {
+      const int rc = pcapng_shb (walk, block, end - pos);
+
+      if (rc != 1)
+      {
+        if (rc == 0) fprintf (stderr, "%s: Could not read pcapng section header\n", name);
+        else         fprintf (stderr, "%s: Invalid pcapng header\n", name);
+
+        return (pos == 0) ? -1 : 0;
+      }
+    }
+    else if (pos == 0)
+    {
+      fprintf (stderr, "%s: Invalid pcapng header\n", name);
+
+      return -1;
+    }
+
+    const u32 block_len = pcapng_32 (walk, block + offsetof (pcapng_block_header_t, block_total_length));
+
+    if (pcapng_block_len_ok (block_len, end - pos) == false)
+    {
+      fprintf (stderr, "%s: Could not read pcapng block\n", name);
+
+      return 0;
+    }
+
+    pos += block_len;
+
+    const u8 *body     = block + sizeof (pcapng_block_header_t);
+    const u32 body_len = block_len - sizeof (pcapng_block_header_t) - 4;
+
+    if (block_type == PCAPNG_BLOCK_IDB)
+    {
+      if (pcapng_add_if (walk, body, body_len) == -1)
+      {
+        fprintf (stderr, "%s: Could not read pcapng interface\n", name);
+
+        return -1;
+      }
+
+      continue;
+    }
+
+    pcap_pkthdr_t header;
+
+    const u8 *packet;
+
+    u32 if_id = 0;
+
+    if (block_type == PCAPNG_BLOCK_EPB)
+    {
+      if (pcapng_epb_read (walk, body, body_len, &header, &if_id) == 0) continue;
+
+      if ((header.tv_sec == 0) && (header.tv_usec == 0))
+      {
+        zero_timestamps_msg (name);
+
+        return -1;
+      }
+
+      if (header.caplen > body_len - sizeof (pcapng_epb_t))
+      {
+        fprintf (stderr, "%s: Could not read pcap packet data\n", name);
+
+        return 0;
+      }
+
+      packet = body + sizeof (pcapng_epb_t);
+    }
+    else if (block_type == PCAPNG_BLOCK_SPB)
+    {
+      // always the first interface, no timestamp, the one of the packet before it is as close as it gets
+
+      if (body_len < sizeof (pcapng_spb_t)) continue;
+
+      if (walk->ifs_cnt == 0) continue;
+
+      header.tv_sec  = walk->tv_sec;
+      header.tv_usec = walk->tv_usec;
+      header.len     = pcapng_32 (walk, body + offsetof (pcapng_spb_t, len));
+      header.caplen  = MIN (header.len, body_len - (u32) sizeof (pcapng_spb_t));
+
+      packet = body + sizeof (pcapng_spb_t);
+    }
+    else
+    {
+      continue;
+    }
+
+    const u32 linktype = walk->ifs[if_id].linktype;
+
+    if (linktype_supported (linktype) == false) continue;
+
+    const int rc = process_frame (ctx, linktype, packet, &header, name);
+
+    if (rc != 1) return rc;
+  }
+
+  return 1;
+}
+
+// sharding, a large capture is cut at packet boundaries, the shards are
+// parsed into databases of their own by several threads, then merged in
+// capture order. the merge keeps what a single walk would have kept, so
+// the pairing sees the same databases whatever the shards
+
+struct cap2hc_shard {
+  cap2hc_ctx_t *ctx;        // the caller's for the first shard
+  cap2hc_ctx_t  part;       // the databases of the others
+
+  const u8     *buf;
+  size_t        pos;
+  size_t        end;
+  const char   *name;
+
+  bool          pcapng;
+  u32           linktype;   // pcap
+  int           bitness;
+  pcapng_walk_t walk;       // pcapng, the state at pos
+
+  int           rc;
+
+  pthread_t     thread;
+  bool          started;
+};
+
+typedef struct cap2hc_shard cap2hc_shard_t;
+
+static u32 cap2hc_threads_cnt  = 1;
+static u32 cap2hc_threads_busy = 0;   // extra threads of all parses running, under mux
+
+static pthread_mutex_t cap2hc_threads_mux = PTHREAD_MUTEX_INITIALIZER;
+
+void cap2hc_set_threads (const u32 threads_cnt)
+{
+  cap2hc_threads_cnt = (threads_cnt == 0) ? 1 : threads_cnt;
+}
+
+// threads beside the calling one, as many of want as are free
+static u32 cap2hc_threads_reserve (const u32 want)
+{
+  pthread_mutex_lock (&cap2hc_threads_mux);
+
+  const u32 free_cnt = cap2hc_threads_cnt - 1 - MIN (cap2hc_threads_busy, cap2hc_threads_cnt - 1);
+
+  const u32 got = MIN (want, free_cnt);
+
+  cap2hc_threads_busy += got;
+
+  pthread_mutex_unlock (&cap2hc_threads_mux);
+
+  return got;
+}
+
+static void cap2hc_threads_release (const u32 cnt)
+{
+  pthread_mutex_lock (&cap2hc_threads_mux);
+
+  cap2hc_threads_busy -= cnt;
+
+  pthread_mutex_unlock (&cap2hc_threads_mux);
+}
+
+static void *cap2hc_shard_run (void *arg)
+{
+  cap2hc_shard_t *shard = (cap2hc_shard_t *) arg;
+
+  if (shard->pcapng == true)
+  {
+    shard->rc = pcapng_walk (shard->ctx, shard->buf, shard->pos, shard->end, &shard->walk, shard->name);
+  }
+  else
+  {
+    shard->rc = pcap_walk (shard->ctx, shard->buf, shard->pos, shard->end, shard->linktype, shard->bitness, shard->name);
+  }
+
+  return NULL;
+}
+
+// where shards 1.. start, about cut_len apart. the headers are only
+// skimmed, anything odd ends the cutting there and is left to the last
+// shard, which reports it just as a single walk would
+
+static u32 pcap_split (cap2hc_shard_t *shards, const u32 shards_cnt, const u8 *buf, size_t pos, const size_t len, const int bitness, const size_t cut_len)
+{
+  u32 cnt = 1;
+
+  size_t next_cut = pos + cut_len;
+
+  while ((cnt < shards_cnt) && (pos + sizeof (pcap_pkthdr_t) <= len))
+  {
+    if (pos >= next_cut)
+    {
+      shards[cnt++].pos = pos;
+
+      next_cut = pos + cut_len;
+
+      continue;
+    }
+
+    pcap_pkthdr_t header;
+
+    pcap_pkthdr_read (buf + pos, bitness, &header);
+
+    if ((header.tv_sec == 0) && (header.tv_usec == 0)) break;
+
+    if (header.caplen >= TCPDUMP_DECODE_LEN) break;
+
+    if (header.caplen > len - pos - sizeof (pcap_pkthdr_t)) break;
+
+    pos += sizeof (pcap_pkthdr_t) + header.caplen;
+  }
+
+  return cnt;
+}
+
+// the same for pcapng, every shard also gets the walk state it starts in
+static u32 pcapng_split (cap2hc_shard_t *shards, const u32 shards_cnt, const u8 *buf, size_t pos, const size_t len, const size_t cut_len)
+{
+  u32 cnt = 1;
+
+  size_t next_cut = pos + cut_len;
+
+  pcapng_walk_t walk;
+
+  memset (&walk, 0, sizeof (pcapng_walk_t));
+
+  while ((cnt < shards_cnt) && (pos + sizeof (pcapng_block_header_t) <= len))
+  {
+    if (pos >= next_cut)
+    {
+      if (pcapng_walk_copy (&shards[cnt].walk, &walk) == -1) break;
+
+      shards[cnt++].pos = pos;
+
+      next_cut = pos + cut_len;
+
+      continue;
+    }
+
+    const u8 *block = buf + pos;
+
+    const u32 block_type = pcapng_32 (&walk, block);
+
+    if (block_type == PCAPNG_BLOCK_SHB)
+    {
+      if (pcapng_shb (&walk, block, len - pos) != 1) break;
+    }
+    else if (pos == 0)
+    {
+      break;
+    }
+
+    const u32 block_len = pcapng_32 (&walk, block + offsetof (pcapng_block_header_t, block_total_length));
+
+    if (pcapng_block_len_ok (block_len, len - pos) == false) break;
+
+    const u8 *body     = block + sizeof (pcapng_block_header_t);
+    const u32 body_len = block_len - sizeof (pcapng_block_header_t) - 4;
+
+    if (block_type == PCAPNG_BLOCK_IDB)
+    {
+      if (pcapng_add_if (&walk, body, body_len) == -1) break;
+    }
+    else if (block_type == PCAPNG_BLOCK_EPB)
+    {
+      pcap_pkthdr_t header;
+
+      u32 if_id;
+
+      if (pcapng_epb_read (&walk, body, body_len, &header, &if_id) == 1)
+      {
+        if ((header.tv_sec == 0) && (header.tv_usec == 0)) break;
+
+        if (header.caplen > body_len - sizeof (pcapng_epb_t)) break;
+      }
+    }
+
+    pos += block_len;
+  }
+
+  pcapng_walk_free (&walk);
+
+  return cnt;
+}
+
+// appends what a shard found, as if its packets had been walked right here
+static int cap2hc_merge (cap2hc_ctx_t *ctx, const cap2hc_ctx_t *part)
+{
+  for (u32 i = 0; i < part->essids_cnt; i++)
+  {
+    const essid_t *src = &part->essids[i];
+
+    essid_t essid;
+
+    memcpy (&essid, src, sizeof (essid_t));
+
+    if (db_essid_add (ctx, &essid, src->bssid, src->essid_source) == -1) return -1;
+  }
+
+  for (u32 i = 0; i < part->excpkts_cnt; i++)
+  {
+    const excpkt_t *src = &part->excpkts[i];
+
+    excpkt_t excpkt;
+
+    memcpy (&excpkt, src, sizeof (excpkt_t));
+
+    if (db_excpkt_add (ctx, &excpkt, src->tv_sec, src->tv_usec, src->mac_ap, src->mac_sta) == -1) return -1;
+  }
+
+  return 1;
+}
+
+// 1 with the index of the last shard that counts in last, -1 on error
+static int cap2hc_parse_shards (cap2hc_shard_t *shards, u32 shards_cnt, const size_t pos, const size_t len, u32 *last)
+{
+  *last = 0;
+
+  if (shards_cnt > 1)
+  {
+    const size_t cut_len = (len - pos) / shards_cnt;
+
+    if (shards[0].pcapng == true)
+    {
+      shards_cnt = pcapng_split (shards, shards_cnt, shards[0].buf, pos, len, cut_len);
+    }
+    else
+    {
+      shards_cnt = pcap_split (shards, shards_cnt, shards[0].buf, pos, len, shards[0].bitness, cut_len);
+    }
+  }
+
+  for (u32 i = 0; i < shards_cnt; i++)
+  {
+    shards[i].end = (i + 1 < shards_cnt) ? shards[i + 1].pos : len;
+  }
+
+  // the calling thread takes the first shard, and any a thread could not be started for
+
+  for (u32 i = 1; i < shards_cnt; i++)
+  {
+    shards[i].started = (pthread_create (&shards[i].thread, NULL, cap2hc_shard_run, &shards[i]) == 0);
+  }
+
+  cap2hc_shard_run (&shards[0]);
+
+  for (u32 i = 1; i < shards_cnt; i++)
+  {
+    if (shards[i].started == true)
+    {
+      pthread_join (shards[i].thread, NULL);
+    }
+    else
+    {
+      cap2hc_shard_run (&shards[i]);
+    }
+  }
+
+  // the first shard walked into the databases of the caller, the others
+  // are appended in capture order, up to the first that stopped or failed
+
+  for (u32 i = 0; i < shards_cnt; i++)
+  {
+    *last = i;
+
+    if (shards[i].rc == -1) return -1;
+
+    if (i > 0) if (cap2hc_merge (shards[0].ctx, shards[i].ctx) == -1) return -1;
+
+    if (shards[i].rc == 0) break;
+  }
+
+  return 1;
+}
+
+// walks the packets of a pcap or pcapng, name is only used for messages
+int cap2hc_parse (cap2hc_ctx_t *ctx, const u8 *buf, const size_t len, const char *name)
+{
+  const bool pcapng = (len >= 4) && (memcmp (buf, PCAPNG_MAGIC, 4) == 0);
+
+  size_t pos = 0;
+
+  u32 linktype = 0;
+
+  int bitness = 0;
+
+  if (pcapng == false)
+  {
+    if (pcap_open (buf, len, name, &linktype, &bitness) == -1) return -1;
+
+    pos = sizeof (pcap_file_header_t);
+  }
+
+  const u32 want_cnt = (u32) MIN (len / CAP2HC_SHARD_MIN, CAP2HC_SHARDS_MAX);
+
+  const u32 extra_cnt = (want_cnt > 1) ? cap2hc_threads_reserve (want_cnt - 1) : 0;
+
+  const u32 shards_cnt = 1 + extra_cnt;
+
+  cap2hc_shard_t *shards = (cap2hc_shard_t *) jmcalloc (shards_cnt, sizeof (cap2hc_shard_t));
+
+  if (shards == NULL)
+  {
+    cap2hc_threads_release (extra_cnt);
+
+    return -1;
+  }
+
+  for (u32 i = 0; i < shards_cnt; i++)
+  {
+    cap2hc_shard_t *shard = &shards[i];
+
+    if (i == 0)
+    {
+      shard->ctx = ctx;
+    }
+    else
+    {
+      cap2hc_ctx_init (&shard->part);
+
+      shard->ctx = &shard->part;
+    }
+
+    shard->buf      = buf;
+    shard->pos      = pos;
+    shard->name     = name;
+    shard->pcapng   = pcapng;
+    shard->linktype = linktype;
+    shard->bitness  = bitness;
+  }
+
+  u32 last = 0;
+
+  int ret = cap2hc_parse_shards (shards, shards_cnt, pos, len, &last);
+
+  if ((ret == 1) && (pcapng == true) && (shards[last].walk.supported == false))
+  {
+    fprintf (stderr, "%s: Unsupported linktype detected\n", name);
+
+    ret = -1;
+  }
+
+  for (u32 i = 0; i < shards_cnt; i++)
+  {
+    pcapng_walk_free (&shards[i].walk);
+
+    if (i > 0) cap2hc_ctx_destory (&shards[i].part);
+  }
+
+  jmfree (shards);
+
+  cap2hc_threads_release (extra_cnt);
+
+  return ret;
+}
+
+static void hccapx_from_pair (hccapx_t *hccapx, const essid_t *essid, const excpkt_t *excpkt_ap, const excpkt_t *excpkt_sta, const u8 message_pair)
+{
+  memset (hccapx, 0, sizeof (hccapx_t));
+
+  hccapx->signature = HCCAPX_SIGNATURE;
+  hccapx->version   = HCCAPX_VERSION;
+
+  hccapx->message_pair = message_pair;
+
+  if (excpkt_ap->replay_counter != excpkt_sta->replay_counter)
+  {
+    hccapx->message_pair |= MESSAGE_PAIR_NC;
+  }
+
+  hccapx->essid_len = essid->essid_len;
+  memcpy (&hccapx->essid, essid->essid, 32);
+
+  memcpy (&hccapx->mac_ap, excpkt_ap->mac_ap, 6);
+  memcpy (&hccapx->nonce_ap, excpkt_ap->nonce, 32);
+
+  memcpy (&hccapx->mac_sta, excpkt_sta->mac_sta, 6);
+  memcpy (&hccapx->nonce_sta, excpkt_sta->nonce, 32);
+
+  const excpkt_t *excpkt_eapol = (excpkt_sta->eapol_len > 0) ? excpkt_sta : excpkt_ap;
+
+  hccapx->keyver = excpkt_eapol->keyver;
+  memcpy (&hccapx->keymic, excpkt_eapol->keymic, 16);
+
+  hccapx->eapol_len = excpkt_eapol->eapol_len;
+  memcpy (&hccapx->eapol, excpkt_eapol->eapol, 256);
+
+  #ifdef BIG_ENDIAN_HOST
+  hccapx->signature  = byte_swap_32 (hccapx->signature);
+  hccapx->version    = byte_swap_32 (hccapx->version);
+  hccapx->eapol_len  = byte_swap_16 (hccapx->eapol_len);
+  #endif
+}
+
+// the join of cap2hc_write (), frames of one side chained in capture order
+
+struct cap2hc_join {
+  cap2hc_index_t aps_by_bssid;   // first ap frame (M1, M3) of an access point
+  cap2hc_index_t stas_by_macs;   // first sta frame (M2, M4) of an (ap, sta) pair
+
+  u32 *next;                     // next frame of the same chain, index + 1
+};
+
+typedef struct cap2hc_join cap2hc_join_t;
+
+static bool excpkt_is_ap (const excpkt_t *excpkt)
+{
+  return (excpkt->excpkt_num == EXC_PKT_NUM_1) || (excpkt->excpkt_num == EXC_PKT_NUM_3);
+}
+
+static u32 *join_ap_slot (const cap2hc_ctx_t *ctx, const cap2hc_join_t *join, const u8 mac_ap[6])
+{
+  const u32 mask = join->aps_by_bssid.size - 1;
+
+  for (u32 pos = (u32) hash_bssid (mac_ap) & mask;; pos = (pos + 1) & mask)
+  {
+    u32 *slot = &join->aps_by_bssid.slots[pos];
+
+    if (*slot == 0) return slot;
+
+    if (memcmp (ctx->excpkts[*slot - 1].mac_ap, mac_ap, 6) == 0) return slot;
+  }
+}
+
+static u32 *join_sta_slot (const cap2hc_ctx_t *ctx, const cap2hc_join_t *join, const u8 mac_ap[6], const u8 mac_sta[6])
+{
+  const u32 mask = join->stas_by_macs.size - 1;
+
+  for (u32 pos = (u32) hash_macs (mac_ap, mac_sta) & mask;; pos = (pos + 1) & mask)
+  {
+    u32 *slot = &join->stas_by_macs.slots[pos];
+
+    if (*slot == 0) return slot;
+
+    const excpkt_t *excpkt = &ctx->excpkts[*slot - 1];
+
+    if ((memcmp (excpkt->mac_ap, mac_ap, 6) == 0) && (memcmp (excpkt->mac_sta, mac_sta, 6) == 0)) return slot;
+  }
+}
+
+static void cap2hc_join_free (cap2hc_join_t *join)
+{
+  cap2hc_index_free (&join->aps_by_bssid);
+  cap2hc_index_free (&join->stas_by_macs);
+
+  free (join->next);
+}
+
+// one pass over the frames, backwards, so that every chain comes out in capture order
+static int cap2hc_join_build (const cap2hc_ctx_t *ctx, cap2hc_join_t *join)
+{
+  memset (join, 0, sizeof (cap2hc_join_t));
+
+  join->next = (u32 *) calloc (ctx->excpkts_cnt + 1, sizeof (u32));
+
+  if (join->next == NULL) return -1;
+
+  if (cap2hc_index_alloc (&join->aps_by_bssid, ctx->excpkts_cnt) == -1) return -1;
+  if (cap2hc_index_alloc (&join->stas_by_macs, ctx->excpkts_cnt) == -1) return -1;
+
+  for (u32 i = ctx->excpkts_cnt; i > 0; i--)
+  {
+    const excpkt_t *excpkt = &ctx->excpkts[i - 1];
+
+    u32 *slot = (excpkt_is_ap (excpkt) == true)
+              ? join_ap_slot  (ctx, join, excpkt->mac_ap)
+              : join_sta_slot (ctx, join, excpkt->mac_ap, excpkt->mac_sta);
+
+    join->next[i - 1] = *slot;
+
+    *slot = i;
+  }
+
+  return 1;
+}
+
+// the message pair of an ap and a sta frame of the same station, 0 if they do not make one
+static int pair_message (const excpkt_t *excpkt_ap, const excpkt_t *excpkt_sta, u8 *message_pair)
+{
+  if (excpkt_ap->excpkt_num < excpkt_sta->excpkt_num)
+  {
+    if (excpkt_ap->tv_sec > excpkt_sta->tv_sec) return 0;
+
+    if ((excpkt_ap->tv_sec + EAPOL_TTL) < excpkt_sta->tv_sec) return 0;
+  }
+  else
+  {
+    if (excpkt_sta->tv_sec > excpkt_ap->tv_sec) return 0;
+
+    if ((excpkt_sta->tv_sec + EAPOL_TTL) < excpkt_ap->tv_sec) return 0;
+  }
+
+  *message_pair = 255;
+
+  if ((excpkt_ap->excpkt_num == EXC_PKT_NUM_1) && (excpkt_sta->excpkt_num == EXC_PKT_NUM_2))
+  {
+    if (excpkt_sta->eapol_len == 0) return 0;
+
+    *message_pair = MESSAGE_PAIR_M12E2;
+  }
+  else if ((excpkt_ap->excpkt_num == EXC_PKT_NUM_1) && (excpkt_sta->excpkt_num == EXC_PKT_NUM_4))
+  {
+    if (excpkt_sta->eapol_len == 0) return 0;
+
+    *message_pair = MESSAGE_PAIR_M14E4;
+  }
+  else if ((excpkt_ap->excpkt_num == EXC_PKT_NUM_3) && (excpkt_sta->excpkt_num == EXC_PKT_NUM_2))
+  {
+    if (excpkt_sta->eapol_len > 0)
+    {
+      *message_pair = MESSAGE_PAIR_M32E2;
+    }
+    else if (excpkt_ap->eapol_len > 0)
+    {
+      *message_pair = MESSAGE_PAIR_M32E3;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+  else if ((excpkt_ap->excpkt_num == EXC_PKT_NUM_3) && (excpkt_sta->excpkt_num == EXC_PKT_NUM_4))
+  {
+    if (excpkt_ap->eapol_len > 0)
+    {
+      *message_pair = MESSAGE_PAIR_M34E3;
+    }
+    else if (excpkt_sta->eapol_len > 0)
+    {
+      *message_pair = MESSAGE_PAIR_M34E4;
+    }
+    else
+    {
+      return 0;
+    }
+  }
+
+  // cap2hccapx skips the export of these
+
+  if (*message_pair == MESSAGE_PAIR_M32E3 || *message_pair == MESSAGE_PAIR_M34E3) return 0;
+
+  return 1;
+}
+
+// best pair selection, the candidates of one essid, ranked per station
+
+struct cap2hc_cand {
+  const excpkt_t *excpkt_ap;
+  const excpkt_t *excpkt_sta;
+
+  u32 group;      // seq of the first candidate of its station
+  u32 seq;        // in the order the pairs were found
+
+  u8  message_pair;
+};
+
+typedef struct cap2hc_cand cap2hc_cand_t;
+
+// authorized pairs first (the ap went on after checking the mic), the challenge last
+static int message_pair_rank (const u8 message_pair)
+{
+  switch (message_pair)
+  {
+  case MESSAGE_PAIR_M32E2: return 0;
+  case MESSAGE_PAIR_M34E4: return 1;
+  case MESSAGE_PAIR_M14E4: return 2;
+  default:                 return 3;
+  }
+}
+
+static u64 cand_distance_us (const cap2hc_cand_t *cand)
+{
+  const u64 ap  = (u64) cand->excpkt_ap->tv_sec  * 1000000 + cand->excpkt_ap->tv_usec;
+  const u64 sta = (u64) cand->excpkt_sta->tv_sec * 1000000 + cand->excpkt_sta->tv_usec;
+
+  return (ap > sta) ? ap - sta : sta - ap;
+}
+
+static int cand_cmp_sta (const void *a, const void *b)
+{
+  const cap2hc_cand_t *x = (const cap2hc_cand_t *) a;
+  const cap2hc_cand_t *y = (const cap2hc_cand_t *) b;
+
+  const int cmp = memcmp (x->excpkt_ap->mac_sta, y->excpkt_ap->mac_sta, 6);
+
+  if (cmp != 0) return cmp;
+
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+// stations in the order they were first seen, in a station the best first
+static int cand_cmp_rank (const void *a, const void *b)
+{
+  const cap2hc_cand_t *x = (const cap2hc_cand_t *) a;
+  const cap2hc_cand_t *y = (const cap2hc_cand_t *) b;
+
+  if (x->group != y->group) return (x->group < y->group) ? -1 : 1;
+
+  const bool x_nc = x->excpkt_ap->replay_counter != x->excpkt_sta->replay_counter;
+  const bool y_nc = y->excpkt_ap->replay_counter != y->excpkt_sta->replay_counter;
+
+  if (x_nc != y_nc) return (x_nc == false) ? -1 : 1;
+
+  const int x_rank = message_pair_rank (x->message_pair);
+  const int y_rank = message_pair_rank (y->message_pair);
+
+  if (x_rank != y_rank) return (x_rank < y_rank) ? -1 : 1;
+
+  const u64 x_dist = cand_distance_us (x);
+  const u64 y_dist = cand_distance_us (y);
+
+  if (x_dist != y_dist) return (x_dist < y_dist) ? -1 : 1;
+
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+// routers count their anonces up, two of them that only differ in the
+// last 4 bytes tell in which byte order, hashcat then only corrects in that one
+static u8 nonce_order_hint (const cap2hc_ctx_t *ctx, const cap2hc_join_t *join, const u32 ap_first)
+{
+  const excpkt_t *prev = NULL;
+
+  for (u32 ap_idx = ap_first; ap_idx != 0; ap_idx = join->next[ap_idx - 1])
+  {
+    const excpkt_t *excpkt_ap = ctx->excpkts + ap_idx - 1;
+
+    if (prev != NULL && memcmp (prev->nonce, excpkt_ap->nonce, 28) == 0 && memcmp (prev->nonce + 28, excpkt_ap->nonce + 28, 4) != 0)
+    {
+      const u8 *p = prev->nonce + 28;
+      const u8 *q = excpkt_ap->nonce + 28;
+
+      const u32 p_be = ((u32) p[0] << 24) | ((u32) p[1] << 16) | ((u32) p[2] << 8) | (u32) p[3];
+      const u32 q_be = ((u32) q[0] << 24) | ((u32) q[1] << 16) | ((u32) q[2] << 8) | (u32) q[3];
+      const u32 p_le = byte_swap_32 (p_be);
+      const u32 q_le = byte_swap_32 (q_be);
+
+      const u32 d_be = (p_be > q_be) ? p_be - q_be : q_be - p_be;
+      const u32 d_le = (p_le > q_le) ? p_le - q_le : q_le - p_le;
+
+      if (MIN (d_be, d_le) <= CAP2HC_NC_DIST_MAX) return (d_be <= d_le) ? MESSAGE_PAIR_NC_BE : MESSAGE_PAIR_NC_LE;
+    }
+
+    prev = excpkt_ap;
+  }
+
+  return 0;
+}
+
+static int cap2hc_write_best (const cap2hc_ctx_t *ctx, const essid_t *essid, cap2hc_cand_t *cands, const u32 cands_cnt, const u8 hint, membuf_t *out)
+{
+  if (cands_cnt == 0) return 0;
+
+  qsort (cands, cands_cnt, sizeof (cap2hc_cand_t), cand_cmp_sta);
+
+  for (u32 i = 0, group = 0; i < cands_cnt; i++)
+  {
+    if ((i == 0) || (memcmp (cands[i].excpkt_ap->mac_sta, cands[i - 1].excpkt_ap->mac_sta, 6) != 0)) group = cands[i].seq;
+
+    cands[i].group = group;
+  }
+
+  qsort (cands, cands_cnt, sizeof (cap2hc_cand_t), cand_cmp_rank);
+
+  int written = 0;
+
+  for (u32 i = 0, taken = 0; i < cands_cnt; i++)
+  {
+    taken = ((i > 0) && (cands[i].group == cands[i - 1].group)) ? taken + 1 : 0;
+
+    if (taken >= ctx->best_cnt) continue;
+
+    hccapx_t hccapx;
+
+    hccapx_from_pair (&hccapx, essid, cands[i].excpkt_ap, cands[i].excpkt_sta, cands[i].message_pair);
+
+    hccapx.message_pair |= hint;
+
+    if (membuf_append (out, (const char *) &hccapx, sizeof (hccapx_t)) == -1) return -1;
+
+    written++;
+  }
+
+  return written;
+}
+
+// pairs up the collected handshakes, returns the number of hccapx_t appended
+//
+// the same pairs, in the same order, as cap2hccapx's loop over essids x
+// frames x frames, but every essid only looks at the frames of its
+// access point, and every ap frame only at those of its station. with a
+// best_cnt only the best pairs of every station are written
+int cap2hc_write (cap2hc_ctx_t *ctx, membuf_t *out)
+{
+  if (ctx->essids_cnt == 0 || ctx->excpkts_cnt == 0) return 0;
+
+  cap2hc_join_t join;
+
+  if (cap2hc_join_build (ctx, &join) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", __func__, strerror (errno));
+
+    cap2hc_join_free (&join);
+
+    return -1;
+  }
+
+  cap2hc_cand_t *cands = NULL;
+
+  u32 cands_cnt   = 0;
+  u32 cands_avail = 0;
+
+  int written = 0;
+
+  for (u32 essids_pos = 0; essids_pos < ctx->essids_cnt; essids_pos++)
+  {
+    const essid_t *essid = ctx->essids + essids_pos;
+
+    if (ctx->essid_filter) if (strcmp (essid->essid, ctx->essid_filter)) continue;
+
+    const u32 ap_first = *join_ap_slot (ctx, &join, essid->bssid);
+
+    cands_cnt = 0;
+
+    for (u32 ap_idx = ap_first; ap_idx != 0; ap_idx = join.next[ap_idx - 1])
+    {
+      const excpkt_t *excpkt_ap = ctx->excpkts + ap_idx - 1;
+
+      for (u32 sta_idx = *join_sta_slot (ctx, &join, excpkt_ap->mac_ap, excpkt_ap->mac_sta); sta_idx != 0; sta_idx = join.next[sta_idx - 1])
+      {
+        const excpkt_t *excpkt_sta = ctx->excpkts + sta_idx - 1;
+
+        u8 message_pair;
+
+        if (pair_message (excpkt_ap, excpkt_sta, &message_pair) == 0) continue;
+
+        if (ctx->best_cnt > 0)
+        {
+          if (cands_cnt == cands_avail)
+          {
+            if (db_grow ((void **) &cands, &cands_avail, DB_EXCPKT_INIT, UINT32_MAX, sizeof (cap2hc_cand_t)) == -1) written = -1;
+          }
+
+          if (written == -1) break;
+
+          cap2hc_cand_t *cand = &cands[cands_cnt];
+
+          cand->excpkt_ap    = excpkt_ap;
+          cand->excpkt_sta   = excpkt_sta;
+          cand->seq          = cands_cnt++;
+          cand->message_pair = message_pair;
+
+          continue;
+        }
+
+        hccapx_t hccapx;
+
+        hccapx_from_pair (&hccapx, essid, excpkt_ap, excpkt_sta, message_pair);
+
+        if (membuf_append (out, (const char *) &hccapx, sizeof (hccapx_t)) == -1) written = -1;
+
+        if (written == -1) break;
+
+        written++;
+      }
+
+      if (written == -1) break;
+    }
+
+    if (written == -1) break;
+
+    if (ctx->best_cnt > 0)
+    {
+      const int best = cap2hc_write_best (ctx, essid, cands, cands_cnt, nonce_order_hint (ctx, &join, ap_first), out);
+
+      if (best == -1)
+      {
+        written = -1;
+
+        break;
+      }
+
+      written += best;
+    }
+  }
+
+  free (cands);
+
+  cap2hc_join_free (&join);
+
+  return written;
+}
+
+int cap2hc_extract_buf (cap2hc_ctx_t *ctx, const u8 *buf, const size_t len, const char *name, membuf_t *out)
+{
+  if (cap2hc_parse (ctx, buf, len, name) == -1) return -1;
+
+  if (cap2hc_write (ctx, out) == -1) return -1;
+
+  return 1;
+}
+
+static u32 cap2hc_best_cnt = 0;
+
+void cap2hc_set_best (const u32 best_cnt)
+{
+  cap2hc_best_cnt = best_cnt;
+}
+
+u32 cap2hc_get_best (void)
+{
+  return cap2hc_best_cnt;
+}
+
+// appends the hccapx records of a capture file to out, nothing if it has no handshake
+int cap2hc_extract (const jmprobe_t *probe, membuf_t *out)
+{
+  jmmap_t cap;
+
+  if (jmprobe_map (probe, &cap) == -1) return -1;
+
+  // captures run into gigabytes, read ahead and drop what is behind
+
+#if defined (_POSIX)
+  if (cap.mapped == true) madvise ((void *) cap.buf, cap.len, MADV_SEQUENTIAL);
+#endif
+
+  cap2hc_ctx_t *ctx = (cap2hc_ctx_t *) jmmalloc (sizeof (cap2hc_ctx_t));
+
+  if (ctx == NULL)
+  {
+    jmmap_close (&cap);
+
+    return -1;
+  }
+
+  cap2hc_ctx_init (ctx);
+
+  ctx->best_cnt = cap2hc_best_cnt;
+
+  const int ret = cap2hc_extract_buf (ctx, cap.buf, cap.len, probe->fpath, out);
+
+  cap2hc_ctx_destory (ctx);
+
+  jmfree (ctx);
+
+  jmmap_close (&cap);
+
+  return ret;
+}
@@ -1,5 +1,30 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdarg.h>
+
 #include "common.h"
 
+#if defined (_POSIX)
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#define JMPROBE_OPEN_FLAGS (O_RDONLY | O_CLOEXEC)
+
+#elif defined (_WIN)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+#define JMPROBE_OPEN_FLAGS (O_RDONLY | O_BINARY)
+#endif
+
 int strlist_init (char ***outputs, int num_of_outputs, int output_len)
 {
   char **t = (char **) malloc (num_of_outputs * sizeof (char *));
@@ -255,81 +280,700 @@ int get_file_len (const char *fpath, int *file_len)
   return 1;
 }
 
-int copy_file (char *old_filename, char *new_filename)
+// linux and windows compatible
+
+FILE *jmpopen (const char *cmd, const char *mode)
+{
+  FILE *p;
+
+#if defined (_POSIX)
+
+  p = popen (cmd, mode);
+
+#elif defined (_WIN)
+
+  p = _popen (cmd, mode);
+
+#endif
+
+  return (p);
+}
+
+FILE *jmpclose (FILE * p)
 {
-  FILE *fptr1, *fptr2;
+#if defined (_POSIX)
 
-  char c;
+  pclose (p);
+
+#elif defined (_WIN)
 
-  // Open one file for reading
-  fptr1 = fopen (old_filename, "r");
+  _pclose (p);
+
+#endif
 
-  if (fptr1 == NULL)
+  return (p);
+}
+
+// spawn argv[0] directly, no /bin/sh involved, stdout goes to a pipe
+
+int jmpopenv (jmproc_t *proc, char *const argv[])
+{
+#if defined (_POSIX)
+
+  int pipefd[2];
+
+#if defined (__linux__)
+  if (pipe2 (pipefd, O_CLOEXEC) == -1)
+#else
+  if (pipe (pipefd) == -1)
+#endif
   {
-    printf ("Cannot open file %s \n", old_filename);
+    fprintf (stderr, "%s: could not create pipe: %s\n", argv[0], strerror (errno));
 
     return -1;
   }
 
-  // Open another file for writing
-  fptr2 = fopen (new_filename, "w");
+#if !defined (__linux__)
+  fcntl (pipefd[0], F_SETFD, FD_CLOEXEC);
+  fcntl (pipefd[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+  // other threads may spawn at the same time, so the pipe ends are
+  // close-on-exec and only the dup2()ed stdout survives in the child
+
+  posix_spawn_file_actions_t file_actions;
 
-  if (fptr2 == NULL)
+  posix_spawn_file_actions_init (&file_actions);
+  posix_spawn_file_actions_adddup2 (&file_actions, pipefd[1], STDOUT_FILENO);
+
+  const int rc = posix_spawn (&proc->pid, argv[0], &file_actions, NULL, argv, environ);
+
+  posix_spawn_file_actions_destroy (&file_actions);
+
+  close (pipefd[1]);
+
+  if (rc != 0)
   {
-    printf ("Cannot open file %s \n", new_filename);
+    fprintf (stderr, "%s: could not spawn: %s\n", argv[0], strerror (rc));
+
+    close (pipefd[0]);
 
     return -1;
   }
 
-  // Read contents from file
+  proc->fd = pipefd[0];
+
+#elif defined (_WIN)
 
-  c = fgetc (fptr1);
+  char cmd[BUF_MAXLEN] = { 0 };
 
-  while (c != EOF)
+  size_t cmd_len = 0;
+
+  for (int i = 0; argv[i] != NULL; i++)
   {
-    fputc (c, fptr2);
-    c = fgetc (fptr1);
+    int n = snprintf (cmd + cmd_len, sizeof (cmd) - cmd_len, (i == 0) ? "\"%s\"" : " \"%s\"", argv[i]);
+
+    if (n < 0 || (size_t) n >= sizeof (cmd) - cmd_len)
+    {
+      fprintf (stderr, "%s: command line too long\n", argv[0]);
+
+      return -1;
+    }
+
+    cmd_len += n;
   }
 
-  fflush (fptr1);
-  fflush (fptr2);
+  proc->fp = _popen (cmd, "rb");
+
+  if (proc->fp == NULL)
+  {
+    fprintf (stderr, "%s: could not spawn: %s\n", argv[0], strerror (errno));
+
+    return -1;
+  }
 
-  fclose (fptr1);
-  fclose (fptr2);
+#endif
 
   return 1;
 }
 
-// linux and windows compatible
-
-FILE *jmpopen (const char *cmd, const char *mode)
+// returns the exit status of the child, or -1
+int jmpclosev (jmproc_t *proc)
 {
-  FILE *p;
-
 #if defined (_POSIX)
 
-  p = popen (cmd, mode);
+  int status = 0;
+
+  close (proc->fd);
+
+  while (waitpid (proc->pid, &status, 0) == -1)
+  {
+    if (errno != EINTR) return -1;
+  }
+
+  if (WIFEXITED (status) == 0) return -1;
+
+  return WEXITSTATUS (status);
 
 #elif defined (_WIN)
 
-  p = _popen (cmd, mode);
+  return _pclose (proc->fp);
 
 #endif
+}
 
-  return (p);
+// run argv and collect everything it writes to stdout
+int jmpcapture (char *const argv[], membuf_t *out)
+{
+  jmproc_t proc;
+
+  if (jmpopenv (&proc, argv) == -1) return -1;
+
+  int ret = 1;
+
+  while (1)
+  {
+    if (membuf_reserve (out, HCBUFSIZ_TINY) == -1)
+    {
+      ret = -1;
+
+      break;
+    }
+
+#if defined (_POSIX)
+    const ssize_t nread = read (proc.fd, out->buf + out->len, out->size - out->len - 1);
+
+    if (nread == -1 && errno == EINTR) continue;
+#elif defined (_WIN)
+    const ssize_t nread = fread (out->buf + out->len, 1, out->size - out->len - 1, proc.fp);
+#endif
+
+    if (nread == -1)
+    {
+      fprintf (stderr, "%s: read failed: %s\n", argv[0], strerror (errno));
+
+      ret = -1;
+
+      break;
+    }
+
+    if (nread == 0) break;
+
+    out->len += nread;
+
+    out->buf[out->len] = 0;
+  }
+
+  jmpclosev (&proc);
+
+  return ret;
 }
 
-FILE *jmpclose (FILE * p)
+// memory buffer
+
+int membuf_init (membuf_t *mb, const size_t size)
+{
+  mb->len  = 0;
+  mb->size = 0;
+  mb->buf  = NULL;
+
+  return membuf_reserve (mb, size);
+}
+
+// make room for at least add more bytes plus the terminator
+int membuf_reserve (membuf_t *mb, const size_t add)
+{
+  if (mb->len + add + 1 <= mb->size) return 1;
+
+  size_t size = (mb->size > 0) ? mb->size : HCBUFSIZ_TINY;
+
+  while (size < mb->len + add + 1) size *= 2;
+
+  char *buf = (char *) realloc (mb->buf, size);
+
+  if (buf == NULL)
+  {
+    fprintf (stderr, "%s\n", MSG_ENOMEM);
+
+    return -1;
+  }
+
+  mb->buf  = buf;
+  mb->size = size;
+
+  mb->buf[mb->len] = 0;
+
+  return 1;
+}
+
+int membuf_append (membuf_t *mb, const void *data, const size_t len)
+{
+  if (membuf_reserve (mb, len) == -1) return -1;
+
+  memcpy (mb->buf + mb->len, data, len);
+
+  mb->len += len;
+
+  mb->buf[mb->len] = 0;
+
+  return 1;
+}
+
+void membuf_reset (membuf_t *mb)
+{
+  mb->len = 0;
+
+  if (mb->buf != NULL) mb->buf[0] = 0;
+}
+
+void membuf_destory (membuf_t *mb)
+{
+  jmfree (mb->buf);
+
+  mb->buf  = NULL;
+  mb->len  = 0;
+  mb->size = 0;
+}
+
+int membuf_read_file (membuf_t *mb, const char *fpath)
+{
+  FILE *fp = fopen (fpath, "rb");
+
+  if (fp == NULL)
+  {
+    fprintf (stderr, "%s: open file failed \n", fpath);
+
+    return -1;
+  }
+
+  int ret = 1;
+
+  while (1)
+  {
+    if (membuf_reserve (mb, HCBUFSIZ_LARGE) == -1)
+    {
+      ret = -1;
+
+      break;
+    }
+
+    const size_t nread = fread (mb->buf + mb->len, 1, mb->size - mb->len - 1, fp);
+
+    mb->len += nread;
+
+    mb->buf[mb->len] = 0;
+
+    if (nread == 0) break;
+  }
+
+  if (ferror (fp)) ret = -1;
+
+  fclose (fp);
+
+  return ret;
+}
+
+int membuf_vappendf (membuf_t *mb, const char *fmt, va_list ap)
+{
+  va_list aq;
+
+  va_copy (aq, ap);
+
+  const int n = vsnprintf (NULL, 0, fmt, aq);
+
+  va_end (aq);
+
+  if (n < 0) return -1;
+
+  if (membuf_reserve (mb, n) == -1) return -1;
+
+  vsnprintf (mb->buf + mb->len, n + 1, fmt, ap);
+
+  mb->len += n;
+
+  return 1;
+}
+
+int membuf_appendf (membuf_t *mb, const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start (ap, fmt);
+
+  const int ret = membuf_vappendf (mb, fmt, ap);
+
+  va_end (ap);
+
+  return ret;
+}
+
+// lower case hex, like the john converters print it
+int membuf_append_hex (membuf_t *mb, const uint8_t *data, const size_t len)
+{
+  static const char hex16[] = "0123456789abcdef";
+
+  if (membuf_reserve (mb, len * 2) == -1) return -1;
+
+  char *p = mb->buf + mb->len;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    *p++ = hex16[data[i] >> 4];
+    *p++ = hex16[data[i] & 15];
+  }
+
+  mb->len += len * 2;
+
+  mb->buf[mb->len] = 0;
+
+  return 1;
+}
+
+int jmmap_open (jmmap_t *map, const char *fpath)
 {
+  memset (map, 0, sizeof (jmmap_t));
+
+  const int fd = open (fpath, JMPROBE_OPEN_FLAGS);
+
+  if (fd == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    return -1;
+  }
+
+  struct stat st;
+
+  if (fstat (fd, &st) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    close (fd);
+
+    return -1;
+  }
+
+  const int ret = jmmap_open_fd (map, fd, (uint64_t) st.st_size, fpath);
+
+  close (fd);
+
+  return ret;
+}
+
+// fd stays open, a mapping does not need it once made
+
+int jmmap_open_fd (jmmap_t *map, const int fd, const uint64_t size, const char *fpath)
+{
+  memset (map, 0, sizeof (jmmap_t));
+
+  // empty files can not be mapped, and need not be
+
+  if (size == 0)
+  {
+    map->buf = (const uint8_t *) "";
+
+    return 1;
+  }
+
+  if (size > SIZE_MAX)
+  {
+    fprintf (stderr, "%s: file too large\n", fpath);
+
+    return -1;
+  }
+
 #if defined (_POSIX)
 
-  pclose (p);
+  void *addr = mmap (NULL, (size_t) size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  if (addr == MAP_FAILED)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    return -1;
+  }
+
+  map->buf    = (const uint8_t *) addr;
+  map->len    = (size_t) size;
+  map->mapped = true;
+
+  return 1;
 
 #elif defined (_WIN)
 
-  _pclose (p);
+  if (membuf_init (&map->mb, (size_t) size + 1) == -1) return -1;
+
+  if (lseek (fd, 0, SEEK_SET) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    membuf_destory (&map->mb);
+
+    return -1;
+  }
+
+  while (map->mb.len < (size_t) size)
+  {
+    const int nread = read (fd, map->mb.buf + map->mb.len, (unsigned int) ((size_t) size - map->mb.len));
+
+    if (nread <= 0) break;
+
+    map->mb.len += (size_t) nread;
+  }
+
+  map->mb.buf[map->mb.len] = 0;
+
+  map->buf = (const uint8_t *) map->mb.buf;
+  map->len = map->mb.len;
+
+  return 1;
 
 #endif
+}
 
-  return (p);
+void jmmap_close (jmmap_t *map)
+{
+#if defined (_POSIX)
+  if (map->mapped == true) munmap ((void *) map->buf, map->len);
+#endif
+
+  if (map->mb.buf != NULL) membuf_destory (&map->mb);
+
+  memset (map, 0, sizeof (jmmap_t));
+}
+
+int jmprobe_open (jmprobe_t *probe, const char *fpath)
+{
+  probe->fpath    = fpath;
+  probe->fd       = -1;
+  probe->size     = 0;
+  probe->dev      = 0;
+  probe->ino      = 0;
+  probe->mtime    = 0;
+  probe->head_len = 0;
+
+  const int fd = open (fpath, JMPROBE_OPEN_FLAGS);
+
+  if (fd == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    return -1;
+  }
+
+  struct stat st;
+
+  if (fstat (fd, &st) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    close (fd);
+
+    return -1;
+  }
+
+  probe->fd    = fd;
+  probe->size  = (u64) st.st_size;
+  probe->dev   = (u64) st.st_dev;
+  probe->ino   = (u64) st.st_ino;
+#if defined (__linux__)
+  probe->mtime = (u64) st.st_mtim.tv_sec * 1000000000 + (u64) st.st_mtim.tv_nsec;
+#else
+  probe->mtime = (u64) st.st_mtime * 1000000000;
+#endif
+
+  // read () may return less than asked, a short head only means a short file
+
+  while (probe->head_len < JMPROBE_HEAD_LEN)
+  {
+    const ssize_t nread = read (fd, probe->head + probe->head_len, JMPROBE_HEAD_LEN - probe->head_len);
+
+    if (nread == -1 && errno == EINTR) continue;
+
+    if (nread == -1)
+    {
+      fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+      jmprobe_close (probe);
+
+      return -1;
+    }
+
+    if (nread == 0) break;
+
+    probe->head_len += (size_t) nread;
+  }
+
+  return 1;
+}
+
+void jmprobe_close (jmprobe_t *probe)
+{
+  if (probe->fd != -1) close (probe->fd);
+
+  probe->fd = -1;
+}
+
+int jmprobe_map (const jmprobe_t *probe, jmmap_t *map)
+{
+  memset (map, 0, sizeof (jmmap_t));
+
+  if (probe->fd == -1) return -1;
+
+  return jmmap_open_fd (map, probe->fd, probe->size, probe->fpath);
+}
+
+// len bytes at offset, from the head if they are in it, 1 or -1 if the file is shorter
+int jmprobe_read_at (const jmprobe_t *probe, const uint64_t offset, void *buf, const size_t len)
+{
+  if ((offset + len) > probe->size) return -1;
+
+  if ((offset + len) <= probe->head_len)
+  {
+    memcpy (buf, probe->head + offset, len);
+
+    return 1;
+  }
+
+  if (probe->fd == -1) return -1;
+
+  size_t done = 0;
+
+  while (done < len)
+  {
+#if defined (_POSIX)
+    const ssize_t nread = pread (probe->fd, (u8 *) buf + done, len - done, (off_t) (offset + done));
+#elif defined (_WIN)
+    if (lseek (probe->fd, (off_t) (offset + done), SEEK_SET) == -1) return -1;
+
+    const int nread = read (probe->fd, (u8 *) buf + done, (unsigned int) (len - done));
+#endif
+
+    if (nread == -1 && errno == EINTR) continue;
+
+    if (nread <= 0) return -1;
+
+    done += (size_t) nread;
+  }
+
+  return 1;
+}
+
+// a stream of its own over the probed file, positioned at the start
+
+FILE *jmprobe_fdopen (const jmprobe_t *probe)
+{
+  if (probe->fd == -1) return NULL;
+
+  const int fd = dup (probe->fd);
+
+  if (fd == -1)
+  {
+    fprintf (stderr, "%s: %s\n", probe->fpath, strerror (errno));
+
+    return NULL;
+  }
+
+  FILE *fp = fdopen (fd, "rb");
+
+  if (fp == NULL)
+  {
+    fprintf (stderr, "%s: %s\n", probe->fpath, strerror (errno));
+
+    close (fd);
+
+    return NULL;
+  }
+
+  if (fseeko (fp, 0, SEEK_SET) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", probe->fpath, strerror (errno));
+
+    fclose (fp);
+
+    return NULL;
+  }
+
+  return fp;
+}
+
+int jmarena_init (jmarena_t *arena, const size_t chunk_size)
+{
+  arena->head       = NULL;
+  arena->chunk_size = chunk_size;
+
+  return 1;
+}
+
+void *jmarena_alloc (jmarena_t *arena, const size_t len)
+{
+  // keep everything handed out aligned for any type
+
+  const size_t need = (len + (JMARENA_ALIGN - 1)) & ~((size_t) JMARENA_ALIGN - 1);
+
+  jmarena_chunk_t *chunk = arena->head;
+
+  if ((chunk == NULL) || ((chunk->size - chunk->used) < need))
+  {
+    // anything larger than a chunk gets one of its own
+
+    const size_t size = MAX (arena->chunk_size, need);
+
+    chunk = (jmarena_chunk_t *) jmmalloc (JMARENA_CHUNK_HDR + size);
+
+    if (chunk == NULL) return NULL;
+
+    chunk->next = arena->head;
+    chunk->size = size;
+    chunk->used = 0;
+
+    arena->head = chunk;
+  }
+
+  void *p = (u8 *) chunk + JMARENA_CHUNK_HDR + chunk->used;
+
+  chunk->used += need;
+
+  return p;
+}
+
+// gives everything back, one chunk of chunk_size is kept for reuse, oversized ones never are
+void jmarena_reset (jmarena_t *arena)
+{
+  jmarena_chunk_t *keep = NULL;
+
+  jmarena_chunk_t *chunk = arena->head;
+
+  while (chunk != NULL)
+  {
+    jmarena_chunk_t *next = chunk->next;
+
+    if ((keep == NULL) && (chunk->size == arena->chunk_size))
+    {
+      keep = chunk;
+    }
+    else
+    {
+      jmfree (chunk);
+    }
+
+    chunk = next;
+  }
+
+  if (keep != NULL)
+  {
+    keep->next = NULL;
+    keep->used = 0;
+  }
+
+  arena->head = keep;
+}
+
+void jmarena_destory (jmarena_t *arena)
+{
+  jmarena_reset (arena);
+
+  jmfree (arena->head);
+
+  arena->head = NULL;
 }
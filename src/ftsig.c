@@ -0,0 +1,241 @@
+/*
+ * ftsig, table-driven file type detection.
+ *
+ * The magics are compiled into one Aho-Corasick automaton (a full
+ * transition table, the failure links are folded in while building), so a
+ * scan is one table lookup per byte whatever the number of signatures.
+ * The head pass stops at the farthest byte any anchored or windowed
+ * signature can end at, the SFX pass at FTSIG_SFX_WINDOW.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+
+#include "ftsig.h"
+
+// earlier entries win if several match, keep the more specific ones first
+
+static const ftsig_t FTSIG_TABLE[] =
+{
+  { "office", OFFICE_MAGIC,  4, FTSIG_ANCHORED, 0,     9400 },
+  { "pdf",    PDF_MAGIC "-", 5, FTSIG_WINDOW,   1019, 10400 }, // anywhere in the first 1024 bytes
+  { "7z",     SZIP_MAGIC,    6, FTSIG_ANCHORED, 0,    11600 },
+  { "rar3",   RAR3_MAGIC,    7, FTSIG_ANCHORED, 0,    12500 },
+  { "rar5",   RAR5_MAGIC,    7, FTSIG_ANCHORED, 0,    12500 },
+  { "zip",    PKZIP_MAGIC,   4, FTSIG_ANCHORED, 0,    13600 },
+  { "pcap",   TCPDUMP_MAGIC, 4, FTSIG_ANCHORED, 0,     2500 },
+  { "pcap",   TCPDUMP_CIGAM, 4, FTSIG_ANCHORED, 0,     2500 },
+  { "pcapng", PCAPNG_MAGIC,  4, FTSIG_ANCHORED, 0,     2500 },
+  { "7z",     SZIP_MAGIC,    6, FTSIG_EMBEDDED, 0,    11600 },
+  { "rar3",   RAR3_MAGIC,    7, FTSIG_EMBEDDED, 0,    12500 },
+  { "rar5",   RAR5_MAGIC,    7, FTSIG_EMBEDDED, 0,    12500 },
+};
+
+#define FTSIG_CNT (sizeof (FTSIG_TABLE) / sizeof (FTSIG_TABLE[0]))
+
+_Static_assert ((sizeof (FTSIG_TABLE) / sizeof (FTSIG_TABLE[0])) <= FTSIG_MAX, "too many signatures for the output mask");
+
+struct ftsig_ac {
+  u32  states_cnt;
+  u32 (*next)[256];
+  u64 *out;           // signatures ending in a state, its suffixes included
+
+  u64  head_mask;     // anchored and windowed ones
+  u64  embedded_mask;
+
+  size_t head_scan_len;
+
+  int  ok;
+};
+
+typedef struct ftsig_ac ftsig_ac_t;
+
+static ftsig_ac_t ftsig_ac;
+
+static pthread_once_t ftsig_ac_once = PTHREAD_ONCE_INIT;
+
+static void ftsig_ac_build (void)
+{
+  ftsig_ac_t *ac = &ftsig_ac;
+
+  size_t states_max = 1;
+
+  for (u32 i = 0; i < FTSIG_CNT; i++) states_max += FTSIG_TABLE[i].magic_len;
+
+  ac->next = (u32 (*)[256]) jmcalloc (states_max, sizeof (u32) * 256);
+  ac->out  = (u64 *)        jmcalloc (states_max, sizeof (u64));
+
+  u32 *fail  = (u32 *) jmcalloc (states_max, sizeof (u32));
+  u32 *queue = (u32 *) jmcalloc (states_max, sizeof (u32));
+
+  if (ac->next == NULL || ac->out == NULL || fail == NULL || queue == NULL)
+  {
+    jmfree (ac->next);
+    jmfree (ac->out);
+    jmfree (fail);
+    jmfree (queue);
+
+    ac->next = NULL;
+    ac->out  = NULL;
+
+    return;
+  }
+
+  // trie, 0 is the root and never a child, so 0 also means no edge
+
+  ac->states_cnt = 1;
+
+  for (u32 i = 0; i < FTSIG_CNT; i++)
+  {
+    const ftsig_t *sig = &FTSIG_TABLE[i];
+
+    const u8 *magic = (const u8 *) sig->magic;
+
+    u32 state = 0;
+
+    for (u32 j = 0; j < sig->magic_len; j++)
+    {
+      if (ac->next[state][magic[j]] == 0) ac->next[state][magic[j]] = ac->states_cnt++;
+
+      state = ac->next[state][magic[j]];
+    }
+
+    ac->out[state] |= 1ull << i;
+
+    if (sig->kind == FTSIG_EMBEDDED)
+    {
+      ac->embedded_mask |= 1ull << i;
+    }
+    else
+    {
+      ac->head_mask |= 1ull << i;
+
+      const size_t end = (size_t) sig->offset + sig->magic_len;
+
+      if (end > ac->head_scan_len) ac->head_scan_len = end;
+    }
+  }
+
+  // breadth first, a state's failure target is always done before it
+
+  u32 q_head = 0;
+  u32 q_tail = 0;
+
+  for (u32 c = 0; c < 256; c++)
+  {
+    const u32 child = ac->next[0][c];
+
+    if (child == 0) continue;
+
+    fail[child] = 0;
+
+    queue[q_tail++] = child;
+  }
+
+  while (q_head < q_tail)
+  {
+    const u32 state = queue[q_head++];
+
+    ac->out[state] |= ac->out[fail[state]];
+
+    for (u32 c = 0; c < 256; c++)
+    {
+      const u32 child = ac->next[state][c];
+
+      if (child == 0)
+      {
+        ac->next[state][c] = ac->next[fail[state]][c];
+
+        continue;
+      }
+
+      fail[child] = ac->next[fail[state]][c];
+
+      queue[q_tail++] = child;
+    }
+  }
+
+  jmfree (fail);
+  jmfree (queue);
+
+  ac->ok = 1;
+}
+
+// the head is scanned to its end and the best table entry wins, embedded
+// ones stop at the first position any of them ends at
+static int ftsig_ac_scan (const ftsig_ac_t *ac, const u8 *buf, const size_t len, const u64 mask, ftsig_match_t *match)
+{
+  u32 state = 0;
+
+  for (size_t pos = 0; pos < len; pos++)
+  {
+    state = ac->next[state][buf[pos]];
+
+    u64 hits = ac->out[state] & mask;
+
+    while (hits)
+    {
+      const u32 idx = __builtin_ctzll (hits);
+
+      hits &= hits - 1;
+
+      const ftsig_t *sig = &FTSIG_TABLE[idx];
+
+      const size_t start = pos + 1 - sig->magic_len;
+
+      if ((sig->kind == FTSIG_ANCHORED) && (start != sig->offset)) continue;
+      if ((sig->kind == FTSIG_WINDOW)   && (start >  sig->offset)) continue;
+
+      if ((match->sig == NULL) || (sig < match->sig))
+      {
+        match->sig    = sig;
+        match->offset = start;
+      }
+    }
+
+    if ((match->sig != NULL) && (mask == ac->embedded_mask)) return 1;
+  }
+
+  return (match->sig != NULL) ? 1 : 0;
+}
+
+int ftsig_detect (const jmprobe_t *probe, ftsig_match_t *match)
+{
+  memset (match, 0, sizeof (ftsig_match_t));
+
+  pthread_once (&ftsig_ac_once, ftsig_ac_build);
+
+  const ftsig_ac_t *ac = &ftsig_ac;
+
+  if (ac->ok == 0)
+  {
+    fprintf (stderr, "%s: %s\n", probe->fpath, MSG_ENOMEM);
+
+    return -1;
+  }
+
+  // head pass, every anchored or windowed signature ends within it
+
+  const size_t head_len = (probe->head_len < ac->head_scan_len) ? probe->head_len : ac->head_scan_len;
+
+  if (ftsig_ac_scan (ac, probe->head, head_len, ac->head_mask, match) == 1) return 1;
+
+  // archives behind an SFX stub
+
+  if ((probe->head_len < FTSIG_SFX_STUB_LEN) || (memcmp (probe->head, FTSIG_SFX_STUB, FTSIG_SFX_STUB_LEN) != 0)) return 0;
+
+  jmmap_t map;
+
+  if (jmprobe_map (probe, &map) == -1) return -1;
+
+  const size_t window = (map.len < FTSIG_SFX_WINDOW) ? map.len : FTSIG_SFX_WINDOW;
+
+  const int ret = ftsig_ac_scan (ac, map.buf, window, ac->embedded_mask, match);
+
+  jmmap_close (&map);
+
+  return ret;
+}
@@ -1,10 +1,14 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "hccvt.h"
 
-static void remove_colon (char *src_file_buffer, char *des_file_buffer, int *hchash_len)
+static void remove_colon (const char *src_file_buffer, char *des_file_buffer, size_t *hchash_len)
 {
-  char *find_position = src_file_buffer;
+  const char *find_position = src_file_buffer;
 
-  int prefix_fname_len = 0;
+  size_t prefix_fname_len = 0;
 
   while ((find_position = strchr (find_position, ':')) != NULL)
   {
@@ -25,62 +29,21 @@ static void remove_colon (char *src_file_buffer, char *des_file_buffer, int *hch
   }
 }
 
-static int office_vague2exp_mode (char *version, int *hash_mode)
+static int office_vague2exp_mode (const int version, int *hash_mode)
 {
-  if (strcmp (version, "2007") == 0)
-  {
-    *hash_mode = 9400;
-  }
-  else if (strcmp (version, "2010") == 0)
-  {
-    *hash_mode = 9500;
-  }
-  else if (strcmp (version, "2013") == 0)
-  {
-    *hash_mode = 9600;
-  }
-  else
+  switch (version)
   {
+  case 2007: *hash_mode = 9400; break;
+  case 2010: *hash_mode = 9500; break;
+  case 2013: *hash_mode = 9600; break;
+  default:
     printf ("office version error\n");
-
     return -1;
   }
   return 0;
 }
 
-static void remove_double_colon (char *src_file_buffer, char *des_file_buffer, int *hchash_len)
-{
-  char *find_position = src_file_buffer;
-
-  int len1 = 0, len2 = 0;
-
-  int prefix_fname_len = 0;
-
-  while ((find_position = strchr (find_position, ':')) != NULL)
-  {
-    find_position++;
-
-    if ((*find_position) == '$')
-    {
-      break;
-    }
-  }
-
-  prefix_fname_len = find_position - src_file_buffer;
-
-  len1 = strlen (find_position);
-
-  if ((find_position = strchr (find_position, ':')) != NULL)
-    len2 = strlen (find_position);
-
-  *hchash_len = len1 - len2;
-
-  // memcpy (des_file_buffer, src_file_buffer + *file_len - len1 + 1, len1 - len2);
-  memcpy (des_file_buffer, src_file_buffer + prefix_fname_len, *hchash_len);
-
-}
-
-static int rar_vague2exp_mode (char *src_path, char *version, int *hash_mode)
+static int rar_vague2exp_mode (const rfile_info_ctx_t *rfile_info_ctx, char *version, int *hash_mode)
 {
   // if (memcmp (version, "$rar5$", 6) == 0)
   if (strcmp (version, "$rar5$") == 0)
@@ -89,16 +52,15 @@ static int rar_vague2exp_mode (char *src_path, char *version, int *hash_mode)
   }
   else if (strcmp (version, "$RAR3$") == 0)
   {
-    char tmp[24] = { 0 };
-    FILE *fp = NULL;
+    // archive header flags, behind the marker (which may follow an sfx stub)
 
-    if ((fp = fopen (src_path, "rb")) == NULL)
+    u8 tmp[12] = { 0 };
+
+    if (jmprobe_read_at (&rfile_info_ctx->probe, rfile_info_ctx->magic_offset, tmp, sizeof (tmp)) == -1)
     {
-      printf ("error:open file %s failed\n", src_path);
+      printf ("error:read file %s failed\n", rfile_info_ctx->path);
       return -1;
     }
-    fread (tmp, 1, 12, fp);
-    fclose (fp);
     if (tmp[10] & 0x80)
     {
       *hash_mode = 12500;
@@ -145,23 +107,17 @@ static int pdf_vague2exp_mode (char *version, int *hash_mode)
   return 0;
 }
 
-static int vague2exp_mode (char *src_path, char *des_file_buffer, int *hash_mode)
+static int vague2exp_mode (const rfile_info_ctx_t *rfile_info_ctx, char *des_file_buffer, int *hash_mode)
 {
   char version[10] = { 0 };
   int ret = 0;
 
   switch (*hash_mode)
   {
-  case 9500:
-  case 9400:
-  case 9600:
-    memcpy (version, des_file_buffer + 9, 4);
-    office_vague2exp_mode (version, hash_mode);
-    break;
   case 12500:
   case 13000:
     memcpy (version, des_file_buffer, 6);
-    if (rar_vague2exp_mode (src_path, version, hash_mode))
+    if (rar_vague2exp_mode (rfile_info_ctx, version, hash_mode))
     {
       return ret;
     }
@@ -182,13 +138,11 @@ static int vague2exp_mode (char *src_path, char *des_file_buffer, int *hash_mode
   return 0;
 }
 
-static void file_len_without_newline (char *src_file_buffer, int *file_len)
+static void file_len_without_newline (const char *src_file_buffer, size_t *file_len)
 {
-  int i;
-
-  for (i = *file_len - 1; i > 0; i--)
+  for (size_t i = *file_len; i > 1; i--)
   {
-    if (src_file_buffer[i] == '\r' || src_file_buffer[i] == '\n')
+    if (src_file_buffer[i - 1] == '\r' || src_file_buffer[i - 1] == '\n')
     {
       (*file_len)--;
       continue;
@@ -197,9 +151,10 @@ static void file_len_without_newline (char *src_file_buffer, int *file_len)
   }
 }
 
-static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
+// src_file_buffer need not be 0-terminated, raw hash files are mapped
+static int check_file_len (const char *src_file_buffer, size_t file_len, int hash_mode)
 {
-  char *seporater = NULL;
+  const char *seporater = NULL;
 
   switch (hash_mode)
   {
@@ -207,7 +162,7 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   case 1000:
     if (file_len != 32)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
@@ -217,11 +172,11 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   case 40:
   case 50:
   case 60:
-    if ((seporater = strchr (src_file_buffer, ':')) != NULL)
+    if ((seporater = (const char *) memchr (src_file_buffer, ':', file_len)) != NULL)
     {
       if ((seporater - src_file_buffer) != 32)
       {
-        printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+        printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
         return -1;
       }
     }
@@ -231,11 +186,11 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   case 120:
   case 130:
   case 140:
-    if ((seporater = strchr (src_file_buffer, ':')) != NULL)
+    if ((seporater = (const char *) memchr (src_file_buffer, ':', file_len)) != NULL)
     {
       if ((seporater - src_file_buffer) != 40)
       {
-        printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+        printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
         return -1;
       }
     }
@@ -243,14 +198,14 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   case 200:
     if (file_len != 16)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
   case 300:
     if (file_len != 40)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
@@ -258,28 +213,28 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   case 500:
     if (file_len != 34)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
   case 1500:
     if (file_len != 13)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
   case 3000:
     if (file_len != 16)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
   case 8600:
     if (file_len != 32)
     {
-      printf ("error:hash type %d file len %d out of range\n", hash_mode, file_len);
+      printf ("error:hash type %d file len %zu out of range\n", hash_mode, file_len);
       return -1;
     }
     break;
@@ -287,52 +242,77 @@ static int check_file_len (char *src_file_buffer, int file_len, int hash_mode)
   return 0;
 }
 
-static int vague_to_explicit_hashmode (rfile_info_ctx_t *rfile_info_ctx)
+// a record with room for len + 1 bytes right behind it, val points there
+static hash_rec_t *hash_rec_alloc (hash_ctx_t *hct, const size_t len)
 {
-  hash_ctx_t *hct             = rfile_info_ctx->hash_ctx;
-  char       *temp_path       = rfile_info_ctx->tmp_fpath;
-  char       *src_path        = rfile_info_ctx->path;
+  hash_rec_t *rec = (hash_rec_t *) jmarena_alloc (&hct->arena, sizeof (hash_rec_t) + len + 1);
 
-  int         file_len        = 0;
-  char       *src_file_buffer = NULL;
-  char       *des_file_buffer = NULL;
-  FILE       *fp              = NULL;
-  int         ret             = 0;
-  int         hash_mode       = hct->hash_mode;
+  if (rec == NULL) return NULL;
 
-  if (get_file_len (temp_path, &file_len) == -1) return -1;
+  rec->len = len;
+  rec->val = (const char *) (rec + 1);
 
-  src_file_buffer = (char *) calloc (file_len + 5, sizeof (char));
-  des_file_buffer = (char *) calloc (file_len + 5, sizeof (char));
+  return rec;
+}
 
-  if (NULL == src_file_buffer || NULL == des_file_buffer)
-  {
-    printf ("malloc error\n");
-    return -1;
-  }
+// raw hash files are the hash already, the record points into the mapping, nothing is copied
+static int raw_to_explicit_hashmode (rfile_info_ctx_t *rfile_info_ctx, const jmmap_t *map)
+{
+  hash_ctx_t *hct       = rfile_info_ctx->hash_ctx;
+
+  const char *src       = (const char *) map->buf;
+  size_t      file_len  = map->len;
+  int         hash_mode = hct->hash_mode;
+
+  file_len_without_newline (src, &file_len);
 
-  if (hash_mode == 2500)
+  check_file_len (src, file_len, hash_mode);
+
+  if (hash_mode == 200 || hash_mode == 300)
   {
-    if ((fp = fopen (temp_path, "rb")) == NULL)
+    if (file_len == 16)
     {
-      printf ("error:Fail to open file %s\n", temp_path);
-      free (src_file_buffer);
-      free (des_file_buffer);
-      return -1;
+      hash_mode = 200;
     }
-  }
-  else
-  {
-    if ((fp = fopen (temp_path, "r")) == NULL)
+    else if (file_len == 40)
     {
-      printf ("error:Fail to open file %s\n", temp_path);
-      free (src_file_buffer);
-      free (des_file_buffer);
+      hash_mode = 300;
+    }
+    else
+    {
+      printf ("error:hashtype 200/300 file_len %zu out of range\n", file_len);
       return -1;
     }
   }
 
-  fread (src_file_buffer, file_len, 1, fp);
+  hash_rec_t *rec = (hash_rec_t *) jmarena_alloc (&hct->arena, sizeof (hash_rec_t));
+
+  if (rec == NULL) return -1;
+
+  rec->len = file_len;
+  rec->val = src;
+
+  hct->hash = rec;
+  hct->hash_mode = hash_mode;
+
+  return 1;
+}
+
+// src_file_buffer is the converter output, 0-terminated
+static int vague_to_explicit_hashmode (rfile_info_ctx_t *rfile_info_ctx, const char *src_file_buffer, size_t file_len)
+{
+  hash_ctx_t *hct             = rfile_info_ctx->hash_ctx;
+
+  int         ret             = 0;
+  int         hash_mode       = hct->hash_mode;
+
+  // the hash is built in place, never longer than the converter output
+
+  hash_rec_t *rec = hash_rec_alloc (hct, file_len);
+
+  if (rec == NULL) return -1;
+
+  char *des_file_buffer = (char *) (rec + 1);
 
   // ascii text (end with '\n' or '\r\n')
 
@@ -348,100 +328,132 @@ static int vague_to_explicit_hashmode (rfile_info_ctx_t *rfile_info_ctx)
 
   switch (hash_mode)
   {
-  case 200:
-  case 300:
-    memcpy (des_file_buffer, src_file_buffer, file_len);
-    if (file_len == 16)
-    {
-      hash_mode = 200;
-    }
-    else if (file_len == 40)
-    {
-      hash_mode = 300;
-    }
-    else
-    {
-      printf ("error:hashtype 200/300 file_len %d out of range\n", file_len);
-      return -1;
-    }
-    break;
-  case 9500:
-  case 9400:
-  case 9600:
-    remove_colon (src_file_buffer, des_file_buffer, &file_len);
-
-    ret = vague2exp_mode (src_path, des_file_buffer, &hash_mode);
-    if (ret != 0)
-    {
-      printf ("error:Fail to get version\n");
-      free (src_file_buffer);
-      free (des_file_buffer);
-      fclose (fp);
-      return -1;
-    }
-    break;
   case 10400:
   case 10500:
   case 10600:
   case 10700:
     memcpy (des_file_buffer, src_file_buffer, file_len);
 
-    ret = vague2exp_mode (src_path, des_file_buffer, &hash_mode);
+    des_file_buffer[file_len] = 0;
+
+    ret = vague2exp_mode (rfile_info_ctx, des_file_buffer, &hash_mode);
 
     if (ret != 0 && ret != ERROR_NUM_WARNING)
     {
       printf ("error:Fail to get version\n");
-      free (src_file_buffer);
-      free (des_file_buffer);
-      fclose (fp);
       return -1;
     }
     break;
   case 12500:
   case 13000:
+    memset (des_file_buffer, 0, file_len + 1);
+
     remove_colon (src_file_buffer, des_file_buffer, &file_len);
 
-    ret = vague2exp_mode (src_path, des_file_buffer, &hash_mode);
+    ret = vague2exp_mode (rfile_info_ctx, des_file_buffer, &hash_mode);
     if (ret != 0)
     {
       printf ("error:Fail to get version\n");
-      free (src_file_buffer);
-      free (des_file_buffer);
-      fclose (fp);
       return -1;
     }
     break;
-  case 13600:
-    remove_double_colon (src_file_buffer, des_file_buffer, &file_len);
-    break;
   default:
     memcpy (des_file_buffer, src_file_buffer, file_len);
     break;
   }
 
-  memcpy (hct->hash_val, des_file_buffer, file_len);
+  des_file_buffer[file_len] = 0;
 
-  hct->len = file_len;
-  hct->hash_mode = hash_mode;
+  rec->len = file_len;
 
-  free (src_file_buffer);
-  free (des_file_buffer);
-  fclose (fp);
+  hct->hash = rec;
+  hct->hash_mode = hash_mode;
 
   return 1;
 }
 
+// zip: the hash comes back bare, no colon fields to strip
+static int extract_zip (rfile_info_ctx_t *rfile_info_ctx, membuf_t *out)
+{
+  zip2hc_info_t zip_info;
+
+  const int ret = zip2hc_extract (&rfile_info_ctx->probe, out, &zip_info);
+
+  if (ret == -1) return -1;
+
+  const char *version = NULL;
+
+  switch (zip_info.kind)
+  {
+  case ZIP2HC_KIND_AES:    version = "aes";    break;
+  case ZIP2HC_KIND_STRONG: version = "strong"; break;
+  case ZIP2HC_KIND_PKZIP:  version = "pkzip";  break;
+  default:                                     break;
+  }
+
+  if (version != NULL)
+  {
+    snprintf (rfile_info_ctx->type,    sizeof (rfile_info_ctx->type),    "zip");
+    snprintf (rfile_info_ctx->version, sizeof (rfile_info_ctx->version), "%s", version);
+  }
+
+  return ret;
+}
+
+// office: the hash comes back bare, the mode follows from the parsed version
+static int extract_office (rfile_info_ctx_t *rfile_info_ctx, membuf_t *out)
+{
+  office2hc_info_t office_info;
+
+  const int ret = office2hc_extract (&rfile_info_ctx->probe, out, &office_info);
+
+  if (ret == -1) return -1;
+
+  if (office_info.version == 0) return ret;
+
+  if (office_vague2exp_mode (office_info.version, &rfile_info_ctx->hash_ctx->hash_mode) == -1) return -1;
+
+  snprintf (rfile_info_ctx->type,    sizeof (rfile_info_ctx->type),    "office");
+  snprintf (rfile_info_ctx->version, sizeof (rfile_info_ctx->version), "%d", office_info.version);
+
+  return ret;
+}
+
 // need vague or specific hash_mode
 int extract_hchash_vaguemode (rfile_info_ctx_t *rfile_info_ctx)
 {
   char *src_path = rfile_info_ctx->path;
-  char *temp_path = rfile_info_ctx->tmp_fpath;
   hash_ctx_t *hct = rfile_info_ctx->hash_ctx;
 
   int ret = 0;
-  char command[2000] = { 0 };
 
-  int temp_flen = 0;
+  // normally still open from get_rw_rfile_ftype (), this is its last user
+
+  jmprobe_t *probe = &rfile_info_ctx->probe;
+
+  if ((probe->fd == -1) && (jmprobe_open (probe, src_path) == -1)) return -1;
+
+  // converters are run directly, argv[0] is the tool
+
+  char *argv[4] = { NULL };
+
+  char signed_path[sizeof (CVTTOOLS_SIGNATRUE) + FILE_PATH_MAXLEN] = { 0 };
+
+  membuf_t out;
+
+  if (membuf_init (&out, HCBUFSIZ_TINY) == -1)
+  {
+    jmprobe_close (probe);
+
+    return -1;
+  }
+
+  // raw hash files are the hash already, they are mapped and used in place, the
+  // mapping is kept until the ctx moves on to the next file
+
+  jmmap_t *map = hct->map;
+
+  bool raw = false;
 
   int hash_mode = hct->hash_mode;
 
@@ -480,73 +492,76 @@ int extract_hchash_vaguemode (rfile_info_ctx_t *rfile_info_ctx)
   case 14500:
   case 20000:
   case 20001:
-    copy_file (src_path, temp_path);
-    // sprintf (command, "cp \'%s\' \'%s\'", src_path, temp_path);
+    raw = true;
+    ret = jmprobe_map (probe, map);
     break;
 
   case 2500:
-    sprintf (command, "%s %s %s", CAP_TO_HCCPAX_PATH, src_path, temp_path);
-    /* ret = hccap_crackfile(src_path, temp_path); */
-    /* if(ret != 0) */
-    /* { */
-    /* printf("error:Fail to modify the crack file\n"); */
-    /* return -1; */
-    /* } */
+    ret = cap2hc_extract (probe, &out);
     break;
   case 6213:
   case 6223:
   case 6233:
   case 6243:
-    sprintf (command, "%s " CVTTOOLS_SIGNATRUE"%s > %s", TRUECRYPT_TO_JOHN_PATH, src_path, temp_path);
+    snprintf (signed_path, sizeof (signed_path), CVTTOOLS_SIGNATRUE "%s", src_path);
+    argv[0] = (char *) TRUECRYPT_TO_JOHN_PATH;
+    argv[1] = signed_path;
     break;
   case 9500:
   case 9400:
   case 9600:
-    sprintf (command, "%s " CVTTOOLS_SIGNATRUE" %s > %s", OFFICE_TO_JOHN_PATH, src_path, temp_path);
+    ret = extract_office (rfile_info_ctx, &out);
     break;
   case 10400:
   case 10500:
   case 10600:
   case 10700:
-    sprintf (command, "%s " CVTTOOLS_SIGNATRUE" %s > %s", PDF_TO_HASHCAT_PATH, src_path, temp_path);
+    ret = pdf2hc_extract (probe, &out);
     break;
   case 11600:
-    sprintf (command, "%s %s > %s", SZIP_TO_JOHN_PATH, src_path, temp_path);
+    ret = szip2hc_extract (probe, &out);
     break;
   case 12500:
   case 13000:
-    sprintf (command, "%s %s > %s", RAR_TO_JOHN_PATH, src_path, temp_path);
+    ret = rar2hc_extract (probe, &out);
     break;
   case 13600:
-    sprintf (command, "%s %s > %s", ZIP_TO_JOHN_PATH, src_path, temp_path);
+    ret = extract_zip (rfile_info_ctx, &out);
     break;
     /* varacrypt */
   case 13721:
-    sprintf (command, "./hc2john %s > %s", src_path, temp_path);
+    argv[0] = (char *) "./hc2john";
+    argv[1] = src_path;
     break;
   default:
-    copy_file (src_path, temp_path);
-    // sprintf (command, "cp \'%s\' \'%s\'", src_path, temp_path);
+    raw = true;
+    ret = jmprobe_map (probe, map);
     break;
   }
 
-  system (command);
+  if (argv[0] != NULL) ret = jmpcapture (argv, &out);
 
-  if (get_file_len (temp_path, &temp_flen) == -1)
+  if (ret == -1)
   {
-    printf ("%s:temp_path len 0\n", temp_path);
+    fprintf (stderr, "%s: could not get converter output\n", src_path);
+
+    jmmap_close (map);
+
+    jmprobe_close (probe);
+
+    membuf_destory (&out);
 
     return -1;
   }
 
-  // printf ("tmp file len %d\n", temp_flen);
+  const size_t src_len = (raw == true) ? map->len : out.len;
 
-  if (temp_flen == 0) rfile_info_ctx->file_encryption = FILE_UNENCRYPTED;
-  if (temp_flen != 0) rfile_info_ctx->file_encryption = FILE_ENCRYPTED;
+  if (src_len == 0) rfile_info_ctx->file_encryption = FILE_UNENCRYPTED;
+  if (src_len != 0) rfile_info_ctx->file_encryption = FILE_ENCRYPTED;
 
   if (rfile_info_ctx->file_encryption == FILE_ENCRYPTED)
   {
-    ret = vague_to_explicit_hashmode (rfile_info_ctx);
+    ret = (raw == true) ? raw_to_explicit_hashmode (rfile_info_ctx, map) : vague_to_explicit_hashmode (rfile_info_ctx, out.buf, out.len);
 
     // printf ("vague_to_explicit_hashmode(): %d\n", rfile_info_ctx->hash_ctx->hash_mode);
 
@@ -554,16 +569,19 @@ int extract_hchash_vaguemode (rfile_info_ctx_t *rfile_info_ctx)
     {
       fprintf (stderr, "get hash value failed\n");
 
+      jmmap_close (map);
+
+      jmprobe_close (probe);
+
+      membuf_destory (&out);
+
       return -1;
     }
   }
 
-  if (remove(temp_path) == -1)
-  {
-    fprintf (stderr, "could not remove temp %s\n", temp_path);
+  jmprobe_close (probe);
 
-    return -1;
-  }
+  membuf_destory (&out);
 
   return 1;
 }
@@ -581,87 +599,182 @@ int get_rw_rfile_ftype (rfile_info_ctx_t *rfile_info_ctx)
 
   char *fpath = rfile_info_ctx->path;
 
-  FILE *rfp = fopen (fpath, "rb");
+  // the file stays open for extract_hchash_vaguemode ()
 
-  if (rfp == NULL)
-  {
-    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+  jmprobe_t *probe = &rfile_info_ctx->probe;
 
-    return -1;
-  }
+  jmprobe_close (probe);
+
+  if (jmprobe_open (probe, fpath) == -1) return -1;
 
   // check file header
 
-  unknown_file_header_t unknown_file_header;
+  ftsig_match_t match;
 
-  const int nread = fread (&unknown_file_header, sizeof (unknown_file_header_t), 1, rfp);
+  const int ret = ftsig_detect (probe, &match);
 
-  if (nread != 1)
+  if (ret == 1)
   {
-    fprintf (stderr, "%s: Could not read file header \n", fpath);
+    hash_ctx->hash_mode = match.sig->hash_mode;
 
-    return -1;
-  }
-
-  if (memcmp (unknown_file_header.magic, OFFICE_MAGIC, 4) == 0)
-  {
-    hash_ctx->hash_mode = 9400;
+    rfile_info_ctx->magic_offset = match.offset;
   }
 
-  if (memcmp (unknown_file_header.magic, PDF_MAGIC, 4) == 0)
+  if (ret == 0)
   {
-    hash_ctx->hash_mode = 10400;
+    fprintf (stderr, "%s: unknown file type \n", fpath);
   }
 
-  if (memcmp (unknown_file_header.magic, SZIP_MAGIC, 6) == 0)
+  if (ret != 1)
   {
-    hash_ctx->hash_mode = 11600;
-  }
+    jmprobe_close (probe);
 
-  if (memcmp (unknown_file_header.magic, RAR3_MAGIC, 7) == 0 || memcmp (unknown_file_header.magic, RAR5_MAGIC, 7) == 0)
-  {
-    hash_ctx->hash_mode = 12500;
+    return -1;
   }
 
-  if (memcmp (unknown_file_header.magic, PKZIP_MAGIC, 4) == 0)
-  {
-    hash_ctx->hash_mode = 13600;
-  }
+  // printf ("%s -> vague hash mode: %d \n", fpath, hash_ctx->hash_mode);
 
-  if (memcmp (unknown_file_header.magic, TCPDUMP_MAGIC, 4) == 0 || memcmp (unknown_file_header.magic, TCPDUMP_CIGAM, 4) == 0)
-  {
-    hash_ctx->hash_mode = 2500;
-  }
+  return 1;
+}
 
-  if (hash_ctx->hash_mode == -1)
-  {
-    fprintf (stderr, "%s: unknown file type \n", fpath);
+int hash_ctx_init (hash_ctx_t *hash_ctx)
+{
+  jmarena_init (&hash_ctx->arena, HASH_ARENA_CHUNK_SIZE);
 
-    return -1;
-  }
+  hash_ctx->map = (jmmap_t *) jmcalloc (1, sizeof (jmmap_t));
 
-  // printf ("%s -> vague hash mode: %d \n", fpath, hash_ctx->hash_mode);
+  if (hash_ctx->map == NULL) return -1;
 
-  fclose (rfp);
+  hash_ctx_reset (hash_ctx);
 
   return 1;
 }
 
-int hash_ctx_init (hash_ctx_t *hash_ctx)
+// forget the previous file's hash, its memory is reused
+void hash_ctx_reset (hash_ctx_t *hash_ctx)
 {
-  hash_ctx->hash_mode = -1;
-  hash_ctx->len = 0;
+  jmarena_reset (&hash_ctx->arena);
+
+  jmmap_close (hash_ctx->map);
 
-  memset (hash_ctx->hash_val, 0, sizeof (hash_ctx->hash_val));
+  hash_ctx->hash_mode = -1;
+  hash_ctx->hash = NULL;
 
   hash_ctx->is_valid = false;
+}
+
+int hash_ctx_destory (hash_ctx_t *hash_ctx)
+{
+  jmarena_destory (&hash_ctx->arena);
+
+  if (hash_ctx->map != NULL) jmmap_close (hash_ctx->map);
+
+  jmfree (hash_ctx->map);
+
+  hash_ctx->map  = NULL;
+  hash_ctx->hash = NULL;
 
   return 1;
 }
 
-int hash_ctx_destory (hash_ctx_t *hash_ctx)
+int rfile_info_ctx_init (rfile_info_ctx_t *rfile_info_ctx)
 {
-  // jmfree (hash_ctx);
+  memset (rfile_info_ctx, 0, sizeof (rfile_info_ctx_t));
+
+  rfile_info_ctx->probe.fd = -1;
+
+  rfile_info_ctx->hash_ctx = (hash_ctx_t *) jmmalloc (sizeof (hash_ctx_t));
+
+  if (rfile_info_ctx->hash_ctx == NULL) return -1;
+
+  rfile_info_ctx->file_encryption = FILE_ENCRYPTION_UNKNOWN;
+
+  if (hash_ctx_init (rfile_info_ctx->hash_ctx) == -1) return -1;
 
   return 1;
 }
+
+// prepare a ctx for the next file, keeps hash_ctx
+void rfile_info_ctx_reset (rfile_info_ctx_t *rfile_info_ctx, const char *fpath)
+{
+  rfile_info_ctx->file_encryption = FILE_ENCRYPTION_UNKNOWN;
+
+  memset (rfile_info_ctx->type, 0, sizeof (rfile_info_ctx->type));
+  memset (rfile_info_ctx->version, 0, sizeof (rfile_info_ctx->version));
+  memset (rfile_info_ctx->path, 0, sizeof (rfile_info_ctx->path));
+
+  strncpy (rfile_info_ctx->path, fpath, sizeof (rfile_info_ctx->path) - 1);
+
+  jmprobe_close (&rfile_info_ctx->probe);
+
+  rfile_info_ctx->magic_offset = 0;
+
+  memset (&rfile_info_ctx->cache, 0, sizeof (rfile_cache_info_t));
+
+  hash_ctx_reset (rfile_info_ctx->hash_ctx);
+}
+
+void rfile_info_ctx_destory (rfile_info_ctx_t *rfile_info_ctx)
+{
+  jmprobe_close (&rfile_info_ctx->probe);
+
+  hash_ctx_destory (rfile_info_ctx->hash_ctx);
+
+  jmfree (rfile_info_ctx->hash_ctx);
+
+  rfile_info_ctx->hash_ctx = NULL;
+}
+
+int rfile_info_ctx_set_result (rfile_info_ctx_t *rfile_info_ctx, const int hash_mode, const file_encryption_t file_encryption, const char *hash, const size_t hash_len)
+{
+  hash_ctx_t *hct = rfile_info_ctx->hash_ctx;
+
+  if ((file_encryption == FILE_ENCRYPTED) && (hash != NULL))
+  {
+    hash_rec_t *rec = hash_rec_alloc (hct, hash_len);
+
+    if (rec == NULL) return -1;
+
+    char *val = (char *) (rec + 1);
+
+    memcpy (val, hash, hash_len);
+
+    val[hash_len] = 0;
+
+    hct->hash = rec;
+  }
+
+  hct->hash_mode = hash_mode;
+
+  rfile_info_ctx->file_encryption = file_encryption;
+
+  return 1;
+}
+
+u32 hccvt_variant (const int hash_mode)
+{
+  if (hash_mode == 2500) return cap2hc_get_best ();
+
+  return 0;
+}
+
+// checked by the last path component, it is in the full path too
+bool rfile_hash_is_path_free (const rfile_info_ctx_t *rfile_info_ctx)
+{
+  const hash_rec_t *hash = rfile_info_ctx->hash_ctx->hash;
+
+  if (hash == NULL) return true;
+
+  const char *base = rfile_info_ctx->path;
+
+  for (const char *p = rfile_info_ctx->path; *p != 0; p++)
+  {
+    if ((*p == '/') || (*p == '\\')) base = p + 1;
+  }
+
+  const size_t base_len = strlen (base);
+
+  if (base_len == 0) return true;
+
+  return memmem (hash->val, hash->len, base, base_len) == NULL;
+}
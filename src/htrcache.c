@@ -0,0 +1,519 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <time.h>
+#include <zlib.h>
+#include <sys/stat.h>
+
+#include "htrcache.h"
+#include "hccvt.h"
+#include "sha1.h"
+
+#if defined (_POSIX)
+#include <sys/file.h>
+#define HTR_CACHE_OPEN_FLAGS (O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC)
+#elif defined (_WIN)
+#include <io.h>
+#define HTR_CACHE_OPEN_FLAGS (O_RDWR | O_CREAT | O_APPEND | O_BINARY)
+#endif
+
+_Static_assert (sizeof (htr_cache_rec_t) == 88, "htr_cache_rec_t is written as is, it must not have padding");
+_Static_assert (RFILE_DIGEST_LEN == SHA1_DIGEST_LEN, "the cache digest is a sha1");
+
+// another hash_extr on the same cache appends too, loading and repairing must not race with it
+
+static void htr_cache_lock (const htr_cache_t *cache)
+{
+#if defined (_POSIX)
+  while ((flock (cache->fd, LOCK_EX) == -1) && (errno == EINTR)) {}
+#else
+  (void) cache;
+#endif
+}
+
+static void htr_cache_unlock (const htr_cache_t *cache)
+{
+#if defined (_POSIX)
+  flock (cache->fd, LOCK_UN);
+#else
+  (void) cache;
+#endif
+}
+
+static u64 htr_cache_mix (u64 x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+
+  return x;
+}
+
+static u64 htr_cache_stat_hash (const u64 dev, const u64 ino, const u64 size, const u64 mtime)
+{
+  return htr_cache_mix (dev ^ htr_cache_mix (ino ^ htr_cache_mix (size ^ htr_cache_mix (mtime))));
+}
+
+static u64 htr_cache_digest_hash (const u8 *digest)
+{
+  u64 h;
+
+  memcpy (&h, digest, sizeof (h));
+
+  return h;
+}
+
+static bool htr_cache_stat_eq (const htr_cache_rec_t *rec, const u64 dev, const u64 ino, const u64 size, const u64 mtime)
+{
+  return (rec->dev == dev) && (rec->ino == ino) && (rec->size == size) && (rec->mtime == mtime);
+}
+
+// the slot holding the key, or the free one it would go to
+static u32 *htr_cache_stat_slot (const htr_cache_t *cache, u32 *table, const u64 dev, const u64 ino, const u64 size, const u64 mtime)
+{
+  const u32 mask = cache->table_size - 1;
+
+  for (u32 pos = (u32) htr_cache_stat_hash (dev, ino, size, mtime) & mask;; pos = (pos + 1) & mask)
+  {
+    if (table[pos] == 0) return &table[pos];
+
+    if (htr_cache_stat_eq (&cache->ents[table[pos] - 1].rec, dev, ino, size, mtime)) return &table[pos];
+  }
+}
+
+static u32 *htr_cache_digest_slot (const htr_cache_t *cache, u32 *table, const u8 *digest)
+{
+  const u32 mask = cache->table_size - 1;
+
+  for (u32 pos = (u32) htr_cache_digest_hash (digest) & mask;; pos = (pos + 1) & mask)
+  {
+    if (table[pos] == 0) return &table[pos];
+
+    if (memcmp (cache->ents[table[pos] - 1].rec.digest, digest, RFILE_DIGEST_LEN) == 0) return &table[pos];
+  }
+}
+
+// index ent_idx (0-based) under both keys, replacing older entries with the same key
+static void htr_cache_index (htr_cache_t *cache, u32 *by_stat, u32 *by_digest, const u32 ent_idx)
+{
+  const htr_cache_rec_t *rec = &cache->ents[ent_idx].rec;
+
+  *htr_cache_stat_slot   (cache, by_stat,   rec->dev, rec->ino, rec->size, rec->mtime) = ent_idx + 1;
+  *htr_cache_digest_slot (cache, by_digest, rec->digest)                               = ent_idx + 1;
+}
+
+// keeps the tables at most half full
+static int htr_cache_grow (htr_cache_t *cache)
+{
+  if (cache->ents_cnt == cache->ents_size)
+  {
+    const u32 ents_size = (cache->ents_size == 0) ? HTR_CACHE_TABLE_MIN / 2 : cache->ents_size * 2;
+
+    htr_cache_ent_t *ents = (htr_cache_ent_t *) realloc (cache->ents, ents_size * sizeof (htr_cache_ent_t));
+
+    if (ents == NULL) return -1;
+
+    cache->ents      = ents;
+    cache->ents_size = ents_size;
+  }
+
+  if ((cache->ents_cnt + 1) * 2 <= cache->table_size) return 1;
+
+  const u32 table_size = (cache->table_size == 0) ? HTR_CACHE_TABLE_MIN : cache->table_size * 2;
+
+  u32 *by_stat   = (u32 *) jmcalloc (table_size, sizeof (u32));
+  u32 *by_digest = (u32 *) jmcalloc (table_size, sizeof (u32));
+
+  if (by_stat == NULL || by_digest == NULL)
+  {
+    jmfree (by_stat);
+    jmfree (by_digest);
+
+    return -1;
+  }
+
+  jmfree (cache->by_stat);
+  jmfree (cache->by_digest);
+
+  cache->by_stat    = by_stat;
+  cache->by_digest  = by_digest;
+  cache->table_size = table_size;
+
+  for (u32 i = 0; i < cache->ents_cnt; i++) htr_cache_index (cache, cache->by_stat, cache->by_digest, i);
+
+  return 1;
+}
+
+static int htr_cache_insert (htr_cache_t *cache, const htr_cache_rec_t *rec, const char *hash)
+{
+  if (htr_cache_grow (cache) == -1) return -1;
+
+  char *copy = (char *) jmarena_alloc (&cache->arena, rec->hash_len + 1);
+
+  if (copy == NULL) return -1;
+
+  memcpy (copy, hash, rec->hash_len);
+
+  copy[rec->hash_len] = 0;
+
+  htr_cache_ent_t *ent = &cache->ents[cache->ents_cnt];
+
+  ent->rec  = *rec;
+  ent->hash = copy;
+
+  htr_cache_index (cache, cache->by_stat, cache->by_digest, cache->ents_cnt++);
+
+  return 1;
+}
+
+static u32 htr_cache_crc (const htr_cache_rec_t *rec, const char *hash)
+{
+  htr_cache_rec_t tmp = *rec;
+
+  tmp.crc = 0;
+
+  uLong crc = crc32 (0L, Z_NULL, 0);
+
+  crc = crc32 (crc, (const Bytef *) &tmp, sizeof (htr_cache_rec_t));
+  crc = crc32 (crc, (const Bytef *) hash, rec->hash_len);
+
+  return (u32) crc;
+}
+
+static int htr_cache_write (htr_cache_t *cache, const void *buf, const size_t len)
+{
+  const u8 *p = (const u8 *) buf;
+
+  for (size_t done = 0; done < len;)
+  {
+    const ssize_t nwritten = write (cache->fd, p + done, len - done);
+
+    if (nwritten == -1 && errno == EINTR) continue;
+
+    if (nwritten <= 0)
+    {
+      fprintf (stderr, "%s: %s\n", cache->fpath, strerror (errno));
+
+      return -1;
+    }
+
+    done += (size_t) nwritten;
+  }
+
+  return 1;
+}
+
+// the records after the header, stops at the first one that is cut short or does not check out
+static int htr_cache_load (htr_cache_t *cache, const u8 *buf, const size_t len, size_t *good_len)
+{
+  size_t off = sizeof (htr_cache_hdr_t);
+
+  while (len - off >= sizeof (htr_cache_rec_t))
+  {
+    htr_cache_rec_t rec;
+
+    memcpy (&rec, buf + off, sizeof (htr_cache_rec_t));
+
+    const char *hash = (const char *) buf + off + sizeof (htr_cache_rec_t);
+
+    if (rec.hash_len > HTR_CACHE_HASH_MAX) break;
+
+    if (rec.hash_len > len - off - sizeof (htr_cache_rec_t)) break;
+
+    if (rec.crc != htr_cache_crc (&rec, hash)) break;
+
+    if (htr_cache_insert (cache, &rec, hash) == -1)
+    {
+      fprintf (stderr, "%s: %s\n", cache->fpath, MSG_ENOMEM);
+
+      return -1;
+    }
+
+    off += sizeof (htr_cache_rec_t) + rec.hash_len;
+  }
+
+  *good_len = off;
+
+  return 1;
+}
+
+int htr_cache_open (htr_cache_t *cache, const char *fpath)
+{
+  memset (cache, 0, sizeof (htr_cache_t));
+
+  cache->fpath = fpath;
+
+  jmarena_init (&cache->arena, HCBUFSIZ_LARGE);
+
+  pthread_mutex_init (&cache->mux, NULL);
+
+  cache->fd = open (fpath, HTR_CACHE_OPEN_FLAGS, 0644);
+
+  if (cache->fd == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    return -1;
+  }
+
+  htr_cache_lock (cache);
+
+  struct stat st;
+
+  if (fstat (cache->fd, &st) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+    htr_cache_unlock (cache);
+
+    return -1;
+  }
+
+  // a new cache gets its header, anything else must be one of ours
+
+  htr_cache_hdr_t hdr;
+
+  memset (&hdr, 0, sizeof (htr_cache_hdr_t));
+
+  memcpy (hdr.magic, HTR_CACHE_MAGIC, HTR_CACHE_MAGIC_LEN);
+
+  hdr.version    = HTR_CACHE_VERSION;
+  hdr.byte_order = HTR_CACHE_BYTE_ORDER;
+
+  if (st.st_size == 0)
+  {
+    const int ret = htr_cache_write (cache, &hdr, sizeof (htr_cache_hdr_t));
+
+    htr_cache_unlock (cache);
+
+    return ret;
+  }
+
+  jmmap_t map;
+
+  if (jmmap_open_fd (&map, cache->fd, (u64) st.st_size, fpath) == -1)
+  {
+    htr_cache_unlock (cache);
+
+    return -1;
+  }
+
+  if ((map.len < sizeof (htr_cache_hdr_t)) || (memcmp (map.buf, &hdr, sizeof (htr_cache_hdr_t)) != 0))
+  {
+    fprintf (stderr, "%s: not a hash_extr cache, or from another version or machine\n", fpath);
+
+    jmmap_close (&map);
+
+    htr_cache_unlock (cache);
+
+    return -1;
+  }
+
+  size_t good_len = 0;
+
+  int ret = htr_cache_load (cache, map.buf, map.len, &good_len);
+
+  // later appends would never be reached behind a damaged record
+
+  if ((ret == 1) && (good_len < map.len))
+  {
+    fprintf (stderr, "%s: damaged after %zu bytes, the rest is dropped\n", fpath, good_len);
+
+    if (ftruncate (cache->fd, (off_t) good_len) == -1)
+    {
+      fprintf (stderr, "%s: %s\n", fpath, strerror (errno));
+
+      ret = -1;
+    }
+  }
+
+  jmmap_close (&map);
+
+  htr_cache_unlock (cache);
+
+  cache->loaded_cnt = cache->ents_cnt;
+
+  return ret;
+}
+
+void htr_cache_close (htr_cache_t *cache)
+{
+  if (cache->fd != -1) close (cache->fd);
+
+  cache->fd = -1;
+
+  jmfree (cache->ents);
+  jmfree (cache->by_stat);
+  jmfree (cache->by_digest);
+
+  cache->ents      = NULL;
+  cache->by_stat   = NULL;
+  cache->by_digest = NULL;
+
+  cache->ents_cnt   = 0;
+  cache->ents_size  = 0;
+  cache->table_size = 0;
+
+  jmarena_destory (&cache->arena);
+
+  pthread_mutex_destroy (&cache->mux);
+}
+
+static u64 htr_cache_path_hash (const char *fpath)
+{
+  sha1_ctx_t ctx;
+
+  sha1_init (&ctx);
+
+  sha1_update (&ctx, fpath, strlen (fpath));
+
+  u8 digest[SHA1_DIGEST_LEN];
+
+  sha1_final (&ctx, digest);
+
+  return htr_cache_digest_hash (digest);
+}
+
+// modified too close to when it was read, the mtime alone does not prove it unchanged
+static bool htr_cache_is_racy (const htr_cache_rec_t *rec)
+{
+  return (rec->mtime / 1000000000) + HTR_CACHE_RACY_SEC > rec->stamp;
+}
+
+// under mux, ent may move once it is unlocked, 0 if it can not be used for this path
+static int htr_cache_serve (htr_cache_t *cache, const htr_cache_ent_t *ent, rfile_info_ctx_t *rfile_info_ctx, const rfile_cache_state_t state)
+{
+  if (((ent->rec.flags & HTR_CACHE_REC_PATH_FREE) == 0) && (ent->rec.path_hash != rfile_info_ctx->cache.path_hash)) return 0;
+
+  if ((ent->rec.flags >> HTR_CACHE_REC_VARIANT_SHIFT) != hccvt_variant (ent->rec.hash_mode)) return 0;
+
+  if (rfile_info_ctx_set_result (rfile_info_ctx, ent->rec.hash_mode, (file_encryption_t) ent->rec.file_encryption, ent->hash, ent->rec.hash_len) == -1) return 0;
+
+  rfile_info_ctx->cache.state = state;
+
+  cache->hits_cnt++;
+
+  return 1;
+}
+
+int htr_cache_lookup (htr_cache_t *cache, rfile_info_ctx_t *rfile_info_ctx)
+{
+  const jmprobe_t *probe = &rfile_info_ctx->probe;
+
+  rfile_cache_info_t *info = &rfile_info_ctx->cache;
+
+  info->state     = RFILE_CACHE_OFF;
+  info->stamp     = (u64) time (NULL);
+  info->path_hash = htr_cache_path_hash (rfile_info_ctx->path);
+
+  int ret = 0;
+
+  pthread_mutex_lock (&cache->mux);
+
+  if (cache->table_size > 0)
+  {
+    const u32 idx = *htr_cache_stat_slot (cache, cache->by_stat, probe->dev, probe->ino, probe->size, probe->mtime);
+
+    if ((idx != 0) && (htr_cache_is_racy (&cache->ents[idx - 1].rec) == false))
+    {
+      ret = htr_cache_serve (cache, &cache->ents[idx - 1], rfile_info_ctx, RFILE_CACHE_HIT_STAT);
+    }
+  }
+
+  pthread_mutex_unlock (&cache->mux);
+
+  if (ret == 1) return 1;
+
+  // new, changed, or too recently modified, go by content
+
+  if (sha1_probe (probe, info->digest) == -1) return 0;
+
+  info->state = RFILE_CACHE_MISS;
+
+  pthread_mutex_lock (&cache->mux);
+
+  if (cache->table_size > 0)
+  {
+    const u32 idx = *htr_cache_digest_slot (cache, cache->by_digest, info->digest);
+
+    if (idx != 0) ret = htr_cache_serve (cache, &cache->ents[idx - 1], rfile_info_ctx, RFILE_CACHE_HIT_DIGEST);
+  }
+
+  pthread_mutex_unlock (&cache->mux);
+
+  return ret;
+}
+
+int htr_cache_store (htr_cache_t *cache, const rfile_info_ctx_t *rfile_info_ctx)
+{
+  const rfile_cache_info_t *info = &rfile_info_ctx->cache;
+
+  // served by stat key, or never digested
+
+  if ((info->state != RFILE_CACHE_MISS) && (info->state != RFILE_CACHE_HIT_DIGEST)) return 0;
+
+  const jmprobe_t  *probe    = &rfile_info_ctx->probe;
+  const hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+
+  if ((rfile_info_ctx->file_encryption == FILE_ENCRYPTED) && (hash_ctx->hash == NULL)) return 0;
+
+  if (rfile_info_ctx->file_encryption == FILE_ENCRYPTION_UNKNOWN) return 0;
+
+  if ((hash_ctx->hash != NULL) && (hash_ctx->hash->len > HTR_CACHE_HASH_MAX)) return 0;
+
+  const char *hash     = (hash_ctx->hash != NULL) ? hash_ctx->hash->val : "";
+  const u32   hash_len = (hash_ctx->hash != NULL) ? (u32) hash_ctx->hash->len : 0;
+
+  htr_cache_rec_t rec;
+
+  memset (&rec, 0, sizeof (htr_cache_rec_t));
+
+  rec.dev   = probe->dev;
+  rec.ino   = probe->ino;
+  rec.size  = probe->size;
+  rec.mtime = probe->mtime;
+  rec.stamp = info->stamp;
+
+  rec.path_hash = info->path_hash;
+
+  memcpy (rec.digest, info->digest, RFILE_DIGEST_LEN);
+
+  rec.hash_mode       = hash_ctx->hash_mode;
+  rec.file_encryption = rfile_info_ctx->file_encryption;
+  rec.hash_len        = hash_len;
+
+  if (rfile_hash_is_path_free (rfile_info_ctx) == true) rec.flags |= HTR_CACHE_REC_PATH_FREE;
+
+  rec.flags |= hccvt_variant (hash_ctx->hash_mode) << HTR_CACHE_REC_VARIANT_SHIFT;
+
+  rec.crc = htr_cache_crc (&rec, hash);
+
+  // one write () per record, appends of other processes do not cut into it
+
+  membuf_t mb;
+
+  if (membuf_init (&mb, sizeof (htr_cache_rec_t) + hash_len) == -1) return -1;
+
+  membuf_append (&mb, &rec, sizeof (htr_cache_rec_t));
+  membuf_append (&mb, hash, hash_len);
+
+  pthread_mutex_lock (&cache->mux);
+
+  htr_cache_lock (cache);
+
+  int ret = htr_cache_write (cache, mb.buf, mb.len);
+
+  htr_cache_unlock (cache);
+
+  if (ret == 1) ret = htr_cache_insert (cache, &rec, hash);
+
+  pthread_mutex_unlock (&cache->mux);
+
+  membuf_destory (&mb);
+
+  return ret;
+}
@@ -0,0 +1,355 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "htrdedup.h"
+#include "hccvt.h"
+#include "sha1.h"
+
+static u64 htr_dedup_mix (u64 x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+
+  return x;
+}
+
+// the slot of the first entry of this size, or the free one it would go to
+static u32 *htr_dedup_size_slot (const htr_dedup_t *dedup, u32 *table, const u64 size)
+{
+  const u32 mask = dedup->table_size - 1;
+
+  for (u32 pos = (u32) htr_dedup_mix (size) & mask;; pos = (pos + 1) & mask)
+  {
+    if (table[pos] == 0) return &table[pos];
+
+    if (dedup->ents[table[pos] - 1].size == size) return &table[pos];
+  }
+}
+
+// keeps the table at most half full, there are never more sizes than entries
+static int htr_dedup_grow (htr_dedup_t *dedup)
+{
+  if (dedup->ents_cnt == dedup->ents_size)
+  {
+    const u32 ents_size = (dedup->ents_size == 0) ? HTR_DEDUP_TABLE_MIN / 2 : dedup->ents_size * 2;
+
+    htr_dedup_ent_t *ents = (htr_dedup_ent_t *) realloc (dedup->ents, ents_size * sizeof (htr_dedup_ent_t));
+
+    if (ents == NULL) return -1;
+
+    dedup->ents      = ents;
+    dedup->ents_size = ents_size;
+  }
+
+  if ((dedup->ents_cnt + 1) * 2 <= dedup->table_size) return 1;
+
+  const u32 table_size = (dedup->table_size == 0) ? HTR_DEDUP_TABLE_MIN : dedup->table_size * 2;
+
+  u32 *by_size = (u32 *) jmcalloc (table_size, sizeof (u32));
+
+  if (by_size == NULL) return -1;
+
+  jmfree (dedup->by_size);
+
+  dedup->by_size    = by_size;
+  dedup->table_size = table_size;
+
+  // the first entry of a size is always the lowest index
+
+  for (u32 i = 0; i < dedup->ents_cnt; i++)
+  {
+    u32 *slot = htr_dedup_size_slot (dedup, dedup->by_size, dedup->ents[i].size);
+
+    if (*slot == 0) *slot = i + 1;
+  }
+
+  return 1;
+}
+
+// under mux, a new owner, digest is NULL if it is the first of its size
+static int htr_dedup_add (htr_dedup_t *dedup, const rfile_info_ctx_t *rfile_info_ctx, const u8 *digest, u32 *ent_idx)
+{
+  const jmprobe_t *probe = &rfile_info_ctx->probe;
+
+  if (htr_dedup_grow (dedup) == -1) return -1;
+
+  // only the first of a size is read again by path, the others have their digest already
+
+  char *fpath = NULL;
+
+  if (digest == NULL)
+  {
+    const size_t fpath_len = strlen (rfile_info_ctx->path);
+
+    fpath = (char *) jmarena_alloc (&dedup->arena, fpath_len + 1);
+
+    if (fpath == NULL) return -1;
+
+    memcpy (fpath, rfile_info_ctx->path, fpath_len + 1);
+  }
+
+  const u32 idx = dedup->ents_cnt++;
+
+  htr_dedup_ent_t *ent = &dedup->ents[idx];
+
+  memset (ent, 0, sizeof (htr_dedup_ent_t));
+
+  ent->size  = probe->size;
+  ent->mtime = probe->mtime;
+  ent->fpath = fpath;
+
+  if (digest != NULL)
+  {
+    ent->digest_state = HTR_DEDUP_DIGEST_OK;
+
+    memcpy (ent->digest, digest, RFILE_DIGEST_LEN);
+  }
+
+  u32 *slot = htr_dedup_size_slot (dedup, dedup->by_size, probe->size);
+
+  if (*slot == 0)
+  {
+    *slot = idx + 1;
+  }
+  else
+  {
+    u32 tail = *slot;
+
+    while (dedup->ents[tail - 1].next != 0) tail = dedup->ents[tail - 1].next;
+
+    dedup->ents[tail - 1].next = idx + 1;
+  }
+
+  *ent_idx = idx;
+
+  return 1;
+}
+
+// the first file of a size, read again by path, it must still be what was extracted
+static htr_dedup_digest_t htr_dedup_digest_path (const char *fpath, const u64 size, const u64 mtime, u8 *digest)
+{
+  jmprobe_t probe;
+
+  if (jmprobe_open (&probe, fpath) == -1) return HTR_DEDUP_DIGEST_BAD;
+
+  htr_dedup_digest_t ret = HTR_DEDUP_DIGEST_BAD;
+
+  if ((probe.size == size) && (probe.mtime == mtime) && (sha1_probe (&probe, digest) == 1)) ret = HTR_DEDUP_DIGEST_OK;
+
+  jmprobe_close (&probe);
+
+  return ret;
+}
+
+int htr_dedup_init (htr_dedup_t *dedup)
+{
+  memset (dedup, 0, sizeof (htr_dedup_t));
+
+  jmarena_init (&dedup->arena, HCBUFSIZ_LARGE);
+
+  pthread_mutex_init (&dedup->mux, NULL);
+  pthread_cond_init  (&dedup->cond_done, NULL);
+
+  return 1;
+}
+
+void htr_dedup_destory (htr_dedup_t *dedup)
+{
+  for (u32 i = 0; i < dedup->ents_cnt; i++) jmfree (dedup->ents[i].hash);
+
+  jmfree (dedup->ents);
+  jmfree (dedup->by_size);
+
+  dedup->ents    = NULL;
+  dedup->by_size = NULL;
+
+  dedup->ents_cnt   = 0;
+  dedup->ents_size  = 0;
+  dedup->table_size = 0;
+
+  jmarena_destory (&dedup->arena);
+
+  pthread_mutex_destroy (&dedup->mux);
+  pthread_cond_destroy  (&dedup->cond_done);
+}
+
+htr_dedup_role_t htr_dedup_claim (htr_dedup_t *dedup, rfile_info_ctx_t *rfile_info_ctx, u32 *ent_idx, int *rc)
+{
+  const jmprobe_t *probe = &rfile_info_ctx->probe;
+
+  pthread_mutex_lock (&dedup->mux);
+
+  const u32 first = (dedup->table_size > 0) ? *htr_dedup_size_slot (dedup, dedup->by_size, probe->size) : 0;
+
+  // a size not seen yet, nothing to compare with, no digest needed
+
+  if (first == 0)
+  {
+    const int ret = htr_dedup_add (dedup, rfile_info_ctx, NULL, ent_idx);
+
+    pthread_mutex_unlock (&dedup->mux);
+
+    return (ret == 1) ? HTR_DEDUP_OWNER : HTR_DEDUP_ALONE;
+  }
+
+  // the first one of the size was not digested while it was alone, it is done here
+
+  htr_dedup_ent_t *head = &dedup->ents[first - 1];
+
+  // whatever the digests say, an owner still extracting keeps its result for this one
+
+  if (head->done == false) head->wanted = true;
+
+  const bool  head_todo  = (head->digest_state == HTR_DEDUP_DIGEST_NONE);
+  const char *head_fpath = head->fpath;
+  const u64   head_mtime = head->mtime;
+
+  pthread_mutex_unlock (&dedup->mux);
+
+  // digests are taken unlocked, the cache may have one already
+
+  u8 digest[RFILE_DIGEST_LEN];
+
+  if (rfile_info_ctx->cache.state == RFILE_CACHE_MISS)
+  {
+    memcpy (digest, rfile_info_ctx->cache.digest, RFILE_DIGEST_LEN);
+  }
+  else if (sha1_probe (probe, digest) == -1)
+  {
+    return HTR_DEDUP_ALONE;
+  }
+
+  u8 head_digest[RFILE_DIGEST_LEN];
+
+  const htr_dedup_digest_t head_state = (head_todo == true) ? htr_dedup_digest_path (head_fpath, probe->size, head_mtime, head_digest) : HTR_DEDUP_DIGEST_NONE;
+
+  pthread_mutex_lock (&dedup->mux);
+
+  htr_dedup_ent_t *ent = &dedup->ents[first - 1];
+
+  if ((head_todo == true) && (ent->digest_state == HTR_DEDUP_DIGEST_NONE))
+  {
+    ent->digest_state = head_state;
+
+    memcpy (ent->digest, head_digest, RFILE_DIGEST_LEN);
+  }
+
+  u32 match = 0;
+
+  for (u32 i = first; i != 0; i = dedup->ents[i - 1].next)
+  {
+    ent = &dedup->ents[i - 1];
+
+    if (ent->digest_state != HTR_DEDUP_DIGEST_OK) continue;
+
+    // a lone file's result was not kept, this one becomes the owner of the pair
+
+    if ((ent->done == true) && (ent->kept == false) && (ent->wanted == false)) continue;
+
+    if (memcmp (ent->digest, digest, RFILE_DIGEST_LEN) != 0) continue;
+
+    match = i;
+
+    break;
+  }
+
+  htr_dedup_role_t role = HTR_DEDUP_ALONE;
+
+  if (match == 0)
+  {
+    if (htr_dedup_add (dedup, rfile_info_ctx, digest, ent_idx) == 1) role = HTR_DEDUP_OWNER;
+  }
+  else
+  {
+    // the owner claimed before and is extracting, it never waits itself
+
+    while (dedup->ents[match - 1].done == false) pthread_cond_wait (&dedup->cond_done, &dedup->mux);
+
+    ent = &dedup->ents[match - 1];
+
+    if ((ent->kept == true) && (rfile_info_ctx_set_result (rfile_info_ctx, ent->hash_mode, ent->file_encryption, ent->hash, ent->hash_len) == 1))
+    {
+      *rc = ent->rc;
+
+      dedup->copies_cnt++;
+
+      role = HTR_DEDUP_COPY;
+    }
+  }
+
+  pthread_mutex_unlock (&dedup->mux);
+
+  return role;
+}
+
+void htr_dedup_publish (htr_dedup_t *dedup, const u32 ent_idx, const rfile_info_ctx_t *rfile_info_ctx, const int rc)
+{
+  const hash_ctx_t *hash_ctx = rfile_info_ctx->hash_ctx;
+
+  const size_t hash_len = (hash_ctx->hash != NULL) ? hash_ctx->hash->len : 0;
+
+  bool kept = (rfile_hash_is_path_free (rfile_info_ctx) == true) && (hash_len <= HTR_DEDUP_HASH_MAX);
+
+  // most sizes in an intake are unique, a lone file keeps a small result while the budget lasts
+
+  pthread_mutex_lock (&dedup->mux);
+
+  const htr_dedup_ent_t *head = &dedup->ents[ent_idx];
+
+  const bool shared = (head->wanted == true) || (head->next != 0) || (*htr_dedup_size_slot (dedup, dedup->by_size, head->size) != ent_idx + 1);
+
+  if ((kept == true) && (shared == false))
+  {
+    if ((hash_len <= HTR_DEDUP_LONE_MAX) && (dedup->lone_len + hash_len <= HTR_DEDUP_LONE_BUDGET))
+    {
+      dedup->lone_len += hash_len;
+    }
+    else
+    {
+      kept = false;
+    }
+  }
+
+  pthread_mutex_unlock (&dedup->mux);
+
+  // copied unlocked, hashes can be large, copies that came in meanwhile wait for done
+
+  char *hash = NULL;
+
+  if ((kept == true) && (hash_ctx->hash != NULL))
+  {
+    hash = (char *) jmmalloc (hash_len + 1);
+
+    if (hash == NULL)
+    {
+      kept = false;
+    }
+    else
+    {
+      memcpy (hash, hash_ctx->hash->val, hash_len);
+
+      hash[hash_len] = 0;
+    }
+  }
+
+  pthread_mutex_lock (&dedup->mux);
+
+  htr_dedup_ent_t *ent = &dedup->ents[ent_idx];
+
+  ent->rc              = rc;
+  ent->hash_mode       = hash_ctx->hash_mode;
+  ent->file_encryption = rfile_info_ctx->file_encryption;
+  ent->kept            = kept;
+  ent->hash            = hash;
+  ent->hash_len        = (hash != NULL) ? hash_len : 0;
+
+  ent->done = true;
+
+  pthread_cond_broadcast (&dedup->cond_done);
+
+  pthread_mutex_unlock (&dedup->mux);
+}
@@ -0,0 +1,206 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+
+#include "htrout.h"
+
+#if defined (_POSIX)
+#define HTR_OUT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC)
+#elif defined (_WIN)
+#include <io.h>
+#define HTR_OUT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_APPEND | O_BINARY)
+#endif
+
+static int htr_out_flush (htr_out_dst_t *dst)
+{
+  const char *p = dst->buf.buf;
+
+  size_t done = 0;
+
+  while (done < dst->buf.len)
+  {
+    const ssize_t nwritten = write (dst->fd, p + done, dst->buf.len - done);
+
+    if (nwritten == -1 && errno == EINTR) continue;
+
+    if (nwritten <= 0)
+    {
+      fprintf (stderr, "%s: %s\n", dst->fpath, strerror (errno));
+
+      // what was written is gone from the buffer, the rest is kept for the next try
+
+      memmove (dst->buf.buf, p + done, dst->buf.len - done);
+
+      dst->buf.len -= done;
+
+      dst->buf.buf[dst->buf.len] = 0;
+
+      return -1;
+    }
+
+    done += (size_t) nwritten;
+
+    dst->dirty = true;
+  }
+
+  membuf_reset (&dst->buf);
+
+  return 1;
+}
+
+static int htr_out_sync (htr_out_dst_t *dst)
+{
+  if (dst->dirty == false) return 1;
+
+#if defined (_WIN)
+  const int rc = _commit (dst->fd);
+#else
+  const int rc = fsync (dst->fd);
+#endif
+
+  // pipes and character devices can not be synced, and need not be
+
+  if ((rc == -1) && (errno != EINVAL) && (errno != ENOTSUP))
+  {
+    fprintf (stderr, "%s: %s\n", dst->fpath, strerror (errno));
+
+    return -1;
+  }
+
+  dst->dirty = false;
+
+  return 1;
+}
+
+int htr_out_init (htr_out_t *out)
+{
+  memset (out, 0, sizeof (htr_out_t));
+
+  return 1;
+}
+
+void htr_out_destory (htr_out_t *out)
+{
+  htr_out_commit (out);
+
+  for (u32 i = 0; i < out->dsts_cnt; i++)
+  {
+    htr_out_dst_t *dst = out->dsts[i];
+
+    close (dst->fd);
+
+    membuf_destory (&dst->buf);
+
+    jmfree (dst->fpath);
+    jmfree (dst);
+  }
+
+  jmfree (out->dsts);
+
+  memset (out, 0, sizeof (htr_out_t));
+}
+
+htr_out_dst_t *htr_out_open (htr_out_t *out, const char *fpath)
+{
+  // a handful of destinations, a linear search is enough
+
+  for (u32 i = 0; i < out->dsts_cnt; i++)
+  {
+    if (strcmp (out->dsts[i]->fpath, fpath) == 0) return out->dsts[i];
+  }
+
+  if (out->dsts_cnt == out->dsts_size)
+  {
+    const u32 dsts_size = (out->dsts_size == 0) ? 16 : out->dsts_size * 2;
+
+    htr_out_dst_t **dsts = (htr_out_dst_t **) realloc (out->dsts, dsts_size * sizeof (htr_out_dst_t *));
+
+    if (dsts == NULL) return NULL;
+
+    out->dsts      = dsts;
+    out->dsts_size = dsts_size;
+  }
+
+  htr_out_dst_t *dst = (htr_out_dst_t *) jmcalloc (1, sizeof (htr_out_dst_t));
+
+  if (dst == NULL) return NULL;
+
+  dst->fpath = strdup (fpath);
+
+  if ((dst->fpath == NULL) || (membuf_init (&dst->buf, HTR_OUT_BUFSIZ) == -1))
+  {
+    jmfree (dst->fpath);
+    jmfree (dst);
+
+    return NULL;
+  }
+
+  dst->fd = open (fpath, HTR_OUT_OPEN_FLAGS, 0644);
+
+  if (dst->fd == -1)
+  {
+    membuf_destory (&dst->buf);
+
+    jmfree (dst->fpath);
+    jmfree (dst);
+
+    return NULL;
+  }
+
+  out->dsts[out->dsts_cnt++] = dst;
+
+  return dst;
+}
+
+int htr_out_write (htr_out_dst_t *dst, const void *data, const size_t len)
+{
+  if (membuf_append (&dst->buf, data, len) == -1) return -1;
+
+  if (dst->buf.len >= HTR_OUT_BUFSIZ) return htr_out_flush (dst);
+
+  return 1;
+}
+
+int htr_out_printf (htr_out_dst_t *dst, const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start (ap, fmt);
+
+  const int ret = membuf_vappendf (&dst->buf, fmt, ap);
+
+  va_end (ap);
+
+  if (ret == -1) return -1;
+
+  if (dst->buf.len >= HTR_OUT_BUFSIZ) return htr_out_flush (dst);
+
+  return 1;
+}
+
+int htr_out_mark (htr_out_t *out)
+{
+  if (++out->pending_cnt < HTR_OUT_COMMIT_CNT) return 1;
+
+  return htr_out_commit (out);
+}
+
+int htr_out_commit (htr_out_t *out)
+{
+  int ret = 1;
+
+  for (u32 i = 0; i < out->dsts_cnt; i++)
+  {
+    htr_out_dst_t *dst = out->dsts[i];
+
+    if (htr_out_flush (dst) == -1) ret = -1;
+
+    if (htr_out_sync (dst) == -1) ret = -1;
+  }
+
+  out->pending_cnt = 0;
+
+  return ret;
+}
@@ -0,0 +1,206 @@
+#include "htrpool.h"
+#include "hccvt.h"
+
+static void *htr_pool_worker (void *p)
+{
+  htr_pool_t *pool = (htr_pool_t *) p;
+
+  char fpath[FILE_PATH_MAXLEN];
+
+  pthread_mutex_lock (&pool->mux);
+
+  while (pool->src_done == false)
+  {
+    // bounded window, never run too far ahead of the committer
+
+    if (pool->next_idx - pool->commit_idx >= pool->slots_cnt)
+    {
+      pthread_cond_wait (&pool->cond_free, &pool->mux);
+
+      continue;
+    }
+
+    // the inputs are enumerated as they are needed, under the lock
+
+    if (htr_src_next (pool->src, fpath, sizeof (fpath)) == 0)
+    {
+      pool->src_done = true;
+
+      pthread_cond_broadcast (&pool->cond_done);
+
+      break;
+    }
+
+    const u64 job_idx = pool->next_idx++;
+
+    htr_pool_slot_t *slot = &pool->slots[job_idx % pool->slots_cnt];
+
+    pthread_mutex_unlock (&pool->mux);
+
+    rfile_info_ctx_t *rfile_info_ctx = &slot->rfile_info_ctx;
+
+    rfile_info_ctx_reset (rfile_info_ctx, fpath);
+
+    const int rc = pool->extract (pool->userdata, rfile_info_ctx);
+
+    pthread_mutex_lock (&pool->mux);
+
+    slot->rc   = rc;
+    slot->done = true;
+
+    pthread_cond_broadcast (&pool->cond_done);
+  }
+
+  pthread_mutex_unlock (&pool->mux);
+
+  return NULL;
+}
+
+// the sync objects come first, htr_pool_destory () is safe after any failure below
+static int htr_pool_init (htr_pool_t *pool, u32 workers_cnt)
+{
+  pthread_mutex_init (&pool->mux, NULL);
+  pthread_cond_init  (&pool->cond_done, NULL);
+  pthread_cond_init  (&pool->cond_free, NULL);
+
+  pool->workers_cnt = workers_cnt;
+  pool->slots_cnt   = workers_cnt * HTR_SLOTS_PER_WORKER;
+
+  pool->next_idx   = 0;
+  pool->commit_idx = 0;
+
+  pool->slots_init_cnt = 0;
+
+  pool->workers = (pthread_t *)       jmcalloc (pool->workers_cnt, sizeof (pthread_t));
+  pool->slots   = (htr_pool_slot_t *) jmcalloc (pool->slots_cnt,   sizeof (htr_pool_slot_t));
+
+  if (pool->workers == NULL || pool->slots == NULL) return -1;
+
+  for (u32 i = 0; i < pool->slots_cnt; i++)
+  {
+    if (rfile_info_ctx_init (&pool->slots[i].rfile_info_ctx) == -1) return -1;
+
+    pool->slots_init_cnt++;
+  }
+
+  return 1;
+}
+
+static void htr_pool_destory (htr_pool_t *pool)
+{
+  for (u32 i = 0; i < pool->slots_init_cnt; i++)
+  {
+    rfile_info_ctx_destory (&pool->slots[i].rfile_info_ctx);
+  }
+
+  jmfree (pool->slots);
+  jmfree (pool->workers);
+
+  pthread_mutex_destroy (&pool->mux);
+  pthread_cond_destroy  (&pool->cond_done);
+  pthread_cond_destroy  (&pool->cond_free);
+}
+
+// a single worker needs no threads, extract and commit one by one
+static int htr_pool_run_serial (htr_src_t *src, htr_pool_extract_fn extract, htr_pool_commit_fn commit, void *userdata)
+{
+  rfile_info_ctx_t rfile_info_ctx;
+
+  if (rfile_info_ctx_init (&rfile_info_ctx) == -1) return -1;
+
+  char fpath[FILE_PATH_MAXLEN];
+
+  while (htr_src_next (src, fpath, sizeof (fpath)) == 1)
+  {
+    rfile_info_ctx_reset (&rfile_info_ctx, fpath);
+
+    const int rc = extract (userdata, &rfile_info_ctx);
+
+    commit (userdata, &rfile_info_ctx, rc);
+  }
+
+  rfile_info_ctx_destory (&rfile_info_ctx);
+
+  return 1;
+}
+
+int htr_pool_run (u32 workers_cnt, htr_src_t *src, htr_pool_extract_fn extract, htr_pool_commit_fn commit, void *userdata)
+{
+  if (workers_cnt <= 1) return htr_pool_run_serial (src, extract, commit, userdata);
+
+  htr_pool_t pool;
+
+  memset (&pool, 0, sizeof (htr_pool_t));
+
+  pool.src        = src;
+  pool.extract    = extract;
+  pool.commit     = commit;
+  pool.userdata   = userdata;
+
+  if (htr_pool_init (&pool, workers_cnt) == -1)
+  {
+    htr_pool_destory (&pool);
+
+    return -1;
+  }
+
+  u32 started_cnt = 0;
+
+  for (; started_cnt < pool.workers_cnt; started_cnt++)
+  {
+    if (pthread_create (&pool.workers[started_cnt], NULL, htr_pool_worker, &pool) != 0)
+    {
+      fprintf (stderr, "could not start worker %u: %s\n", started_cnt, strerror (errno));
+
+      break;
+    }
+  }
+
+  // the committer keeps going as long as at least one worker is alive
+
+  if (started_cnt == 0)
+  {
+    htr_pool_destory (&pool);
+
+    return -1;
+  }
+
+  // commit results in input order
+
+  pthread_mutex_lock (&pool.mux);
+
+  while ((pool.src_done == false) || (pool.commit_idx < pool.next_idx))
+  {
+    htr_pool_slot_t *slot = &pool.slots[pool.commit_idx % pool.slots_cnt];
+
+    if ((pool.commit_idx == pool.next_idx) || (slot->done == false))
+    {
+      pthread_cond_wait (&pool.cond_done, &pool.mux);
+
+      continue;
+    }
+
+    pthread_mutex_unlock (&pool.mux);
+
+    commit (userdata, &slot->rfile_info_ctx, slot->rc);
+
+    pthread_mutex_lock (&pool.mux);
+
+    slot->done = false;
+
+    pool.commit_idx++;
+
+    pthread_cond_broadcast (&pool.cond_free);
+  }
+
+  pthread_mutex_unlock (&pool.mux);
+
+  for (u32 i = 0; i < started_cnt; i++)
+  {
+    pthread_join (pool.workers[i], NULL);
+  }
+
+  htr_pool_destory (&pool);
+
+  return 1;
+}
@@ -0,0 +1,444 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#if defined (__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "htrsrc.h"
+
+#if defined (__linux__)
+
+// what getdents64 () fills in, glibc only has it from 2.30 on
+
+struct htr_dirent64 {
+  u64            d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+};
+
+#endif
+
+void htr_src_init (htr_src_t *src, char **operands, const u32 operands_cnt, const char *manifest_fpath, const bool null_delim)
+{
+  memset (src, 0, sizeof (htr_src_t));
+
+  src->operands       = operands;
+  src->operands_cnt   = operands_cnt;
+  src->manifest_fpath = manifest_fpath;
+  src->delim          = (null_delim == true) ? '\0' : '\n';
+}
+
+static void htr_src_pop_dir (htr_src_t *src)
+{
+  htr_src_dir_t *dir = &src->dirs[--src->dirs_cnt];
+
+#if defined (__linux__)
+  close (dir->fd);
+
+  jmfree (dir->dents);
+#else
+  closedir ((DIR *) dir->dir);
+#endif
+
+  memset (dir, 0, sizeof (htr_src_dir_t));
+}
+
+void htr_src_destory (htr_src_t *src)
+{
+  while (src->dirs_cnt > 0) htr_src_pop_dir (src);
+
+  if ((src->manifest != NULL) && (src->manifest != stdin)) fclose (src->manifest);
+
+  src->manifest = NULL;
+
+  jmfree (src->line);
+
+  src->line      = NULL;
+  src->line_size = 0;
+}
+
+// src->path is the directory, parent_fd the one it was found in (-1 for operands)
+static void htr_src_push_dir (htr_src_t *src, const int parent_fd, const char *name)
+{
+  if (src->dirs_cnt == HTR_SRC_DEPTH_MAX)
+  {
+    fprintf (stderr, "%s: directory nested too deep, skip\n", src->path);
+
+    return;
+  }
+
+  htr_src_dir_t *dir = &src->dirs[src->dirs_cnt];
+
+  dir->path_len = strlen (src->path);
+
+  // the children of "/" are "/name"
+
+  if ((dir->path_len == 1) && (src->path[0] == '/')) dir->path_len = 0;
+
+#if defined (__linux__)
+
+  // links to directories are only followed if given by the user, against loops
+
+  if (parent_fd == -1)
+  {
+    dir->fd = open (name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+  else
+  {
+    dir->fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+  }
+
+  if (dir->fd == -1)
+  {
+    fprintf (stderr, "%s: %s\n", src->path, strerror (errno));
+
+    return;
+  }
+
+  dir->dents = (u8 *) jmmalloc (HTR_SRC_DENTS_BUFSIZ);
+
+  if (dir->dents == NULL)
+  {
+    close (dir->fd);
+
+    return;
+  }
+
+  dir->dents_pos = 0;
+  dir->dents_len = 0;
+
+#else
+
+  (void) parent_fd;
+  (void) name;
+
+  dir->dir = opendir (src->path);
+
+  if (dir->dir == NULL)
+  {
+    fprintf (stderr, "%s: %s\n", src->path, strerror (errno));
+
+    return;
+  }
+
+#endif
+
+  src->dirs_cnt++;
+}
+
+// 1 got an entry, 0 end of the directory, its type is DT_UNKNOWN if the filesystem does not say
+static int htr_src_read_dir (htr_src_t *src, htr_src_dir_t *dir, const char **name, int *type)
+{
+#if defined (__linux__)
+
+  if (dir->dents_pos >= dir->dents_len)
+  {
+    const long nread = syscall (SYS_getdents64, dir->fd, dir->dents, HTR_SRC_DENTS_BUFSIZ);
+
+    if (nread == -1)
+    {
+      src->path[dir->path_len] = 0;
+
+      fprintf (stderr, "%s: %s\n", src->path, strerror (errno));
+
+      return 0;
+    }
+
+    if (nread == 0) return 0;
+
+    dir->dents_pos = 0;
+    dir->dents_len = (size_t) nread;
+  }
+
+  const struct htr_dirent64 *dent = (const struct htr_dirent64 *) (dir->dents + dir->dents_pos);
+
+  dir->dents_pos += dent->d_reclen;
+
+  *name = dent->d_name;
+  *type = dent->d_type;
+
+  return 1;
+
+#else
+
+  (void) src;
+
+  const struct dirent *dent = readdir ((DIR *) dir->dir);
+
+  if (dent == NULL) return 0;
+
+  *name = dent->d_name;
+
+#if defined (DT_UNKNOWN)
+  *type = dent->d_type;
+#else
+  *type = 0;
+#endif
+
+  return 1;
+
+#endif
+}
+
+// a line of the manifest, without the delimiter, NULL at its end
+static char *htr_src_read_manifest (htr_src_t *src)
+{
+  size_t len = 0;
+
+  int c;
+
+  while ((c = fgetc (src->manifest)) != EOF)
+  {
+    if (len + 1 >= src->line_size)
+    {
+      const size_t size = (src->line_size == 0) ? FILE_PATH_MAXLEN : src->line_size * 2;
+
+      char *line = (char *) realloc (src->line, size);
+
+      if (line == NULL) return NULL;
+
+      src->line      = line;
+      src->line_size = size;
+    }
+
+    if (c == src->delim) break;
+
+    src->line[len++] = (char) c;
+  }
+
+  if ((c == EOF) && (len == 0)) return NULL;
+
+  if ((src->delim == '\n') && (len > 0) && (src->line[len - 1] == '\r')) len--;
+
+  src->line[len] = 0;
+
+  return src->line;
+}
+
+// the next operand or manifest entry, NULL if there is none
+static const char *htr_src_next_root (htr_src_t *src)
+{
+  while (1)
+  {
+    if (src->manifest != NULL)
+    {
+      const char *line = htr_src_read_manifest (src);
+
+      if (line == NULL)
+      {
+        if (src->manifest != stdin) fclose (src->manifest);
+
+        src->manifest = NULL;
+
+        continue;
+      }
+
+      if (line[0] == 0) continue;
+
+      return line;
+    }
+
+    if (src->operand_idx < src->operands_cnt)
+    {
+      const char *operand = src->operands[src->operand_idx++];
+
+      if (strcmp (operand, HTR_SRC_STDIN) == 0)
+      {
+        src->manifest = stdin;
+
+        continue;
+      }
+
+      return operand;
+    }
+
+    if ((src->manifest_fpath != NULL) && (src->manifest_done == false))
+    {
+      src->manifest_done = true;
+
+      if (strcmp (src->manifest_fpath, HTR_SRC_STDIN) == 0)
+      {
+        src->manifest = stdin;
+      }
+      else if ((src->manifest = fopen (src->manifest_fpath, "rb")) == NULL)
+      {
+        fprintf (stderr, "%s: %s\n", src->manifest_fpath, strerror (errno));
+      }
+
+      continue;
+    }
+
+    return NULL;
+  }
+}
+
+static int htr_src_yield (htr_src_t *src, const char *path, char *fpath, const size_t fpath_size)
+{
+  const size_t len = strlen (path);
+
+  if (len >= fpath_size)
+  {
+    fprintf (stderr, "%s: path too long, skip\n", path);
+
+    return 0;
+  }
+
+  memcpy (fpath, path, len + 1);
+
+  src->files_cnt++;
+
+  return 1;
+}
+
+int htr_src_next (htr_src_t *src, char *fpath, const size_t fpath_size)
+{
+  while (1)
+  {
+    // inside a directory, entries are taken one by one
+
+    if (src->dirs_cnt > 0)
+    {
+      htr_src_dir_t *dir = &src->dirs[src->dirs_cnt - 1];
+
+      const char *name = NULL;
+
+      int type = 0;
+
+      if (htr_src_read_dir (src, dir, &name, &type) == 0)
+      {
+        htr_src_pop_dir (src);
+
+        continue;
+      }
+
+      if ((strcmp (name, ".") == 0) || (strcmp (name, "..") == 0)) continue;
+
+      const size_t name_len = strlen (name);
+
+      if ((dir->path_len + 1 + name_len) >= sizeof (src->path))
+      {
+        src->path[dir->path_len] = 0;
+
+        fprintf (stderr, "%s/%s: path too long, skip\n", src->path, name);
+
+        continue;
+      }
+
+      src->path[dir->path_len] = '/';
+
+      memcpy (src->path + dir->path_len + 1, name, name_len + 1);
+
+#if defined (DT_UNKNOWN)
+
+      if (type == DT_REG)
+      {
+        if (htr_src_yield (src, src->path, fpath, fpath_size) == 1) return 1;
+
+        continue;
+      }
+
+      if (type == DT_DIR)
+      {
+#if defined (__linux__)
+        htr_src_push_dir (src, dir->fd, name);
+#else
+        htr_src_push_dir (src, -1, name);
+#endif
+
+        continue;
+      }
+
+      // links to files are taken, links to directories are not followed
+
+      const bool is_link = (type == DT_LNK);
+
+      if ((type != DT_LNK) && (type != DT_UNKNOWN)) continue;
+
+#else
+
+      const bool is_link = false;
+
+#endif
+
+      struct stat st;
+
+#if defined (__linux__)
+      const int rc = fstatat (dir->fd, name, &st, 0);
+#else
+      const int rc = stat (src->path, &st);
+#endif
+
+      if (rc == -1)
+      {
+        fprintf (stderr, "%s: %s\n", src->path, strerror (errno));
+
+        continue;
+      }
+
+      if (S_ISREG (st.st_mode))
+      {
+        if (htr_src_yield (src, src->path, fpath, fpath_size) == 1) return 1;
+
+        continue;
+      }
+
+      if (S_ISDIR (st.st_mode) && (is_link == false))
+      {
+#if defined (__linux__)
+        htr_src_push_dir (src, dir->fd, name);
+#else
+        htr_src_push_dir (src, -1, name);
+#endif
+      }
+
+      continue;
+    }
+
+    // operands and manifest entries
+
+    const char *root = htr_src_next_root (src);
+
+    if (root == NULL) return 0;
+
+    struct stat st;
+
+    if (stat (root, &st) == -1)
+    {
+      fprintf (stderr, "%s: %s, skip\n", root, strerror (errno));
+
+      continue;
+    }
+
+    if (S_ISDIR (st.st_mode) == 0)
+    {
+      if (htr_src_yield (src, root, fpath, fpath_size) == 1) return 1;
+
+      continue;
+    }
+
+    const size_t root_len = strlen (root);
+
+    if (root_len >= sizeof (src->path))
+    {
+      fprintf (stderr, "%s: path too long, skip\n", root);
+
+      continue;
+    }
+
+    memcpy (src->path, root, root_len + 1);
+
+    // "dir/" and "dir" give the same paths below it, "/" stays
+
+    for (size_t len = root_len; (len > 1) && (src->path[len - 1] == '/'); len--) src->path[len - 1] = 0;
+
+    htr_src_push_dir (src, -1, src->path);
+  }
+}
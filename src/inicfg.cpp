@@ -1,20 +1,14 @@
 #include "inicfg.h"
 #include "common.h"
-// #include <sys/file.h>
 
-#define INI_LOAD_VAL(buf, file, title, key, buf_size) \
-  if (cpy_inivalue (buf, file, title, key , buf_size) < 0) { \
-    printf ("ini load value failed: [title] %s, [key] %s", #title, #key); \
-    fclose (tmplock); \
-    return -1; \
-  }
+#if defined (_POSIX)
+#include <sys/file.h>
+#endif
 
-#define INI_SET_VAL(title, key, buf) \
-  if (inifile.SetValue (title, key, buf) < 0) { \
-    printf ("ini set value failed: [title] %s, [key] %s", #title, #key); \
-    fclose (tmplock); \
-    return -1; \
-  }
+#define HTR_ROUTE_SECTION "Output_HCHash_Files"
+
+// the config is only ever read, a shared lock keeps out a writer that
+// locks it, readers run side by side
 
 static int ini_file_init (inicfg_ctx_t *inicfg_ctx, const char *filepath)
 {
@@ -22,20 +16,35 @@ static int ini_file_init (inicfg_ctx_t *inicfg_ctx, const char *filepath)
 
   (*inifile_ptr).SetUnicode ();
 
-  const char *node_info_fpath = filepath;
+  inicfg_ctx->tmplock = fopen (filepath, "rb");
+
+  if (inicfg_ctx->tmplock == NULL)
+  {
+    fprintf (stderr, "%s: %s\n", filepath, strerror (errno));
+
+    return -1;
+  }
 
   FILE *tmplock = inicfg_ctx->tmplock;
 
-  //flock (fileno (tmplock), LOCK_SH);
+#if defined (_POSIX)
+  while ((flock (fileno (tmplock), LOCK_SH) == -1) && (errno == EINTR)) {}
+#endif
 
-  SI_Error rc_file = (*inifile_ptr).LoadFile (node_info_fpath);
+  SI_Error rc_file = (*inifile_ptr).LoadFile (tmplock);
+
+#if defined (_POSIX)
+  flock (fileno (tmplock), LOCK_UN);
+#endif
 
   if (rc_file < 0)
   {
-    printf ("loading failed: %s\n", node_info_fpath);
+    fprintf (stderr, "%s: loading failed\n", filepath);
 
-    //flock (fileno (tmplock), LOCK_UN);
     fclose (tmplock);
+
+    inicfg_ctx->tmplock = NULL;
+
     return -1;
   }
 
@@ -44,25 +53,9 @@ static int ini_file_init (inicfg_ctx_t *inicfg_ctx, const char *filepath)
 
 static void ini_file_destory (inicfg_ctx_t *inicfg_ctx)
 {
-  FILE *tmplock = inicfg_ctx->tmplock;
-
-  fclose (tmplock);
-}
-
-static int cpy_inivalue (char *buffer, CSimpleIniA & inifile, const char *section, const char *key, size_t LIMIT_LEN)
-{
-  const char *value = inifile.GetValue (section, key);
+  if (inicfg_ctx->tmplock != NULL) fclose (inicfg_ctx->tmplock);
 
-  if (value && LIMIT_LEN >= strlen (value) + 1)
-  {
-    strncpy (buffer, value, strlen (value));
-  }
-  else
-  {
-    return -1;
-  }
-
-  return 1;
+  inicfg_ctx->tmplock = NULL;
 }
 
 static int filepath_commasplit (char *comma_string, char buf[256][FILE_PATH_MAXLEN])
@@ -102,51 +95,222 @@ static int filepath_commasplit (char *comma_string, char buf[256][FILE_PATH_MAXL
 }
 
 
-// hash_extr config file
+// the key names of the first config files, any other mode is given by number
 
-int read_htr_config_file (htr_config_inicfg_t *inicfg, char *htr_config_fpath)
+struct htr_route_alias {
+  const char *name;
+  int         hash_mode;
+};
+
+static const struct htr_route_alias HTR_ROUTE_ALIASES[] =
 {
-  CSimpleIniA inifile;
-  inicfg_ctx_t inicfg_ctx;
+  { "wpa",                            2500 },
+  { "office2007",                     9400 },
+  { "office2010",                     9500 },
+  { "office2013",                     9600 },
+  { "pdf1.1-1.3Acrobat2-4",          10400 },
+  { "pdf1.1-1.3Acrobat2-4collider1", 10410 },
+  { "pdf1.1-1.3Acrobat2-4collider2", 10420 },
+  { "pdf1.4-1.6Acrobat5-8",          10500 },
+  { "pdf1.7Level3Acrobat9",          10600 },
+  { "pdf1.7Level8Acrobat10-11",      10700 },
+  { "7zip",                          11600 },
+  { "rar3",                          12500 },
+  { "rar5",                          13000 },
+  { "pkzip",                         13600 },
+};
+
+// * any digits, ? one digit
+static bool route_glob_match (const char *glob, const char *str)
+{
+  if (*glob == 0) return *str == 0;
 
-  FILE *tmplock = fopen (htr_config_fpath, "r");
+  if (*glob == '*') return route_glob_match (glob + 1, str) || ((*str != 0) && route_glob_match (glob, str + 1));
 
-  inicfg_ctx.inifile_ptr = &inifile;
-  inicfg_ctx.tmplock = tmplock;
+  if (*str == 0) return false;
 
-  ini_file_init (&inicfg_ctx, htr_config_fpath);
+  if ((*glob == '?') || (*glob == *str)) return route_glob_match (glob + 1, str + 1);
 
-  INI_LOAD_VAL (inicfg->wpa2500, inifile, "Output_HCHash_Files", "wpa", BUF_MINLEN);
+  return false;
+}
 
-  INI_LOAD_VAL (inicfg->office9400, inifile, "Output_HCHash_Files", "office2007", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->office9500, inifile, "Output_HCHash_Files", "office2010", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->office9600, inifile, "Output_HCHash_Files", "office2013", BUF_MINLEN);
+static bool route_is_glob (const char *key)
+{
+  if (*key == 0) return false;
 
-  INI_LOAD_VAL (inicfg->pdf10400, inifile, "Output_HCHash_Files", "pdf1.1-1.3Acrobat2-4", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->pdf10410, inifile, "Output_HCHash_Files", "pdf1.1-1.3Acrobat2-4collider1", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->pdf10420, inifile, "Output_HCHash_Files", "pdf1.1-1.3Acrobat2-4collider2", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->pdf10500, inifile, "Output_HCHash_Files", "pdf1.4-1.6Acrobat5-8", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->pdf10600, inifile, "Output_HCHash_Files", "pdf1.7Level3Acrobat9", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->pdf10700, inifile, "Output_HCHash_Files", "pdf1.7Level8Acrobat10-11", BUF_MINLEN);
+  for (const char *p = key; *p != 0; p++)
+  {
+    if ((*p != '*') && (*p != '?') && ((*p < '0') || (*p > '9'))) return false;
+  }
+
+  return (strchr (key, '*') != NULL) || (strchr (key, '?') != NULL);
+}
 
-  INI_LOAD_VAL (inicfg->szip11600, inifile, "Output_HCHash_Files", "7zip", BUF_MINLEN);
+// the mode a key stands for, -1 if it is none
+static int route_key_mode (const char *key)
+{
+  for (size_t i = 0; i < sizeof (HTR_ROUTE_ALIASES) / sizeof (HTR_ROUTE_ALIASES[0]); i++)
+  {
+    if (strcmp (HTR_ROUTE_ALIASES[i].name, key) == 0) return HTR_ROUTE_ALIASES[i].hash_mode;
+  }
 
-  INI_LOAD_VAL (inicfg->rar12500, inifile, "Output_HCHash_Files", "rar3", BUF_MINLEN);
-  INI_LOAD_VAL (inicfg->rar13000, inifile, "Output_HCHash_Files", "rar5", BUF_MINLEN);
+  if (*key == 0 || strlen (key) > 9) return -1;
 
-  INI_LOAD_VAL (inicfg->pkzip13600, inifile, "Output_HCHash_Files", "pkzip", BUF_MINLEN);
+  for (const char *p = key; *p != 0; p++)
+  {
+    if ((*p < '0') || (*p > '9')) return -1;
+  }
 
-  SI_Error rc = inifile.SaveFile (htr_config_fpath);
+  return atoi (key);
+}
 
-  if (rc < 0)
+// sink index + 1, outfiles named by several keys are one sink
+static u32 route_sink_add (htr_config_inicfg_t *inicfg, const char *fpath)
+{
+  for (u32 i = 0; i < inicfg->sinks_cnt; i++)
   {
-    //flock (fileno (tmplock), LOCK_UN);
-    fclose (tmplock);
-    return -1;
+    if (strcmp (inicfg->sinks[i], fpath) == 0) return i + 1;
   }
 
-  ini_file_destory (&inicfg_ctx);
+  if (inicfg->sinks_cnt == UINT16_MAX) return 0;
+
+  char **sinks = (char **) realloc (inicfg->sinks, (inicfg->sinks_cnt + 1) * sizeof (char *));
+
+  if (sinks == NULL) return 0;
+
+  inicfg->sinks = sinks;
+
+  char *sink = strdup (fpath);
+
+  if (sink == NULL) return 0;
+
+  inicfg->sinks[inicfg->sinks_cnt++] = sink;
+
+  return inicfg->sinks_cnt;
+}
+
+// exact keys win over globs, earlier globs over later ones, "*" is the default for the rest
+static int route_load (htr_config_inicfg_t *inicfg, CSimpleIniA &inifile, const char *htr_config_fpath)
+{
+  inicfg->route = (u16 *) jmcalloc (HTR_ROUTE_MODES, sizeof (u16));
+
+  if (inicfg->route == NULL) return -1;
+
+  CSimpleIniA::TNamesDepend keys;
+
+  inifile.GetAllKeys (HTR_ROUTE_SECTION, keys);
+
+  keys.sort (CSimpleIniA::Entry::LoadOrder ());
+
+  // globs, last listed first so that earlier ones overwrite them
+
+  for (CSimpleIniA::TNamesDepend::reverse_iterator it = keys.rbegin (); it != keys.rend (); ++it)
+  {
+    const char *key   = it->pItem;
+    const char *value = inifile.GetValue (HTR_ROUTE_SECTION, key);
+
+    if ((route_is_glob (key) == false) || (value == NULL) || (*value == 0)) continue;
+
+    const u32 sink = route_sink_add (inicfg, value);
+
+    if (sink == 0) return -1;
+
+    // "*" only fills what nothing else claims, wherever it is listed
+
+    if (strcmp (key, "*") == 0)
+    {
+      inicfg->default_sink = sink;
+
+      continue;
+    }
+
+    char mode_str[16];
+
+    for (int hash_mode = 0; hash_mode < HTR_ROUTE_MODES; hash_mode++)
+    {
+      snprintf (mode_str, sizeof (mode_str), "%d", hash_mode);
+
+      if (route_glob_match (key, mode_str) == true) inicfg->route[hash_mode] = (u16) sink;
+    }
+  }
+
+  for (CSimpleIniA::TNamesDepend::iterator it = keys.begin (); it != keys.end (); ++it)
+  {
+    const char *key   = it->pItem;
+    const char *value = inifile.GetValue (HTR_ROUTE_SECTION, key);
+
+    if ((route_is_glob (key) == true) || (value == NULL) || (*value == 0)) continue;
+
+    const int hash_mode = route_key_mode (key);
+
+    if ((hash_mode < 0) || (hash_mode >= HTR_ROUTE_MODES))
+    {
+      fprintf (stderr, "%s: [%s] %s: unknown hash mode, skip\n", htr_config_fpath, HTR_ROUTE_SECTION, key);
+
+      continue;
+    }
+
+    const u32 sink = route_sink_add (inicfg, value);
+
+    if (sink == 0) return -1;
+
+    inicfg->route[hash_mode] = (u16) sink;
+  }
+
+  if (inicfg->default_sink != 0)
+  {
+    for (int hash_mode = 0; hash_mode < HTR_ROUTE_MODES; hash_mode++)
+    {
+      if (inicfg->route[hash_mode] == 0) inicfg->route[hash_mode] = (u16) inicfg->default_sink;
+    }
+  }
 
   return 1;
+}
+
+int htr_config_route (const htr_config_inicfg_t *inicfg, const int hash_mode)
+{
+  u32 sink = inicfg->default_sink;
+
+  if ((inicfg->route != NULL) && (hash_mode >= 0) && (hash_mode < HTR_ROUTE_MODES)) sink = inicfg->route[hash_mode];
+
+  return (int) sink - 1;
+}
+
+void htr_config_inicfg_destory (htr_config_inicfg_t *inicfg)
+{
+  for (u32 i = 0; i < inicfg->sinks_cnt; i++) jmfree (inicfg->sinks[i]);
+
+  jmfree (inicfg->sinks);
+  jmfree (inicfg->route);
+
+  memset (inicfg, 0, sizeof (htr_config_inicfg_t));
+}
 
+// hash_extr config file
+
+int read_htr_config_file (htr_config_inicfg_t *inicfg, const char *htr_config_fpath)
+{
+  CSimpleIniA inifile;
+  inicfg_ctx_t inicfg_ctx;
+
+  inicfg_ctx.inifile_ptr = &inifile;
+  inicfg_ctx.tmplock = NULL;
+
+  if (ini_file_init (&inicfg_ctx, htr_config_fpath) == -1) return -1;
+
+  // everything is copied out, the file is not needed past this point
+
+  ini_file_destory (&inicfg_ctx);
+
+  if (route_load (inicfg, inifile, htr_config_fpath) == -1)
+  {
+    fprintf (stderr, "%s: %s\n", htr_config_fpath, MSG_ENOMEM);
+
+    htr_config_inicfg_destory (inicfg);
+
+    return -1;
+  }
+
+  return 1;
 }
@@ -0,0 +1,898 @@
+/*
+ * office2hc, in-process replacement of office2john.py (cvttools/posix)
+ * for Office 2007, 2010 and 2013 encryption.
+ *
+ * The hash part of the office2john line is unchanged, but returned bare:
+ *
+ *   $office$*2007*verifierHashSize*keySize*saltSize*hex(salt)*hex(verifier)*hex(verifierHash)
+ *   $office$*2010*spinCount*keyBits*saltSize*hex(salt)*hex(verifierHashInput)*hex(verifierHashValue)
+ *   $office$*2013*spinCount*keyBits*saltSize*hex(salt)*hex(verifierHashInput)*hex(verifierHashValue)
+ *
+ * Differences to office2john.py: the compound file is not loaded as a
+ * whole (FAT, mini FAT and directory), the FAT entries of the few sectors
+ * on the way to EncryptionInfo are looked up one at a time. Office 97-2003
+ * RC4 files ($oldoffice$) have no EncryptionInfo stream and are not
+ * handled, their hashes never had a mode in this tool.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "office2hc.h"
+
+static u16 office_get16 (const u8 *p)
+{
+  return ((u16) p[0]) | ((u16) p[1] << 8);
+}
+
+static u32 office_get32 (const u8 *p)
+{
+  return ((u32) p[0]) | ((u32) p[1] << 8) | ((u32) p[2] << 16) | ((u32) p[3] << 24);
+}
+
+/**************************************************************************
+ * compound file
+ *************************************************************************/
+
+// sector data, NULL if sid is not in the file
+static const u8 *office_sect (office2hc_ctx_t *ctx, const u32 sid, size_t *avail)
+{
+  if (sid > CFB_MAXREGSECT) return NULL;
+
+  const u64 offset = ((u64) sid + 1) * ctx->sect_size;
+
+  if (offset >= ctx->len) return NULL;
+
+  const size_t left = ctx->len - (size_t) offset;
+
+  if (avail != NULL) *avail = (left < ctx->sect_size) ? left : ctx->sect_size;
+
+  return ctx->buf + offset;
+}
+
+// the sector holding the idx-th part of the FAT, the first 109 are listed in the header
+static int office_fat_sect (office2hc_ctx_t *ctx, u32 idx, u32 *sid)
+{
+  if (idx < CFB_DIFAT_HEADER_CNT)
+  {
+    *sid = office_get32 (ctx->buf + 0x4c + (idx * 4));
+
+    return 1;
+  }
+
+  idx -= CFB_DIFAT_HEADER_CNT;
+
+  // every DIFAT sector ends with the id of the next one
+
+  const u32 per_sect = (ctx->sect_size / 4) - 1;
+
+  u32 difat = ctx->difat_start;
+
+  for (u32 i = 0; i < idx / per_sect; i++)
+  {
+    if (i >= ctx->difat_cnt) return -1;
+
+    const u8 *p = office_sect (ctx, difat, NULL);
+
+    if (p == NULL) return -1;
+
+    difat = office_get32 (p + (per_sect * 4));
+  }
+
+  size_t avail = 0;
+
+  const u8 *p = office_sect (ctx, difat, &avail);
+
+  if ((p == NULL) || (avail < ctx->sect_size)) return -1;
+
+  *sid = office_get32 (p + ((idx % per_sect) * 4));
+
+  return 1;
+}
+
+static int office_next (office2hc_ctx_t *ctx, const u32 sid, u32 *next)
+{
+  const u32 per_sect = ctx->sect_size / 4;
+
+  u32 fat = 0;
+
+  if (office_fat_sect (ctx, sid / per_sect, &fat) == -1) return -1;
+
+  size_t avail = 0;
+
+  const u8 *p = office_sect (ctx, fat, &avail);
+
+  if ((p == NULL) || (avail < ctx->sect_size)) return -1;
+
+  *next = office_get32 (p + ((sid % per_sect) * 4));
+
+  return 1;
+}
+
+// the n-th sector of the chain starting at sid
+static int office_chain_seek (office2hc_ctx_t *ctx, u32 sid, const u32 n, u32 *out)
+{
+  if (n > ctx->sect_cnt) return -1;
+
+  for (u32 i = 0; i < n; i++)
+  {
+    if (office_next (ctx, sid, &sid) == -1) return -1;
+
+    if (sid > CFB_MAXREGSECT) return -1;
+  }
+
+  *out = sid;
+
+  return 1;
+}
+
+static int office_read_chain (office2hc_ctx_t *ctx, u32 sid, const u64 size, membuf_t *mb)
+{
+  u64 left = size;
+
+  for (u32 i = 0; (left > 0) && (i <= ctx->sect_cnt); i++)
+  {
+    size_t avail = 0;
+
+    const u8 *p = office_sect (ctx, sid, &avail);
+
+    if (p == NULL) return -1;
+
+    const size_t n = (left < avail) ? (size_t) left : avail;
+
+    if (membuf_append (mb, p, n) == -1) return -1;
+
+    left -= n;
+
+    if (left == 0) break;
+
+    if (office_next (ctx, sid, &sid) == -1) return -1;
+  }
+
+  return (left == 0) ? 1 : -1;
+}
+
+// streams below the cutoff live in 64 byte sectors inside the root entry's stream
+static int office_read_mini_chain (office2hc_ctx_t *ctx, u32 msid, const u64 size, membuf_t *mb)
+{
+  const u32 per_sect = ctx->sect_size / 4;
+  const u32 mini_per = ctx->sect_size / ctx->mini_sect_size;
+
+  u64 left = size;
+
+  for (u32 i = 0; (left > 0) && (i <= ctx->sect_cnt * mini_per); i++)
+  {
+    u32 sid = 0;
+
+    if (office_chain_seek (ctx, ctx->ministream_start, msid / mini_per, &sid) == -1) return -1;
+
+    size_t avail = 0;
+
+    const u8 *p = office_sect (ctx, sid, &avail);
+
+    const size_t offset = (msid % mini_per) * ctx->mini_sect_size;
+
+    if ((p == NULL) || (avail <= offset)) return -1;
+
+    avail -= offset;
+
+    if (avail > ctx->mini_sect_size) avail = ctx->mini_sect_size;
+
+    const size_t n = (left < avail) ? (size_t) left : avail;
+
+    if (membuf_append (mb, p + offset, n) == -1) return -1;
+
+    left -= n;
+
+    if (left == 0) break;
+
+    // next entry of the mini FAT, which is a chain of regular sectors itself
+
+    u32 minifat = 0;
+
+    if (office_chain_seek (ctx, ctx->minifat_start, msid / per_sect, &minifat) == -1) return -1;
+
+    const u8 *q = office_sect (ctx, minifat, &avail);
+
+    if ((q == NULL) || (avail < ctx->sect_size)) return -1;
+
+    msid = office_get32 (q + ((msid % per_sect) * 4));
+  }
+
+  return (left == 0) ? 1 : -1;
+}
+
+static const u8 *office_dirent (office2hc_ctx_t *ctx, const u32 id)
+{
+  const u32 per_sect = ctx->sect_size / CFB_DIRENT_LEN;
+
+  u32 sid = 0;
+
+  if (office_chain_seek (ctx, ctx->dir_start, id / per_sect, &sid) == -1) return NULL;
+
+  size_t avail = 0;
+
+  const u8 *p = office_sect (ctx, sid, &avail);
+
+  const size_t offset = (id % per_sect) * CFB_DIRENT_LEN;
+
+  if ((p == NULL) || (avail < offset + CFB_DIRENT_LEN)) return NULL;
+
+  return p + offset;
+}
+
+// directory order: shorter names first, then by upper case UTF-16 code units
+static int office_dirent_cmp (const char *name, const u8 *ent)
+{
+  const u16 ent_len = office_get16 (ent + 0x40);
+
+  const size_t name_units = strlen (name);
+  const size_t ent_units  = (ent_len >= 2) ? (ent_len / 2) - 1 : 0;
+
+  if (ent_units > 31) return -2;
+
+  if (name_units != ent_units) return (name_units < ent_units) ? -1 : 1;
+
+  for (size_t i = 0; i < name_units; i++)
+  {
+    u16 a = (u8) name[i];
+    u16 b = office_get16 (ent + (i * 2));
+
+    if ((a >= 'a') && (a <= 'z')) a -= 0x20;
+    if ((b >= 'a') && (b <= 'z')) b -= 0x20;
+
+    if (a != b) return (a < b) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+// a stream in the root storage, by walking the root's red-black tree
+static const u8 *office_find_stream (office2hc_ctx_t *ctx, const char *name)
+{
+  const u8 *root = office_dirent (ctx, 0);
+
+  if (root == NULL) return NULL;
+
+  u32 id = office_get32 (root + 0x4c);
+
+  for (u32 i = 0; (id != CFB_NOSTREAM) && (i <= ctx->sect_cnt); i++)
+  {
+    const u8 *ent = office_dirent (ctx, id);
+
+    if (ent == NULL) break;
+
+    const int cmp = office_dirent_cmp (name, ent);
+
+    if (cmp == -2) break;
+
+    if (cmp == 0) return (ent[0x42] == CFB_TYPE_STREAM) ? ent : NULL;
+
+    id = office_get32 (ent + ((cmp < 0) ? 0x44 : 0x48));
+  }
+
+  // some writers get the tree wrong, fall back to looking at every entry
+
+  const u8 *ent = NULL;
+
+  for (u32 i = 1; (ent = office_dirent (ctx, i)) != NULL; i++)
+  {
+    if ((ent[0x42] == CFB_TYPE_STREAM) && (office_dirent_cmp (name, ent) == 0)) return ent;
+  }
+
+  return NULL;
+}
+
+static u64 office_stream_size (office2hc_ctx_t *ctx, const u8 *ent)
+{
+  u64 size = office_get32 (ent + 0x78);
+
+  // version 4 files have 64 bit sizes, version 3 ones may have garbage in the high half
+
+  if (ctx->sect_size == 4096) size |= (u64) office_get32 (ent + 0x7c) << 32;
+
+  return size;
+}
+
+// the first len bytes of a stream, less if it is shorter
+static int office_read_stream_head (office2hc_ctx_t *ctx, const u8 *ent, const u64 len, membuf_t *mb)
+{
+  const u32 start = office_get32 (ent + 0x74);
+
+  const u64 size = office_stream_size (ctx, ent);
+
+  const u64 n = (size < len) ? size : len;
+
+  if (size < ctx->mini_cutoff) return office_read_mini_chain (ctx, start, n, mb);
+
+  return office_read_chain (ctx, start, n, mb);
+}
+
+static int office_read_stream (office2hc_ctx_t *ctx, const u8 *ent, membuf_t *mb)
+{
+  const u64 size = office_stream_size (ctx, ent);
+
+  if (size > OFFICE2HC_STREAM_MAXLEN)
+  {
+    fprintf (stderr, "%s: EncryptionInfo too large\n", ctx->fpath);
+
+    return -1;
+  }
+
+  return office_read_stream_head (ctx, ent, size, mb);
+}
+
+static int office_open (office2hc_ctx_t *ctx)
+{
+  const u8 *hdr = ctx->buf;
+
+  if ((ctx->len < CFB_HEADER_LEN) || (memcmp (hdr, CFB_SIGNATURE, 8) != 0)) return -1;
+
+  const u16 sect_shift      = office_get16 (hdr + 0x1e);
+  const u16 mini_sect_shift = office_get16 (hdr + 0x20);
+
+  if ((sect_shift != 9) && (sect_shift != 12)) return -1;
+
+  if (mini_sect_shift != 6) return -1;
+
+  ctx->sect_size      = 1u << sect_shift;
+  ctx->mini_sect_size = 1u << mini_sect_shift;
+  ctx->sect_cnt       = (u32) (((u64) ctx->len / ctx->sect_size));
+
+  ctx->dir_start     = office_get32 (hdr + 0x30);
+  ctx->mini_cutoff   = office_get32 (hdr + 0x38);
+  ctx->minifat_start = office_get32 (hdr + 0x3c);
+  ctx->difat_start   = office_get32 (hdr + 0x44);
+  ctx->difat_cnt     = office_get32 (hdr + 0x48);
+
+  const u8 *root = office_dirent (ctx, 0);
+
+  if (root == NULL) return -1;
+
+  ctx->ministream_start = office_get32 (root + 0x74);
+
+  return 1;
+}
+
+/**************************************************************************
+ * EncryptionInfo
+ *************************************************************************/
+
+static int office_b64_value (const char c)
+{
+  if ((c >= 'A') && (c <= 'Z')) return c - 'A';
+  if ((c >= 'a') && (c <= 'z')) return c - 'a' + 26;
+  if ((c >= '0') && (c <= '9')) return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+
+  return -1;
+}
+
+static int office_b64_decode (const char *in, const size_t in_len, u8 *out, const size_t out_size, size_t *out_len)
+{
+  u32 acc  = 0;
+  int bits = 0;
+
+  size_t n = 0;
+
+  for (size_t i = 0; i < in_len; i++)
+  {
+    if (in[i] == '=') break;
+
+    const int v = office_b64_value (in[i]);
+
+    if (v == -1)
+    {
+      if ((in[i] == ' ') || (in[i] == '\t') || (in[i] == '\r') || (in[i] == '\n')) continue;
+
+      return -1;
+    }
+
+    acc   = (acc << 6) | (u32) v;
+    bits += 6;
+
+    if (bits >= 8)
+    {
+      bits -= 8;
+
+      if (n == out_size) return -1;
+
+      out[n++] = (u8) (acc >> bits);
+    }
+  }
+
+  *out_len = n;
+
+  return 1;
+}
+
+// value of attribute name of the element starting at elem and ending at elem_end
+static int office_xml_attr (const char *elem, const char *elem_end, const char *name, const char **val, size_t *val_len)
+{
+  const size_t name_len = strlen (name);
+
+  for (const char *p = elem; p + name_len + 2 < elem_end; p++)
+  {
+    if ((*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n')) continue;
+
+    if (memcmp (p + 1, name, name_len) != 0) continue;
+
+    const char *q = p + 1 + name_len;
+
+    while ((q < elem_end) && ((*q == ' ') || (*q == '\t') || (*q == '\r') || (*q == '\n'))) q++;
+
+    if ((q >= elem_end) || (*q != '=')) continue;
+
+    q++;
+
+    while ((q < elem_end) && ((*q == ' ') || (*q == '\t') || (*q == '\r') || (*q == '\n'))) q++;
+
+    if ((q >= elem_end) || ((*q != '"') && (*q != '\''))) return -1;
+
+    const char *end = memchr (q + 1, *q, elem_end - (q + 1));
+
+    if (end == NULL) return -1;
+
+    *val     = q + 1;
+    *val_len = end - (q + 1);
+
+    return 1;
+  }
+
+  return 0;
+}
+
+static int office_xml_attr_u32 (const char *elem, const char *elem_end, const char *name, u32 *out)
+{
+  const char *val = NULL;
+
+  size_t val_len = 0;
+
+  if (office_xml_attr (elem, elem_end, name, &val, &val_len) != 1) return -1;
+
+  if ((val_len == 0) || (val_len > 10)) return -1;
+
+  u64 v = 0;
+
+  for (size_t i = 0; i < val_len; i++)
+  {
+    if ((val[i] < '0') || (val[i] > '9')) return -1;
+
+    v = (v * 10) + (val[i] - '0');
+  }
+
+  if (v > UINT32_MAX) return -1;
+
+  *out = (u32) v;
+
+  return 1;
+}
+
+static int office_xml_attr_hex (const char *elem, const char *elem_end, const char *name, const size_t max_hex, membuf_t *out)
+{
+  const char *val = NULL;
+
+  size_t val_len = 0;
+
+  if (office_xml_attr (elem, elem_end, name, &val, &val_len) != 1) return -1;
+
+  u8 raw[1024];
+
+  size_t raw_len = 0;
+
+  if (office_b64_decode (val, val_len, raw, sizeof (raw), &raw_len) == -1) return -1;
+
+  if (raw_len * 2 > max_hex) raw_len = max_hex / 2;
+
+  return membuf_append_hex (out, raw, raw_len);
+}
+
+// the <encryptedKey> element of the password key encryptor
+static const char *office_find_encrypted_key (const char *xml, const char **elem_end)
+{
+  // whatever prefix the password namespace is bound to
+
+  char tag[64] = { 0 };
+
+  const char *p = xml;
+
+  while ((p = strstr (p, "xmlns")) != NULL)
+  {
+    p += 5;
+
+    const char *prefix = p;
+
+    if (*p == ':')
+    {
+      prefix = ++p;
+
+      while ((*p != 0) && (*p != '=') && (*p != ' ')) p++;
+    }
+
+    const size_t prefix_len = p - prefix;
+
+    while (*p == ' ') p++;
+
+    if (*p++ != '=') continue;
+
+    while (*p == ' ') p++;
+
+    if ((*p != '"') && (*p != '\'')) continue;
+
+    if (strncmp (p + 1, OFFICE2HC_PASSWORD_NS, strlen (OFFICE2HC_PASSWORD_NS)) != 0) continue;
+
+    if (p[1 + strlen (OFFICE2HC_PASSWORD_NS)] != *p) continue;
+
+    if (prefix_len >= sizeof (tag) - 16) return NULL;
+
+    if (prefix_len > 0)
+    {
+      snprintf (tag, sizeof (tag), "<%.*s:encryptedKey", (int) prefix_len, prefix);
+    }
+    else
+    {
+      snprintf (tag, sizeof (tag), "<encryptedKey");
+    }
+
+    break;
+  }
+
+  if (p == NULL) return NULL;
+
+  const size_t tag_len = strlen (tag);
+
+  while ((p = strstr (p, tag)) != NULL)
+  {
+    const char c = p[tag_len];
+
+    if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '/') || (c == '>'))
+    {
+      *elem_end = strchr (p, '>');
+
+      return (*elem_end != NULL) ? p : NULL;
+    }
+
+    p += tag_len;
+  }
+
+  return NULL;
+}
+
+// Office 2010 and 2013, agile encryption, the descriptor is XML
+static int office_agile (office2hc_ctx_t *ctx, const membuf_t *info, membuf_t *out, office2hc_info_t *oinfo)
+{
+  const char *elem_end = NULL;
+
+  const char *elem = office_find_encrypted_key (info->buf + 8, &elem_end);
+
+  if (elem == NULL)
+  {
+    fprintf (stderr, "%s: no password key encryptor\n", ctx->fpath);
+
+    return -1;
+  }
+
+  const char *hash_alg = NULL;
+  const char *ciph_alg = NULL;
+
+  size_t hash_alg_len = 0;
+  size_t ciph_alg_len = 0;
+
+  if ((office_xml_attr (elem, elem_end, "hashAlgorithm",   &hash_alg, &hash_alg_len) != 1)
+   || (office_xml_attr (elem, elem_end, "cipherAlgorithm", &ciph_alg, &ciph_alg_len) != 1)
+   || (office_xml_attr_u32 (elem, elem_end, "spinCount", &oinfo->spin_count) == -1)
+   || (office_xml_attr_u32 (elem, elem_end, "keyBits",   &oinfo->key_bits)   == -1)
+   || (office_xml_attr_u32 (elem, elem_end, "saltSize",  &oinfo->salt_size)  == -1))
+  {
+    fprintf (stderr, "%s: incomplete encryptedKey element\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if ((hash_alg_len == 4) && (memcmp (hash_alg, "SHA1", 4) == 0))
+  {
+    oinfo->version = 2010;
+  }
+  else if ((hash_alg_len == 6) && (memcmp (hash_alg, "SHA512", 6) == 0))
+  {
+    oinfo->version = 2013;
+  }
+  else
+  {
+    fprintf (stderr, "%s uses un-supported hashing algorithm %.*s\n", ctx->fpath, (int) hash_alg_len, hash_alg);
+
+    return -1;
+  }
+
+  if (memmem (ciph_alg, ciph_alg_len, "AES", 3) == NULL)
+  {
+    fprintf (stderr, "%s uses un-supported cipher algorithm %.*s\n", ctx->fpath, (int) ciph_alg_len, ciph_alg);
+
+    return -1;
+  }
+
+  membuf_appendf (out, "$office$*%d*%u*%u*%u*", oinfo->version, oinfo->spin_count, oinfo->key_bits, oinfo->salt_size);
+
+  if ((office_xml_attr_hex (elem, elem_end, "saltValue", SIZE_MAX, out) == -1)
+   || (membuf_append (out, "*", 1) == -1)
+   || (office_xml_attr_hex (elem, elem_end, "encryptedVerifierHashInput", SIZE_MAX, out) == -1)
+   || (membuf_append (out, "*", 1) == -1)
+   || (office_xml_attr_hex (elem, elem_end, "encryptedVerifierHashValue", 64, out) == -1))
+  {
+    fprintf (stderr, "%s: bad salt or verifier in encryptedKey element\n", ctx->fpath);
+
+    return -1;
+  }
+
+  return membuf_append (out, "\n", 1);
+}
+
+// Office 2007, standard encryption, binary EncryptionHeader and EncryptionVerifier
+static int office_standard (office2hc_ctx_t *ctx, const membuf_t *info, membuf_t *out, office2hc_info_t *oinfo)
+{
+  const u8    *p   = (const u8 *) info->buf;
+  const size_t len = info->len;
+
+  if (len < 12) return -1;
+
+  const u32 header_len = office_get32 (p + 8);
+
+  // flags sizeExtra algId algIdHash keySize providerType reserved1 reserved2 CSPName
+
+  if ((header_len < 32) || ((u64) header_len + 12 + 40 > len))
+  {
+    fprintf (stderr, "%s: truncated EncryptionHeader\n", ctx->fpath);
+
+    return -1;
+  }
+
+  const u8 *hdr = p + 12;
+
+  oinfo->key_bits = office_get32 (hdr + 16);
+
+  const u8 *ver = hdr + header_len;
+
+  oinfo->salt_size = office_get32 (ver);
+
+  if (oinfo->salt_size != 16)
+  {
+    fprintf (stderr, "%s: unexpected salt size %u\n", ctx->fpath, oinfo->salt_size);
+
+    return -1;
+  }
+
+  const u8 *salt     = ver + 4;
+  const u8 *verifier = ver + 20;
+
+  const u32 hash_size = office_get32 (ver + 36);
+
+  if ((u64) (ver + 40 - p) + hash_size > len)
+  {
+    fprintf (stderr, "%s: truncated EncryptionVerifier\n", ctx->fpath);
+
+    return -1;
+  }
+
+  oinfo->version = 2007;
+
+  membuf_appendf (out, "$office$*%d*%u*%u*%u*", oinfo->version, hash_size, oinfo->key_bits, oinfo->salt_size);
+
+  membuf_append_hex (out, salt, 16);
+  membuf_append     (out, "*", 1);
+  membuf_append_hex (out, verifier, 16);
+  membuf_append     (out, "*", 1);
+  membuf_append_hex (out, ver + 40, (hash_size > 32) ? 32 : hash_size);
+
+  return membuf_append (out, "\n", 1);
+}
+
+/**************************************************************************
+ * Office 97-2003, only told apart from unencrypted ones, never converted
+ *************************************************************************/
+
+// 1 encrypted, 0 not, -1 the stream could not be read
+static int office_legacy_stream_encrypted (office2hc_ctx_t *ctx, const u8 *ent, const office2hc_legacy_t kind)
+{
+  membuf_t head;
+
+  if (membuf_init (&head, 0) == -1) return -1;
+
+  int ret = office_read_stream_head (ctx, ent, OFFICE2HC_LEGACY_HEADLEN, &head);
+
+  const u8    *p   = (const u8 *) head.buf;
+  const size_t len = head.len;
+
+  if (ret == 1)
+  {
+    ret = 0;
+
+    switch (kind)
+    {
+    case OFFICE2HC_LEGACY_WORD:
+
+      // FibBase.fEncrypted
+
+      if ((len >= 12) && (office_get16 (p + 0x0a) & WORD_FIB_ENCRYPTED)) ret = 1;
+      break;
+
+    case OFFICE2HC_LEGACY_EXCEL:
+
+      // a FILEPASS record in the workbook globals, right behind their BOF
+
+      for (size_t off = 0; off + 4 <= len;)
+      {
+        const u16 type = office_get16 (p + off);
+
+        if (type == BIFF_FILEPASS) ret = 1;
+
+        if ((type == BIFF_FILEPASS) || (type == BIFF_EOF)) break;
+
+        off += 4 + office_get16 (p + off + 2);
+      }
+      break;
+
+    case OFFICE2HC_LEGACY_POWERPOINT:
+
+      // CurrentUserAtom.headerToken
+
+      if ((len >= 16) && (office_get32 (p + 12) == PPT_TOKEN_ENCRYPTED)) ret = 1;
+      break;
+    }
+  }
+
+  membuf_destory (&head);
+
+  return ret;
+}
+
+// a compound file without EncryptionInfo, 1 if it is known to be unencrypted
+static int office_legacy (office2hc_ctx_t *ctx)
+{
+  static const struct
+  {
+    const char         *name;
+    office2hc_legacy_t  kind;
+
+  } streams[] =
+  {
+    { "WordDocument", OFFICE2HC_LEGACY_WORD       },
+    { "Workbook",     OFFICE2HC_LEGACY_EXCEL      },
+    { "Book",         OFFICE2HC_LEGACY_EXCEL      },
+    { "Current User", OFFICE2HC_LEGACY_POWERPOINT },
+  };
+
+  for (size_t i = 0; i < sizeof (streams) / sizeof (streams[0]); i++)
+  {
+    const u8 *ent = office_find_stream (ctx, streams[i].name);
+
+    if (ent == NULL) continue;
+
+    const int ret = office_legacy_stream_encrypted (ctx, ent, streams[i].kind);
+
+    if (ret == 0) return 1;
+
+    if (ret == 1)
+    {
+      fprintf (stderr, "%s: Office 97-2003 encryption (RC4 / CryptoAPI) is not supported\n", ctx->fpath);
+    }
+    else
+    {
+      fprintf (stderr, "%s: could not read %s\n", ctx->fpath, streams[i].name);
+    }
+
+    return -1;
+  }
+
+  // a package without a way to open it (IRM), or no document at all, neither is known to be unencrypted
+
+  if (office_find_stream (ctx, "EncryptedPackage") != NULL)
+  {
+    fprintf (stderr, "%s: EncryptedPackage without EncryptionInfo is not supported\n", ctx->fpath);
+  }
+  else
+  {
+    fprintf (stderr, "%s: no EncryptionInfo and no Word, Excel or PowerPoint stream\n", ctx->fpath);
+  }
+
+  return -1;
+}
+
+static int office2hc_parse (office2hc_ctx_t *ctx, membuf_t *out, office2hc_info_t *oinfo)
+{
+  // an OOXML zip is what an unencrypted document looks like
+
+  if ((ctx->len >= 2) && (memcmp (ctx->buf, "PK", 2) == 0)) return 1;
+
+  if (office_open (ctx) == -1)
+  {
+    fprintf (stderr, "%s : Invalid OLE file\n", ctx->fpath);
+
+    return -1;
+  }
+
+  const u8 *ent = office_find_stream (ctx, "EncryptionInfo");
+
+  if (ent == NULL) return office_legacy (ctx);
+
+  membuf_t info;
+
+  if (membuf_init (&info, 0) == -1) return -1;
+
+  int ret = office_read_stream (ctx, ent, &info);
+
+  if ((ret == 1) && (info.len < 8)) ret = -1;
+
+  if (ret == -1)
+  {
+    fprintf (stderr, "%s: could not read EncryptionInfo\n", ctx->fpath);
+
+    membuf_destory (&info);
+
+    return -1;
+  }
+
+  const u16 major = office_get16 ((const u8 *) info.buf + 0);
+  const u16 minor = office_get16 ((const u8 *) info.buf + 2);
+  const u32 flags = office_get32 ((const u8 *) info.buf + 4);
+
+  if (flags == 0x10)
+  {
+    fprintf (stderr, "%s : An external cryptographic provider is not supported!\n", ctx->fpath);
+
+    ret = -1;
+  }
+  else if ((major == 4) && (minor == 4))
+  {
+    if (flags != 0x40)
+    {
+      fprintf (stderr, "%s : The encryption flags are not consistent with the encryption type\n", ctx->fpath);
+
+      ret = -1;
+    }
+    else
+    {
+      ret = office_agile (ctx, &info, out, oinfo);
+    }
+  }
+  else if (minor == 2)
+  {
+    ret = office_standard (ctx, &info, out, oinfo);
+  }
+  else
+  {
+    fprintf (stderr, "%s: unsupported EncryptionInfo version %u.%u\n", ctx->fpath, major, minor);
+
+    ret = -1;
+  }
+
+  membuf_destory (&info);
+
+  return ret;
+}
+
+int office2hc_extract (const jmprobe_t *probe, membuf_t *out, office2hc_info_t *info)
+{
+  const char *fpath = probe->fpath;
+
+  memset (info, 0, sizeof (office2hc_info_t));
+
+  jmmap_t map;
+
+  if (jmprobe_map (probe, &map) == -1) return -1;
+
+  office2hc_ctx_t ctx;
+
+  memset (&ctx, 0, sizeof (ctx));
+
+  ctx.fpath = fpath;
+  ctx.buf   = map.buf;
+  ctx.len   = map.len;
+
+  const int ret = office2hc_parse (&ctx, out, info);
+
+  jmmap_close (&map);
+
+  return ret;
+}
@@ -0,0 +1,1445 @@
+/*
+ * pdf2hc, in-process replacement of pdf2hashcat.py (cvttools/posix).
+ *
+ * Output line format is unchanged:
+ *
+ *   $pdf$V*R*Length*P*EncryptMetadata*len(ID)*hex(ID)*len(U)*hex(U)*len(O)*hex(O)[*len(UE)*hex(UE)*len(OE)*hex(OE)]
+ *
+ * UE and OE are only printed for %PDF-1.7 files, like the script did.
+ *
+ * Differences to pdf2hashcat.py: the dictionaries are parsed instead of
+ * matched with regular expressions, so strings with octal escapes, hex
+ * strings with white-space and indirect /Encrypt objects that live in an
+ * object stream or behind an xref stream are handled. Only when the xref
+ * is unusable are the trailer and the object searched for in the file.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "pdf2hc.h"
+
+#include <zlib.h>
+
+/**************************************************************************
+ * lexer
+ *************************************************************************/
+
+static bool pdf_is_ws (const u8 c)
+{
+  return (c == 0x00) || (c == '\t') || (c == '\n') || (c == '\f') || (c == '\r') || (c == ' ');
+}
+
+static bool pdf_is_delim (const u8 c)
+{
+  return (c == '(') || (c == ')') || (c == '<') || (c == '>') || (c == '[') || (c == ']')
+      || (c == '{') || (c == '}') || (c == '/') || (c == '%');
+}
+
+// skips white-space and comments
+static size_t pdf_skip_ws (const u8 *buf, const size_t len, size_t pos)
+{
+  while (pos < len)
+  {
+    if (pdf_is_ws (buf[pos]))
+    {
+      pos++;
+    }
+    else if (buf[pos] == '%')
+    {
+      while ((pos < len) && (buf[pos] != '\r') && (buf[pos] != '\n')) pos++;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  return pos;
+}
+
+// end of the regular token (number, keyword, name without its slash) at pos
+static size_t pdf_token_end (const u8 *buf, const size_t len, size_t pos)
+{
+  while ((pos < len) && (pdf_is_ws (buf[pos]) == false) && (pdf_is_delim (buf[pos]) == false)) pos++;
+
+  return pos;
+}
+
+static bool pdf_is_keyword (const u8 *buf, const size_t len, const size_t pos, const char *kw)
+{
+  const size_t kw_len = strlen (kw);
+
+  if (pos + kw_len > len) return false;
+
+  if (memcmp (buf + pos, kw, kw_len) != 0) return false;
+
+  return pdf_token_end (buf, len, pos) == pos + kw_len;
+}
+
+static bool pdf_is_name (const u8 *buf, const size_t len, const size_t pos, const char *name)
+{
+  if ((pos >= len) || (buf[pos] != '/')) return false;
+
+  return pdf_is_keyword (buf, len, pos + 1, name);
+}
+
+static int pdf_parse_int (const u8 *buf, const size_t len, size_t *pos, int64_t *val)
+{
+  size_t p = *pos;
+
+  bool neg = false;
+
+  if ((p < len) && ((buf[p] == '+') || (buf[p] == '-')))
+  {
+    neg = (buf[p] == '-');
+
+    p++;
+  }
+
+  const size_t digits = p;
+
+  int64_t v = 0;
+
+  while ((p < len) && (buf[p] >= '0') && (buf[p] <= '9'))
+  {
+    if (v > (INT64_MAX - 9) / 10) return -1;
+
+    v = (v * 10) + (buf[p] - '0');
+
+    p++;
+  }
+
+  if (p == digits) return -1;
+
+  // "1.5" or "12abc" are no integers
+
+  if (pdf_token_end (buf, len, p) != p) return -1;
+
+  *val = (neg == true) ? -v : v;
+  *pos = p;
+
+  return 1;
+}
+
+// "num gen kw", kw is "R" for references and "obj" for object headers
+static int pdf_parse_ref (const u8 *buf, const size_t len, size_t *pos, const char *kw, u64 *num, u64 *gen)
+{
+  size_t p = *pos;
+
+  int64_t n = 0;
+  int64_t g = 0;
+
+  if ((p >= len) || (buf[p] < '0') || (buf[p] > '9')) return -1;
+
+  if (pdf_parse_int (buf, len, &p, &n) == -1) return -1;
+
+  p = pdf_skip_ws (buf, len, p);
+
+  if ((p >= len) || (buf[p] < '0') || (buf[p] > '9')) return -1;
+
+  if (pdf_parse_int (buf, len, &p, &g) == -1) return -1;
+
+  p = pdf_skip_ws (buf, len, p);
+
+  if (pdf_is_keyword (buf, len, p, kw) == false) return -1;
+
+  *pos = p + strlen (kw);
+  *num = (u64) n;
+  *gen = (u64) g;
+
+  return 1;
+}
+
+static int pdf_skip_value (const u8 *buf, const size_t len, size_t *pos, const int depth)
+{
+  if (depth > PDF2HC_DEPTH_MAX) return -1;
+
+  size_t p = pdf_skip_ws (buf, len, *pos);
+
+  if (p >= len) return -1;
+
+  // a reference counts as one value
+
+  u64 num = 0;
+  u64 gen = 0;
+
+  size_t ref = p;
+
+  if (pdf_parse_ref (buf, len, &ref, "R", &num, &gen) == 1)
+  {
+    *pos = ref;
+
+    return 1;
+  }
+
+  const u8 c = buf[p];
+
+  if ((c == '<') && (p + 1 < len) && (buf[p + 1] == '<'))
+  {
+    p += 2;
+
+    while (1)
+    {
+      p = pdf_skip_ws (buf, len, p);
+
+      if ((p + 1 < len) && (buf[p] == '>') && (buf[p + 1] == '>')) break;
+
+      if (pdf_skip_value (buf, len, &p, depth + 1) == -1) return -1;
+    }
+
+    p += 2;
+  }
+  else if (c == '[')
+  {
+    p += 1;
+
+    while (1)
+    {
+      p = pdf_skip_ws (buf, len, p);
+
+      if ((p < len) && (buf[p] == ']')) break;
+
+      if (pdf_skip_value (buf, len, &p, depth + 1) == -1) return -1;
+    }
+
+    p += 1;
+  }
+  else if (c == '(')
+  {
+    int nest = 0;
+
+    for (; p < len; p++)
+    {
+      if (buf[p] == '\\')
+      {
+        p++;
+
+        continue;
+      }
+
+      if (buf[p] == '(') nest++;
+
+      if ((buf[p] == ')') && (--nest == 0)) break;
+    }
+
+    if (p >= len) return -1;
+
+    p += 1;
+  }
+  else if (c == '<')
+  {
+    while ((p < len) && (buf[p] != '>')) p++;
+
+    if (p >= len) return -1;
+
+    p += 1;
+  }
+  else if (c == '/')
+  {
+    p = pdf_token_end (buf, len, p + 1);
+  }
+  else if (pdf_is_delim (c) == true)
+  {
+    return -1;
+  }
+  else
+  {
+    p = pdf_token_end (buf, len, p);
+  }
+
+  *pos = p;
+
+  return 1;
+}
+
+static int pdf_hex_nibble (const u8 c)
+{
+  if ((c >= '0') && (c <= '9')) return c - '0';
+  if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+
+  return -1;
+}
+
+// decodes the literal or hex string at pos into out (PDF2HC_STRING_MAXLEN bytes)
+static int pdf_parse_string (const u8 *buf, const size_t len, size_t pos, u8 *out, size_t *out_len)
+{
+  size_t n = 0;
+
+  pos = pdf_skip_ws (buf, len, pos);
+
+  if (pos >= len) return -1;
+
+  if (buf[pos] == '<')
+  {
+    int hi = -1;
+
+    for (pos++; (pos < len) && (buf[pos] != '>'); pos++)
+    {
+      if (pdf_is_ws (buf[pos]) == true) continue;
+
+      const int lo = pdf_hex_nibble (buf[pos]);
+
+      if (lo == -1) return -1;
+
+      if (hi == -1)
+      {
+        hi = lo;
+
+        continue;
+      }
+
+      if (n == PDF2HC_STRING_MAXLEN) return -1;
+
+      out[n++] = (u8) ((hi << 4) | lo);
+
+      hi = -1;
+    }
+
+    if (pos >= len) return -1;
+
+    // an odd last digit is followed by an implied 0
+
+    if (hi != -1)
+    {
+      if (n == PDF2HC_STRING_MAXLEN) return -1;
+
+      out[n++] = (u8) (hi << 4);
+    }
+
+    *out_len = n;
+
+    return 1;
+  }
+
+  if (buf[pos] != '(') return -1;
+
+  int nest = 1;
+
+  for (pos++; pos < len; pos++)
+  {
+    u8 c = buf[pos];
+
+    if (c == '\\')
+    {
+      if (++pos >= len) return -1;
+
+      c = buf[pos];
+
+      switch (c)
+      {
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+
+        // an escaped end-of-line continues the string on the next line
+
+        case '\r':
+          if ((pos + 1 < len) && (buf[pos + 1] == '\n')) pos++;
+          continue;
+        case '\n':
+          continue;
+
+        default:
+          if ((c >= '0') && (c <= '7'))
+          {
+            u32 v = c - '0';
+
+            for (int i = 1; (i < 3) && (pos + 1 < len) && (buf[pos + 1] >= '0') && (buf[pos + 1] <= '7'); i++)
+            {
+              v = (v << 3) | (buf[++pos] - '0');
+            }
+
+            c = (u8) v;
+          }
+          break;
+      }
+    }
+    else if (c == '(')
+    {
+      nest++;
+    }
+    else if (c == ')')
+    {
+      if (--nest == 0)
+      {
+        *out_len = n;
+
+        return 1;
+      }
+    }
+    else if (c == '\r')
+    {
+      // an unescaped end-of-line reads as a single \n
+
+      if ((pos + 1 < len) && (buf[pos + 1] == '\n')) pos++;
+
+      c = '\n';
+    }
+
+    if (n == PDF2HC_STRING_MAXLEN) return -1;
+
+    out[n++] = c;
+  }
+
+  return -1;
+}
+
+/**************************************************************************
+ * dictionaries
+ *************************************************************************/
+
+// moves pos past the "<<" of the dictionary at pos
+static int pdf_dict_open (const u8 *buf, const size_t len, size_t *pos)
+{
+  const size_t p = pdf_skip_ws (buf, len, *pos);
+
+  if ((p + 1 >= len) || (buf[p] != '<') || (buf[p + 1] != '<')) return -1;
+
+  *pos = p + 2;
+
+  return 1;
+}
+
+// next key / value pair of an opened dictionary, 0 at its end
+static int pdf_dict_next (const u8 *buf, const size_t len, size_t *pos, size_t *key, size_t *key_len, size_t *val)
+{
+  size_t p = pdf_skip_ws (buf, len, *pos);
+
+  if ((p + 1 < len) && (buf[p] == '>') && (buf[p + 1] == '>')) return 0;
+
+  if ((p >= len) || (buf[p] != '/')) return -1;
+
+  *key     = p + 1;
+  p        = pdf_token_end (buf, len, p + 1);
+  *key_len = p - *key;
+
+  p = pdf_skip_ws (buf, len, p);
+
+  *val = p;
+
+  if (pdf_skip_value (buf, len, &p, 1) == -1) return -1;
+
+  *pos = p;
+
+  return 1;
+}
+
+// value of key at the top level of the dictionary at pos, 0 if there is none
+static int pdf_dict_get (const u8 *buf, const size_t len, size_t pos, const char *key, size_t *val)
+{
+  if (pdf_dict_open (buf, len, &pos) == -1) return -1;
+
+  const size_t want_len = strlen (key);
+
+  size_t k = 0;
+  size_t k_len = 0;
+  size_t v = 0;
+
+  int ret = 0;
+
+  while ((ret = pdf_dict_next (buf, len, &pos, &k, &k_len, &v)) == 1)
+  {
+    if ((k_len == want_len) && (memcmp (buf + k, key, want_len) == 0))
+    {
+      *val = v;
+
+      return 1;
+    }
+  }
+
+  return ret;
+}
+
+static int pdf_dict_get_int (const u8 *buf, const size_t len, const size_t pos, const char *key, int64_t *val)
+{
+  size_t v = 0;
+
+  const int ret = pdf_dict_get (buf, len, pos, key, &v);
+
+  if (ret != 1) return ret;
+
+  // indirect values are not followed
+
+  u64 num = 0;
+  u64 gen = 0;
+
+  size_t ref = v;
+
+  if (pdf_parse_ref (buf, len, &ref, "R", &num, &gen) == 1) return -1;
+
+  return pdf_parse_int (buf, len, &v, val);
+}
+
+// largest /Length in the dictionary and the ones nested in it, -1 if there is none
+static int64_t pdf_dict_max_length (const u8 *buf, const size_t len, size_t pos, const int depth)
+{
+  int64_t max = -1;
+
+  if (depth > PDF2HC_DEPTH_MAX) return max;
+
+  if (pdf_dict_open (buf, len, &pos) == -1) return max;
+
+  size_t k = 0;
+  size_t k_len = 0;
+  size_t v = 0;
+
+  while (pdf_dict_next (buf, len, &pos, &k, &k_len, &v) == 1)
+  {
+    int64_t val = -1;
+
+    if ((k_len == 6) && (memcmp (buf + k, "Length", 6) == 0))
+    {
+      if (pdf_parse_int (buf, len, &v, &val) == -1) val = -1;
+    }
+    else if ((v + 1 < len) && (buf[v] == '<') && (buf[v + 1] == '<'))
+    {
+      val = pdf_dict_max_length (buf, len, v, depth + 1);
+    }
+
+    if (val > max) max = val;
+  }
+
+  return max;
+}
+
+/**************************************************************************
+ * streams
+ *************************************************************************/
+
+static int pdf_inflate (const u8 *data, const size_t len, membuf_t *mb)
+{
+  if (len > UINT32_MAX) return -1;
+
+  z_stream zs;
+
+  memset (&zs, 0, sizeof (zs));
+
+  if (inflateInit (&zs) != Z_OK) return -1;
+
+  zs.next_in  = (Bytef *) data;
+  zs.avail_in = (uInt) len;
+
+  int zret = Z_OK;
+
+  while ((zret == Z_OK) && (mb->len < PDF2HC_INFLATE_MAX))
+  {
+    if (membuf_reserve (mb, HCBUFSIZ_LARGE) == -1) break;
+
+    zs.next_out  = (Bytef *) mb->buf + mb->len;
+    zs.avail_out = (uInt) (mb->size - mb->len - 1);
+
+    zret = inflate (&zs, Z_NO_FLUSH);
+
+    mb->len = mb->size - 1 - zs.avail_out;
+
+    mb->buf[mb->len] = 0;
+  }
+
+  inflateEnd (&zs);
+
+  // streams cut short are common enough, keep what could be decoded
+
+  if (zret == Z_STREAM_END) return 1;
+
+  if ((zret == Z_BUF_ERROR) && (zs.avail_in == 0)) return 1;
+
+  return -1;
+}
+
+// undoes the PNG predictors (one byte per pixel, as xref and object streams use them)
+static int pdf_unpredict_png (membuf_t *mb, const size_t columns)
+{
+  if (columns == 0) return -1;
+
+  const size_t row_len = columns + 1;
+  const size_t rows    = mb->len / row_len;
+
+  u8 *data = (u8 *) mb->buf;
+
+  // in place, every row moves down by its number of filter type bytes
+
+  for (size_t r = 0; r < rows; r++)
+  {
+    const u8 type = data[r * row_len];
+
+    const u8 *src = data + (r * row_len) + 1;
+    const u8 *up  = (r > 0) ? data + ((r - 1) * columns) : NULL;
+
+    u8 *dst = data + (r * columns);
+
+    for (size_t i = 0; i < columns; i++)
+    {
+      const int a = (i > 0)                    ? dst[i - 1] : 0;
+      const int b = (up != NULL)               ? up[i]      : 0;
+      const int c = ((up != NULL) && (i > 0))  ? up[i - 1]  : 0;
+
+      int x = src[i];
+
+      switch (type)
+      {
+        case 0: break;
+        case 1: x += a; break;
+        case 2: x += b; break;
+        case 3: x += (a + b) / 2; break;
+        case 4:
+        {
+          const int p  = a + b - c;
+          const int pa = abs (p - a);
+          const int pb = abs (p - b);
+          const int pc = abs (p - c);
+
+          x += ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+
+          break;
+        }
+        default:
+          return -1;
+      }
+
+      dst[i] = (u8) x;
+    }
+  }
+
+  mb->len = rows * columns;
+
+  mb->buf[mb->len] = 0;
+
+  return 1;
+}
+
+// decoded data of the stream (in the file) whose dictionary is at dict
+static int pdf_read_stream (pdf2hc_ctx_t *ctx, const size_t dict, membuf_t *mb)
+{
+  const u8    *buf = ctx->buf;
+  const size_t len = ctx->len;
+
+  size_t p = dict;
+
+  if (pdf_skip_value (buf, len, &p, 0) == -1) return -1;
+
+  p = pdf_skip_ws (buf, len, p);
+
+  if (pdf_is_keyword (buf, len, p, "stream") == false) return -1;
+
+  p += 6;
+
+  if ((p < len) && (buf[p] == '\r')) p++;
+  if ((p < len) && (buf[p] == '\n')) p++;
+
+  const size_t data = p;
+
+  size_t data_len = 0;
+
+  int64_t length = 0;
+
+  // an indirect or wrong /Length is worked around by looking for endstream
+
+  if ((pdf_dict_get_int (buf, len, dict, "Length", &length) == 1) && (length >= 0) && ((u64) length <= len - data))
+  {
+    data_len = (size_t) length;
+  }
+  else
+  {
+    const u8 *end = (const u8 *) memmem (buf + data, len - data, "endstream", 9);
+
+    if (end == NULL) return -1;
+
+    data_len = end - (buf + data);
+
+    if ((data_len > 0) && (buf[data + data_len - 1] == '\n')) data_len--;
+    if ((data_len > 0) && (buf[data + data_len - 1] == '\r')) data_len--;
+  }
+
+  // only /FlateDecode, or no filter, is used for xref and object streams
+
+  size_t filter = 0;
+
+  int ret = pdf_dict_get (buf, len, dict, "Filter", &filter);
+
+  if (ret == -1) return -1;
+
+  if ((ret == 1) && (buf[filter] == '['))
+  {
+    filter = pdf_skip_ws (buf, len, filter + 1);
+
+    if ((filter < len) && (buf[filter] == ']')) ret = 0;
+  }
+
+  if (ret == 0)
+  {
+    return membuf_append (mb, buf + data, data_len);
+  }
+
+  if (pdf_is_name (buf, len, filter, "FlateDecode") == false)
+  {
+    fprintf (stderr, "%s: unsupported stream filter\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if (pdf_inflate (buf + data, data_len, mb) == -1)
+  {
+    fprintf (stderr, "%s: could not inflate stream\n", ctx->fpath);
+
+    return -1;
+  }
+
+  size_t parms = 0;
+
+  ret = pdf_dict_get (buf, len, dict, "DecodeParms", &parms);
+
+  if (ret == -1) return -1;
+
+  if ((ret == 1) && (buf[parms] == '[')) parms = pdf_skip_ws (buf, len, parms + 1);
+
+  if ((ret == 0) || (parms >= len) || (buf[parms] != '<')) return 1;
+
+  int64_t predictor = 1;
+  int64_t columns   = 1;
+
+  if (pdf_dict_get_int (buf, len, parms, "Predictor", &predictor) == -1) return -1;
+  if (pdf_dict_get_int (buf, len, parms, "Columns",   &columns)   == -1) return -1;
+
+  if (predictor == 1) return 1;
+
+  if ((predictor < 10) || (columns <= 0) || (columns > 0xffff))
+  {
+    fprintf (stderr, "%s: unsupported stream predictor\n", ctx->fpath);
+
+    return -1;
+  }
+
+  return pdf_unpredict_png (mb, (size_t) columns);
+}
+
+/**************************************************************************
+ * xref
+ *************************************************************************/
+
+// last occurrence of needle in buf[from..len)
+static const u8 *pdf_memrmem (const u8 *buf, const size_t len, const size_t from, const char *needle)
+{
+  const size_t needle_len = strlen (needle);
+
+  if (len < needle_len) return NULL;
+
+  for (size_t i = len - needle_len + 1; i > from; i--)
+  {
+    if (memcmp (buf + i - 1, needle, needle_len) == 0) return buf + i - 1;
+  }
+
+  return NULL;
+}
+
+static int pdf_find_startxref (pdf2hc_ctx_t *ctx)
+{
+  const size_t tail = (ctx->len > PDF2HC_TAIL_LEN) ? ctx->len - PDF2HC_TAIL_LEN : 0;
+
+  const u8 *kw = pdf_memrmem (ctx->buf, ctx->len, tail, "startxref");
+
+  if (kw == NULL) return -1;
+
+  size_t p = pdf_skip_ws (ctx->buf, ctx->len, (kw - ctx->buf) + 9);
+
+  int64_t offset = 0;
+
+  if (pdf_parse_int (ctx->buf, ctx->len, &p, &offset) == -1) return -1;
+
+  if ((offset <= 0) || ((u64) offset >= ctx->len)) return -1;
+
+  ctx->startxref = (size_t) offset;
+
+  return 1;
+}
+
+// "0000012345 00000 n\r\n" (or " \n", " \r") from the xref table
+static bool pdf_is_xref_row (const u8 *row)
+{
+  for (int i = 0; i < 10; i++) if ((row[i] < '0') || (row[i] > '9')) return false;
+  for (int i = 11; i < 16; i++) if ((row[i] < '0') || (row[i] > '9')) return false;
+
+  if ((row[10] != ' ') || (row[16] != ' ')) return false;
+  if ((row[17] != 'n') && (row[17] != 'f')) return false;
+
+  return (pdf_is_ws (row[18]) == true) && (pdf_is_ws (row[19]) == true);
+}
+
+static int pdf_xref_table (pdf2hc_ctx_t *ctx, size_t p, const u64 objnum, size_t *trailer, pdf2hc_xref_entry_t *entry)
+{
+  const u8    *buf = ctx->buf;
+  const size_t len = ctx->len;
+
+  while (1)
+  {
+    p = pdf_skip_ws (buf, len, p);
+
+    if (pdf_is_keyword (buf, len, p, "trailer") == true)
+    {
+      p = pdf_skip_ws (buf, len, p + 7);
+
+      *trailer = p;
+
+      return pdf_dict_open (buf, len, &p);
+    }
+
+    int64_t start = 0;
+    int64_t count = 0;
+
+    if (pdf_parse_int (buf, len, &p, &start) == -1) return -1;
+
+    p = pdf_skip_ws (buf, len, p);
+
+    if (pdf_parse_int (buf, len, &p, &count) == -1) return -1;
+
+    if ((start < 0) || (count < 0)) return -1;
+
+    p = pdf_skip_ws (buf, len, p);
+
+    // rows are 20 bytes each, so the subsection can be skipped over if the rows are well-formed
+
+    const u64 rows_len = (u64) count * 20;
+
+    if ((count > 0) && (rows_len <= len - p) && (pdf_is_xref_row (buf + p) == true) && (pdf_is_xref_row (buf + p + rows_len - 20) == true))
+    {
+      if ((objnum >= (u64) start) && (objnum < (u64) start + (u64) count))
+      {
+        const u8 *row = buf + p + ((objnum - start) * 20);
+
+        if ((pdf_is_xref_row (row) == true) && (row[17] == 'n'))
+        {
+          entry->type   = 1;
+          entry->field2 = strtoull ((const char *) row, NULL, 10);
+          entry->field3 = strtoull ((const char *) row + 11, NULL, 10);
+        }
+      }
+
+      p += rows_len;
+
+      continue;
+    }
+
+    for (int64_t i = 0; i < count; i++)
+    {
+      int64_t offset = 0;
+      int64_t gen    = 0;
+
+      p = pdf_skip_ws (buf, len, p);
+
+      if (pdf_parse_int (buf, len, &p, &offset) == -1) return -1;
+
+      p = pdf_skip_ws (buf, len, p);
+
+      if (pdf_parse_int (buf, len, &p, &gen) == -1) return -1;
+
+      p = pdf_skip_ws (buf, len, p);
+
+      const bool in_use = pdf_is_keyword (buf, len, p, "n");
+
+      if ((in_use == false) && (pdf_is_keyword (buf, len, p, "f") == false)) return -1;
+
+      p += 1;
+
+      if ((in_use == true) && ((u64) (start + i) == objnum))
+      {
+        entry->type   = 1;
+        entry->field2 = (u64) offset;
+        entry->field3 = (u64) gen;
+      }
+    }
+  }
+}
+
+static u64 pdf_read_be (const u8 *p, const int64_t width)
+{
+  u64 v = 0;
+
+  for (int64_t i = 0; i < width; i++) v = (v << 8) | p[i];
+
+  return v;
+}
+
+static int pdf_xref_stream (pdf2hc_ctx_t *ctx, size_t p, const u64 objnum, size_t *trailer, pdf2hc_xref_entry_t *entry)
+{
+  const u8    *buf = ctx->buf;
+  const size_t len = ctx->len;
+
+  u64 num = 0;
+  u64 gen = 0;
+
+  if (pdf_parse_ref (buf, len, &p, "obj", &num, &gen) == -1) return -1;
+
+  const size_t dict = pdf_skip_ws (buf, len, p);
+
+  size_t type = 0;
+
+  if (pdf_dict_get (buf, len, dict, "Type", &type) != 1) return -1;
+
+  if (pdf_is_name (buf, len, type, "XRef") == false) return -1;
+
+  *trailer = dict;
+
+  // field widths
+
+  int64_t w[3] = { 0 };
+
+  size_t v = 0;
+
+  if (pdf_dict_get (buf, len, dict, "W", &v) != 1) return -1;
+
+  if (buf[v] != '[') return -1;
+
+  v++;
+
+  for (int i = 0; i < 3; i++)
+  {
+    v = pdf_skip_ws (buf, len, v);
+
+    if (pdf_parse_int (buf, len, &v, &w[i]) == -1) return -1;
+
+    if ((w[i] < 0) || (w[i] > 8)) return -1;
+  }
+
+  const int64_t row_len = w[0] + w[1] + w[2];
+
+  if (row_len == 0) return -1;
+
+  int64_t size = 0;
+
+  if (pdf_dict_get_int (buf, len, dict, "Size", &size) != 1) return -1;
+
+  membuf_reset (&ctx->xrefstm);
+
+  if (pdf_read_stream (ctx, dict, &ctx->xrefstm) == -1) return -1;
+
+  const u8    *rows     = (const u8 *) ctx->xrefstm.buf;
+  const size_t rows_cnt = ctx->xrefstm.len / row_len;
+
+  // subsections are (first, count) pairs, [0 Size] if there is no /Index
+
+  size_t index = 0;
+
+  const int has_index = pdf_dict_get (buf, len, dict, "Index", &index);
+
+  if (has_index == -1) return -1;
+
+  if (has_index == 1)
+  {
+    if (buf[index] != '[') return -1;
+
+    index++;
+  }
+
+  u64 row = 0;
+
+  while (1)
+  {
+    int64_t start = 0;
+    int64_t count = size;
+
+    if (has_index == 1)
+    {
+      index = pdf_skip_ws (buf, len, index);
+
+      if ((index < len) && (buf[index] == ']')) break;
+
+      if (pdf_parse_int (buf, len, &index, &start) == -1) return -1;
+
+      index = pdf_skip_ws (buf, len, index);
+
+      if (pdf_parse_int (buf, len, &index, &count) == -1) return -1;
+    }
+
+    if ((start < 0) || (count < 0)) return -1;
+
+    if ((objnum >= (u64) start) && (objnum < (u64) start + (u64) count))
+    {
+      row += objnum - start;
+
+      if (row >= rows_cnt) return 1;
+
+      const u8 *r = rows + (row * row_len);
+
+      entry->type   = (w[0] == 0) ? 1 : (u32) pdf_read_be (r, w[0]);
+      entry->field2 = pdf_read_be (r + w[0], w[1]);
+      entry->field3 = pdf_read_be (r + w[0] + w[1], w[2]);
+
+      // free entries
+
+      if (entry->type == 0) memset (entry, 0, sizeof (pdf2hc_xref_entry_t));
+
+      return 1;
+    }
+
+    row += count;
+
+    if (has_index == 0) break;
+  }
+
+  return 1;
+}
+
+// one section of the xref, its trailer dictionary, and the entry of objnum if it has one
+static int pdf_xref_section (pdf2hc_ctx_t *ctx, const size_t offset, const u64 objnum, size_t *trailer, pdf2hc_xref_entry_t *entry)
+{
+  if (offset >= ctx->len) return -1;
+
+  const size_t p = pdf_skip_ws (ctx->buf, ctx->len, offset);
+
+  if (pdf_is_keyword (ctx->buf, ctx->len, p, "xref") == true)
+  {
+    return pdf_xref_table (ctx, p + 4, objnum, trailer, entry);
+  }
+
+  return pdf_xref_stream (ctx, p, objnum, trailer, entry);
+}
+
+// newest trailer that has /Encrypt, or the newest one at all
+static int pdf_find_trailer (pdf2hc_ctx_t *ctx, size_t *trailer)
+{
+  size_t offset = ctx->startxref;
+
+  for (int i = 0; i < PDF2HC_SECTIONS_MAX; i++)
+  {
+    size_t t = 0;
+
+    pdf2hc_xref_entry_t entry = { 0 };
+
+    if (pdf_xref_section (ctx, offset, UINT64_MAX, &t, &entry) == -1) return (i == 0) ? -1 : 1;
+
+    if (i == 0) *trailer = t;
+
+    size_t v = 0;
+
+    if (pdf_dict_get (ctx->buf, ctx->len, t, "Encrypt", &v) == 1)
+    {
+      *trailer = t;
+
+      break;
+    }
+
+    int64_t prev = 0;
+
+    if (pdf_dict_get_int (ctx->buf, ctx->len, t, "Prev", &prev) != 1) break;
+
+    if (prev < 0) break;
+
+    offset = (size_t) prev;
+  }
+
+  return 1;
+}
+
+static int pdf_find_object (pdf2hc_ctx_t *ctx, const u64 objnum, pdf2hc_xref_entry_t *entry)
+{
+  size_t offset = ctx->startxref;
+
+  for (int i = 0; i < PDF2HC_SECTIONS_MAX; i++)
+  {
+    size_t t = 0;
+
+    if (pdf_xref_section (ctx, offset, objnum, &t, entry) == -1) return -1;
+
+    if (entry->type != 0) return 1;
+
+    // hybrid files list compressed objects in an extra xref stream
+
+    int64_t stm = 0;
+
+    if (pdf_dict_get_int (ctx->buf, ctx->len, t, "XRefStm", &stm) == 1)
+    {
+      size_t t_stm = 0;
+
+      if ((stm > 0) && (pdf_xref_section (ctx, (size_t) stm, objnum, &t_stm, entry) == 1) && (entry->type != 0)) return 1;
+    }
+
+    int64_t prev = 0;
+
+    if (pdf_dict_get_int (ctx->buf, ctx->len, t, "Prev", &prev) != 1) break;
+
+    if (prev < 0) break;
+
+    offset = (size_t) prev;
+  }
+
+  return 0;
+}
+
+/**************************************************************************
+ * objects
+ *************************************************************************/
+
+// where the value of object num is, in the file or in ctx->objstm for compressed objects
+static int pdf_load_object (pdf2hc_ctx_t *ctx, const u64 num, const pdf2hc_xref_entry_t *entry, const u8 **obuf, size_t *olen, size_t *opos)
+{
+  if (entry->type == 1)
+  {
+    if (entry->field2 >= ctx->len) return -1;
+
+    size_t p = (size_t) entry->field2;
+
+    u64 n = 0;
+    u64 g = 0;
+
+    if (pdf_parse_ref (ctx->buf, ctx->len, &p, "obj", &n, &g) == -1) return -1;
+
+    if (n != num) return -1;
+
+    *obuf = ctx->buf;
+    *olen = ctx->len;
+    *opos = pdf_skip_ws (ctx->buf, ctx->len, p);
+
+    return 1;
+  }
+
+  if (entry->type != 2) return -1;
+
+  // the object stream itself is never compressed
+
+  pdf2hc_xref_entry_t stm_entry = { 0 };
+
+  if (pdf_find_object (ctx, entry->field2, &stm_entry) != 1) return -1;
+
+  if (stm_entry.type != 1) return -1;
+
+  const u8 *sbuf = NULL;
+
+  size_t slen = 0;
+  size_t dict = 0;
+
+  if (pdf_load_object (ctx, entry->field2, &stm_entry, &sbuf, &slen, &dict) == -1) return -1;
+
+  int64_t cnt   = 0;
+  int64_t first = 0;
+
+  if (pdf_dict_get_int (ctx->buf, ctx->len, dict, "N",     &cnt)   != 1) return -1;
+  if (pdf_dict_get_int (ctx->buf, ctx->len, dict, "First", &first) != 1) return -1;
+
+  membuf_reset (&ctx->objstm);
+
+  if (pdf_read_stream (ctx, dict, &ctx->objstm) == -1) return -1;
+
+  const u8    *buf = (const u8 *) ctx->objstm.buf;
+  const size_t len = ctx->objstm.len;
+
+  // the stream starts with N pairs of object number and offset from /First
+
+  size_t p = 0;
+
+  for (int64_t i = 0; i < cnt; i++)
+  {
+    int64_t n   = 0;
+    int64_t off = 0;
+
+    p = pdf_skip_ws (buf, len, p);
+
+    if (pdf_parse_int (buf, len, &p, &n) == -1) return -1;
+
+    p = pdf_skip_ws (buf, len, p);
+
+    if (pdf_parse_int (buf, len, &p, &off) == -1) return -1;
+
+    if ((u64) n != num) continue;
+
+    if ((first < 0) || (off < 0) || ((u64) first + (u64) off >= len)) return -1;
+
+    *obuf = buf;
+    *olen = len;
+    *opos = pdf_skip_ws (buf, len, (size_t) (first + off));
+
+    return 1;
+  }
+
+  return -1;
+}
+
+/**************************************************************************
+ * fallback for files with a broken xref
+ *************************************************************************/
+
+// the last "num gen obj" in the file
+static int pdf_scan_object (pdf2hc_ctx_t *ctx, const u64 num, const u64 gen, size_t *pos)
+{
+  char hdr[64];
+
+  snprintf (hdr, sizeof (hdr), "%" PRIu64 " %" PRIu64 " obj", num, gen);
+
+  size_t end = ctx->len;
+
+  const u8 *found = NULL;
+
+  while ((found = pdf_memrmem (ctx->buf, end, 0, hdr)) != NULL)
+  {
+    const size_t p = found - ctx->buf;
+
+    if ((p == 0) || (pdf_is_ws (ctx->buf[p - 1]) == true) || (pdf_is_delim (ctx->buf[p - 1]) == true))
+    {
+      if (pdf_is_keyword (ctx->buf, ctx->len, p + strlen (hdr) - 3, "obj") == true)
+      {
+        *pos = pdf_skip_ws (ctx->buf, ctx->len, p + strlen (hdr));
+
+        return 1;
+      }
+    }
+
+    end = p + strlen (hdr) - 1;
+  }
+
+  return -1;
+}
+
+// the dictionary after the last "trailer" in the file
+static int pdf_scan_trailer (pdf2hc_ctx_t *ctx, size_t *trailer)
+{
+  size_t end = ctx->len;
+
+  const u8 *found = NULL;
+
+  while ((found = pdf_memrmem (ctx->buf, end, 0, "trailer")) != NULL)
+  {
+    size_t p = (found - ctx->buf) + 7;
+
+    if (pdf_dict_open (ctx->buf, ctx->len, &p) == 1)
+    {
+      *trailer = pdf_skip_ws (ctx->buf, ctx->len, (found - ctx->buf) + 7);
+
+      return 1;
+    }
+
+    end = (found - ctx->buf) + 6;
+  }
+
+  return -1;
+}
+
+/**************************************************************************
+ * output
+ *************************************************************************/
+
+static int pdf2hc_write (pdf2hc_ctx_t *ctx, const u8 *ebuf, const size_t elen, const size_t edict, const size_t trailer, membuf_t *out)
+{
+  size_t v = 0;
+
+  if ((pdf_dict_get (ebuf, elen, edict, "Filter", &v) == 1) && (pdf_is_name (ebuf, elen, v, "Standard") == false))
+  {
+    fprintf (stderr, "%s: unsupported security handler\n", ctx->fpath);
+
+    return -1;
+  }
+
+  int64_t ver = 0;
+  int64_t rev = 0;
+  int64_t per = 0;
+
+  if (pdf_dict_get_int (ebuf, elen, edict, "V", &ver) != 1)
+  {
+    fprintf (stderr, "%s: could not find /V\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if (pdf_dict_get_int (ebuf, elen, edict, "R", &rev) != 1)
+  {
+    fprintf (stderr, "%s: could not find /R\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if (pdf_dict_get_int (ebuf, elen, edict, "P", &per) != 1)
+  {
+    fprintf (stderr, "%s: could not find /P\n", ctx->fpath);
+
+    return -1;
+  }
+
+  // the key length defaults to 40, the script took the largest /Length it could find
+
+  int64_t length = pdf_dict_max_length (ebuf, elen, edict, 0);
+
+  if (length == -1) length = 40;
+
+  int meta = 1;
+
+  if ((pdf_dict_get (ebuf, elen, edict, "EncryptMetadata", &v) == 1) && (pdf_is_keyword (ebuf, elen, v, "false") == true)) meta = 0;
+
+  // first half of the trailer's /ID
+
+  u8 str[PDF2HC_STRING_MAXLEN];
+
+  size_t str_len = 0;
+
+  if ((pdf_dict_get (ctx->buf, ctx->len, trailer, "ID", &v) != 1) || (ctx->buf[v] != '[')
+   || (pdf_parse_string (ctx->buf, ctx->len, v + 1, str, &str_len) == -1))
+  {
+    fprintf (stderr, "%s: could not find /ID tag\n", ctx->fpath);
+
+    return -1;
+  }
+
+  membuf_appendf (out, "$pdf$%" PRId64 "*%" PRId64 "*%" PRId64 "*%" PRId64 "*%d*%zu*", ver, rev, length, per, meta, str_len);
+
+  membuf_append_hex (out, str, str_len);
+
+  static const char *letters[] = { "U", "O", "UE", "OE" };
+
+  const int letters_cnt = ((ctx->spec_major == 1) && (ctx->spec_minor == 7)) ? 4 : 2;
+
+  for (int i = 0; i < letters_cnt; i++)
+  {
+    const int ret = pdf_dict_get (ebuf, elen, edict, letters[i], &v);
+
+    if (ret == 0)
+    {
+      if (i < 2)
+      {
+        fprintf (stderr, "%s: could not find /%s\n", ctx->fpath, letters[i]);
+
+        return -1;
+      }
+
+      continue;
+    }
+
+    if ((ret == -1) || (pdf_parse_string (ebuf, elen, v, str, &str_len) == -1))
+    {
+      fprintf (stderr, "%s: could not read /%s\n", ctx->fpath, letters[i]);
+
+      return -1;
+    }
+
+    membuf_appendf (out, "*%zu*", str_len);
+
+    membuf_append_hex (out, str, str_len);
+  }
+
+  return membuf_append (out, "\n", 1);
+}
+
+/**************************************************************************
+ * main
+ *************************************************************************/
+
+static int pdf2hc_parse (pdf2hc_ctx_t *ctx, membuf_t *out)
+{
+  // the version is taken from the header, like the script did
+
+  const size_t head_len = (ctx->len > PDF2HC_TAIL_LEN) ? PDF2HC_TAIL_LEN : ctx->len;
+
+  const u8 *hdr = (const u8 *) memmem (ctx->buf, head_len, "%PDF-", 5);
+
+  if ((hdr == NULL) || (hdr + 8 > ctx->buf + ctx->len) || (hdr[6] != '.')
+   || (hdr[5] < '0') || (hdr[5] > '9') || (hdr[7] < '0') || (hdr[7] > '9'))
+  {
+    fprintf (stderr, "%s is not a PDF file!\n", ctx->fpath);
+
+    return -1;
+  }
+
+  ctx->spec_major = hdr[5] - '0';
+  ctx->spec_minor = hdr[7] - '0';
+
+  size_t trailer = 0;
+
+  if ((pdf_find_startxref (ctx) == -1) || (pdf_find_trailer (ctx, &trailer) == -1))
+  {
+    ctx->startxref = 0;
+
+    if (pdf_scan_trailer (ctx, &trailer) == -1)
+    {
+      fprintf (stderr, "%s: can't find trailer\n", ctx->fpath);
+
+      return -1;
+    }
+  }
+
+  size_t enc = 0;
+
+  const int ret = pdf_dict_get (ctx->buf, ctx->len, trailer, "Encrypt", &enc);
+
+  if (ret == -1)
+  {
+    fprintf (stderr, "%s: malformed trailer\n", ctx->fpath);
+
+    return -1;
+  }
+
+  // not encrypted, nothing to print
+
+  if (ret == 0) return 1;
+
+  const u8 *ebuf = ctx->buf;
+
+  size_t elen  = ctx->len;
+  size_t edict = enc;
+
+  u64 num = 0;
+  u64 gen = 0;
+
+  size_t p = enc;
+
+  if (pdf_parse_ref (ctx->buf, ctx->len, &p, "R", &num, &gen) == 1)
+  {
+    pdf2hc_xref_entry_t entry = { 0 };
+
+    if ((ctx->startxref == 0)
+     || (pdf_find_object (ctx, num, &entry) != 1)
+     || (pdf_load_object (ctx, num, &entry, &ebuf, &elen, &edict) == -1))
+    {
+      ebuf = ctx->buf;
+      elen = ctx->len;
+
+      if (pdf_scan_object (ctx, num, gen, &edict) == -1)
+      {
+        fprintf (stderr, "%s: could not find the /Encrypt object\n", ctx->fpath);
+
+        return -1;
+      }
+    }
+  }
+
+  p = edict;
+
+  if (pdf_dict_open (ebuf, elen, &p) == -1)
+  {
+    fprintf (stderr, "%s: /Encrypt is not a dictionary\n", ctx->fpath);
+
+    return -1;
+  }
+
+  return pdf2hc_write (ctx, ebuf, elen, edict, trailer, out);
+}
+
+int pdf2hc_extract (const jmprobe_t *probe, membuf_t *out)
+{
+  const char *fpath = probe->fpath;
+
+  jmmap_t map;
+
+  if (jmprobe_map (probe, &map) == -1) return -1;
+
+  pdf2hc_ctx_t ctx;
+
+  memset (&ctx, 0, sizeof (ctx));
+
+  ctx.fpath = fpath;
+  ctx.buf   = map.buf;
+  ctx.len   = map.len;
+
+  int ret = -1;
+
+  if ((membuf_init (&ctx.xrefstm, 0) == 1) && (membuf_init (&ctx.objstm, 0) == 1))
+  {
+    ret = pdf2hc_parse (&ctx, out);
+  }
+
+  membuf_destory (&ctx.xrefstm);
+  membuf_destory (&ctx.objstm);
+
+  jmmap_close (&map);
+
+  return ret;
+}
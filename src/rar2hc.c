@@ -0,0 +1,799 @@
+/*
+ * rar2hc, in-process version of rar2john for RAR 3.x and RAR 5 files.
+ *
+ * Based on rar2john.c from JohnTheRipper jumbo:
+ *   Copyright (c) 2011, Dhiru Kholia <dhiru.kholia at gmail.com>
+ *   and (c) 2012, magnum and (c) 2014, JimF
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted.
+ *
+ * Output line format is unchanged, see rar2john.c for details:
+ *
+ *   archive_name:$RAR3$*0*hex(salt)*hex(partial-file-contents):0::::archive_name
+ *   archive_name:$RAR3$*1*hex(salt)*hex(crc)*PACK_SIZE*UNP_SIZE*1*hex(full encrypted file)*method:1::file_name
+ *   archive_name:$rar5$16$hex(salt)$lg2count$hex(iv)$8$hex(pswcheck)
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rar2hc.h"
+
+static const u8 RAR3_MARKER[7] = { 0x52, 0x61, 0x72, 0x21, 0x1a, 0x07, 0x00 };
+static const u8 RAR5_MARKER[8] = { 0x52, 0x61, 0x72, 0x21, 0x1a, 0x07, 0x01, 0x00 };
+
+/* Derived from unrar's encname.cpp */
+static void rar3_decode_fname (const u8 *name, const u8 *enc_name, size_t enc_size, u16 *name_w, size_t max_dec_size)
+{
+  u8 flags = 0;
+  u32 flag_bits = 0;
+  size_t enc_pos = 0, dec_pos = 0;
+  u8 high_byte = enc_name[enc_pos++];
+
+  while (enc_pos < enc_size && dec_pos < max_dec_size)
+  {
+    if (flag_bits == 0)
+    {
+      flags = enc_name[enc_pos++];
+      flag_bits = 8;
+    }
+
+    switch (flags >> 6)
+    {
+    case 0:
+      name_w[dec_pos++] = enc_name[enc_pos++];
+      break;
+    case 1:
+      name_w[dec_pos++] = enc_name[enc_pos++] + (high_byte << 8);
+      break;
+    case 2:
+      name_w[dec_pos++] = enc_name[enc_pos] + (enc_name[enc_pos + 1] << 8);
+      enc_pos += 2;
+      break;
+    case 3:
+    {
+      int length = enc_name[enc_pos++];
+
+      if (length & 0x80)
+      {
+        u8 correction = enc_name[enc_pos++];
+
+        for (length = (length & 0x7f) + 2; length > 0 && dec_pos < max_dec_size; length--, dec_pos++)
+        {
+          name_w[dec_pos] = ((name[dec_pos] + correction) & 0xff) + (high_byte << 8);
+        }
+      }
+      else
+      {
+        for (length += 2; length > 0 && dec_pos < max_dec_size; length--, dec_pos++)
+        {
+          name_w[dec_pos] = name[dec_pos];
+        }
+      }
+    }
+    break;
+    }
+
+    flags <<= 2;
+    flag_bits -= 2;
+  }
+
+  name_w[dec_pos < max_dec_size ? dec_pos : max_dec_size - 1] = 0;
+}
+
+static void utf16_to_utf8 (u8 *dst, size_t dst_size, const u16 *src)
+{
+  size_t pos = 0;
+
+  for (; *src != 0; src++)
+  {
+    u32 c = *src;
+
+    if (c >= 0xd800 && c < 0xdc00 && src[1] >= 0xdc00 && src[1] < 0xe000)
+    {
+      c = 0x10000 + ((c - 0xd800) << 10) + (src[1] - 0xdc00);
+
+      src++;
+    }
+
+    u8 tmp[4];
+    size_t n;
+
+    if (c < 0x80)
+    {
+      tmp[0] = c; n = 1;
+    }
+    else if (c < 0x800)
+    {
+      tmp[0] = 0xc0 | (c >> 6); tmp[1] = 0x80 | (c & 0x3f); n = 2;
+    }
+    else if (c < 0x10000)
+    {
+      tmp[0] = 0xe0 | (c >> 12); tmp[1] = 0x80 | ((c >> 6) & 0x3f); tmp[2] = 0x80 | (c & 0x3f); n = 3;
+    }
+    else
+    {
+      tmp[0] = 0xf0 | (c >> 18); tmp[1] = 0x80 | ((c >> 12) & 0x3f); tmp[2] = 0x80 | ((c >> 6) & 0x3f); tmp[3] = 0x80 | (c & 0x3f); n = 4;
+    }
+
+    if (pos + n >= dst_size) break;
+
+    memcpy (dst + pos, tmp, n);
+
+    pos += n;
+  }
+
+  dst[pos] = 0;
+}
+
+static u32 get_u32_le (const u8 *p)
+{
+  return ((u32) p[0]) | ((u32) p[1] << 8) | ((u32) p[2] << 16) | ((u32) p[3] << 24);
+}
+
+// position fp right behind the marker, also inside SFX stubs
+static int seek_past_marker (FILE *fp, const u8 *marker, const size_t marker_len)
+{
+  u8 buf[RAR2HC_CHUNK_SIZE];
+
+  if (fseeko (fp, 0, SEEK_SET) == -1) return -1;
+
+  if (fread (buf, 1, marker_len, fp) != marker_len) return -1;
+
+  if (memcmp (buf, marker, marker_len) == 0) return 1;
+
+  if (memcmp (buf, "MZ", 2) != 0) return -1;
+
+  // jump to "Rar!" signature
+
+  while (1)
+  {
+    const off_t chunk_pos = ftello (fp);
+
+    const size_t count = fread (buf, 1, sizeof (buf), fp);
+
+    u8 *pos = (u8 *) memmem (buf, count, marker, marker_len);
+
+    if (pos != NULL)
+    {
+      return (fseeko (fp, chunk_pos + (pos - buf) + marker_len, SEEK_SET) == -1) ? -1 : 1;
+    }
+
+    if (count < sizeof (buf)) break;
+
+    // the marker might straddle two chunks
+
+    if (fseeko (fp, - (off_t) (marker_len - 1), SEEK_CUR) == -1) return -1;
+  }
+
+  return -1;
+}
+
+/**************************************************************************
+ * RAR 3.x
+ *************************************************************************/
+
+// 1 handled, 0 no RAR 3.x marker, -1 error
+static int rar2hc_process_rar3 (rar2hc_ctx_t *ctx, FILE *fp)
+{
+  const char *archive_name = ctx->archive_name;
+
+  u8 archive_header_block[13];
+  u8 file_header_block[40];
+
+  if (seek_past_marker (fp, RAR3_MARKER, sizeof (RAR3_MARKER)) == -1) return 0;
+
+  /* archive header block */
+
+  if (fread (archive_header_block, 13, 1, fp) != 1)
+  {
+    fprintf (stderr, "%s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+    return -1;
+  }
+
+  if (archive_header_block[2] != 0x73)
+  {
+    fprintf (stderr, "%s: Error: archive_header_block[2] must be 0x73.\n", archive_name);
+
+    return -1;
+  }
+
+  /* find encryption mode used (called type in output line format) */
+
+  const u16 archive_header_head_flags = archive_header_block[4] << 8 | archive_header_block[3];
+
+  /* file header block is encrypted, RAR file was created using -hp flag */
+
+  const int type = (archive_header_head_flags & 0x0080) ? 0 : 1;
+
+  /* skip a comment block in the main header */
+
+  const u16 head_size = archive_header_block[6] << 8 | archive_header_block[5];
+
+  if (head_size > 13) fseeko (fp, head_size - 13, SEEK_CUR);
+
+  char gecos[RAR2HC_LINE_SIZE] = { 0 };
+
+  int gecos_len = 0;
+
+  u64 bestsize = 0;
+
+  membuf_t best;
+
+  if (membuf_init (&best, RAR2HC_LINE_SIZE) == -1) return -1;
+
+  int ret = 1;
+
+  while (1)
+  {
+    /* file header block */
+
+    const size_t count = fread (file_header_block, 32, 1, fp);
+
+    if (feof (fp)) break;
+
+    if (count != 1)
+    {
+      fprintf (stderr, "%s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+      ret = -1;
+
+      break;
+    }
+
+    if (type == 1 && file_header_block[2] != 0x74 && file_header_block[2] != 0x7a)
+    {
+      fprintf (stderr, "! %s: Not recognising any more headers.\n", archive_name);
+
+      break;
+    }
+
+    const u16 file_header_head_flags = file_header_block[4] << 8 | file_header_block[3];
+
+    /* process -hp mode files, use Marc's end-of-archive block decrypt trick */
+
+    if (type == 0)
+    {
+      u8 buf[24];
+
+      if (fseeko (fp, -24, SEEK_END) == -1 || fread (buf, 24, 1, fp) != 1)
+      {
+        fprintf (stderr, "%s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+        membuf_destory (&best);
+
+        return -1;
+      }
+
+      membuf_appendf (ctx->out, "%s:$RAR3$*%d*", ctx->base_aname, type);
+      membuf_append_hex (ctx->out, buf, 8);
+      membuf_appendf (ctx->out, "*");
+      membuf_append_hex (ctx->out, buf + 8, 16);
+      membuf_appendf (ctx->out, ":%d::::%s\n", type, archive_name);
+
+      ctx->done = true;
+
+      membuf_destory (&best);
+
+      return 1;
+    }
+
+    if (!(file_header_head_flags & 0x8000))
+    {
+      fprintf (stderr, "File header flag 0x8000 unset, bailing out.\n");
+
+      break;
+    }
+
+    const u16 file_header_head_size = file_header_block[6] << 8 | file_header_block[5];
+
+    u64 file_header_pack_size = get_u32_le (file_header_block + 7);
+    u64 file_header_unp_size  = get_u32_le (file_header_block + 11);
+
+    /* calculate EXT_TIME size */
+
+    int ext_time_size = file_header_head_size - 32;
+
+    u8 rejbuf[32];
+
+    if (file_header_head_flags & 0x100)
+    {
+      if (fread (rejbuf, 8, 1, fp) != 1)
+      {
+        fprintf (stderr, "! %s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+        ret = -1;
+
+        break;
+      }
+
+      file_header_pack_size += (u64) get_u32_le (rejbuf + 0) << 32;
+      file_header_unp_size  += (u64) get_u32_le (rejbuf + 4) << 32;
+
+      ext_time_size -= 8;
+    }
+
+    /* file name processing */
+
+    const u16 file_name_size = file_header_block[27] << 8 | file_header_block[26];
+
+    u8 file_name[256] = { 0 };
+
+    if (file_name_size > sizeof (file_name))
+    {
+      fprintf (stderr, "! %s: Error: file name size %u too large.\n", archive_name, file_name_size);
+
+      ret = -1;
+
+      break;
+    }
+
+    if (file_name_size > 0 && fread (file_name, file_name_size, 1, fp) != 1)
+    {
+      fprintf (stderr, "! %s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+      ret = -1;
+
+      break;
+    }
+
+    ext_time_size -= file_name_size;
+
+    /* file_name contains some wide char encoding that needs to be decoded to UTF-16 and then to UTF-8 */
+
+    if (file_header_head_flags & 0x200)
+    {
+      u16 file_name_w[256];
+
+      const size_t length = strnlen ((char *) file_name, sizeof (file_name) - 1);
+
+      if (length + 1 < file_name_size)
+      {
+        rar3_decode_fname (file_name, file_name + length + 1, file_name_size, file_name_w, 256);
+
+        if (*file_name_w) utf16_to_utf8 (file_name, sizeof (file_name), file_name_w);
+      }
+    }
+
+    /* file names are duplicated into the GECOS field, for single mode */
+
+    if (gecos_len + strlen ((char *) file_name) < RAR2HC_LINE_SIZE)
+    {
+      gecos_len += snprintf (&gecos[gecos_len], RAR2HC_LINE_SIZE - gecos_len - 1, "%s ", (char *) file_name);
+    }
+
+    /* salt processing */
+
+    u8 salt[8] = { 0 };
+
+    if (file_header_head_flags & 0x400)
+    {
+      ext_time_size -= 8;
+
+      if (fread (salt, 8, 1, fp) != 1)
+      {
+        fprintf (stderr, "! %s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+        ret = -1;
+
+        break;
+      }
+    }
+
+    /* EXT_TIME processing */
+
+    if (file_header_head_flags & 0x1000)
+    {
+      if (ext_time_size < 0 || ext_time_size > (int) sizeof (rejbuf))
+      {
+        fprintf (stderr, "! %s: Error: bad EXT_TIME size %d.\n", archive_name, ext_time_size);
+
+        ret = -1;
+
+        break;
+      }
+
+      if (ext_time_size > 0 && fread (rejbuf, ext_time_size, 1, fp) != 1)
+      {
+        fprintf (stderr, "! %s: Error: read failed: %s.\n", archive_name, strerror (errno));
+
+        ret = -1;
+
+        break;
+      }
+    }
+
+    /* skip solid files (first file is never solid), directories, unencrypted files
+     * and anything larger than what we already have, except zero-byte ones */
+
+    const bool is_solid     = (file_header_head_flags & 0x10) != 0;
+    const bool is_directory = ((file_header_head_flags & 0xe0) >> 5) == 7;
+    const bool is_encrypted = (file_header_head_flags & 0x04) != 0;
+    const bool is_larger    = (bestsize && bestsize < file_header_unp_size);
+
+    if (is_solid || is_directory || !is_encrypted || is_larger)
+    {
+      fseeko (fp, file_header_pack_size, SEEK_CUR);
+
+      continue;
+    }
+
+    bestsize = file_header_unp_size;
+
+    /* process encrypted data of size "file_header_pack_size", always stored inline */
+
+    membuf_reset (&best);
+
+    if (membuf_reserve (&best, RAR2HC_LINE_SIZE + 2 * file_header_pack_size) == -1)
+    {
+      ret = -1;
+
+      break;
+    }
+
+    membuf_appendf (&best, "%s:$RAR3$*%d*", ctx->base_aname, type);
+    membuf_append_hex (&best, salt, 8);
+    membuf_appendf (&best, "*");
+    membuf_append_hex (&best, file_header_block + 16, 4);
+    membuf_appendf (&best, "*%llu*%llu*1*", (unsigned long long) file_header_pack_size, (unsigned long long) file_header_unp_size);
+
+    u64 bytes_left = file_header_pack_size;
+
+    while (bytes_left > 0)
+    {
+      u8 bytes[RAR2HC_CHUNK_SIZE];
+
+      const size_t to_read = (bytes_left < sizeof (bytes)) ? bytes_left : sizeof (bytes);
+
+      const size_t nread = fread (bytes, 1, to_read, fp);
+
+      if (nread != to_read) fprintf (stderr, "! Error while reading archive: %s\n", strerror (errno));
+
+      membuf_append_hex (&best, bytes, nread);
+
+      if (nread == 0) break;
+
+      bytes_left -= nread;
+    }
+
+    membuf_appendf (&best, "*");
+    membuf_append_hex (&best, file_header_block + 25, 1);
+    membuf_appendf (&best, ":%d::", type);
+
+    /* keep looking for better candidates */
+  }
+
+  if (ret == 1)
+  {
+    if (best.len > 0)
+    {
+      membuf_append (ctx->out, best.buf, best.len);
+      membuf_appendf (ctx->out, "%s\n", gecos);
+
+      ctx->done = true;
+    }
+    else
+    {
+      fprintf (stderr, "! Did not find a valid encrypted candidate in %s\n", ctx->base_aname);
+    }
+  }
+
+  membuf_destory (&best);
+
+  return ret;
+}
+
+/**************************************************************************
+ * RAR 5
+ *************************************************************************/
+
+static int read_uint32 (FILE *fp, u32 *n)
+{
+  u8 buf[4];
+
+  if (fread (buf, 1, 4, fp) != 4) return 0;
+
+  *n = get_u32_le (buf);
+
+  return 4;
+}
+
+static int read_uint8 (FILE *fp, u8 *n)
+{
+  return (fread (n, 1, 1, fp) == 1) ? 1 : 0;
+}
+
+static int read_buf (FILE *fp, u8 *cp, const size_t len)
+{
+  return (fread (cp, 1, len, fp) == len) ? (int) len : 0;
+}
+
+// rar5 vint, 7 bits per byte, high bit means more to come
+static int read_vuint (FILE *fp, u64 *n)
+{
+  *n = 0;
+
+  for (int i = 0; i < 10; i++)
+  {
+    u8 c;
+
+    if (fread (&c, 1, 1, fp) != 1) return 0;
+
+    *n += (u64) (c & 0x7f) << (7 * i);
+
+    if ((c & 0x80) == 0) return i + 1;
+  }
+
+  return 0;
+}
+
+static void rar5_print_hash (rar2hc_ctx_t *ctx, const u32 lg2count, const u8 *init_v)
+{
+  membuf_appendf (ctx->out, "%s:$rar5$%d$", ctx->archive_name, RAR5_SIZE_SALT50);
+  membuf_append_hex (ctx->out, ctx->rar5_salt, RAR5_SIZE_SALT50);
+  membuf_appendf (ctx->out, "$%u$", lg2count);
+  membuf_append_hex (ctx->out, init_v, RAR5_SIZE_INITV);
+  membuf_appendf (ctx->out, "$%d$", RAR5_SIZE_PSWCHECK);
+  membuf_append_hex (ctx->out, ctx->pswcheck, RAR5_SIZE_PSWCHECK);
+  membuf_appendf (ctx->out, "\n");
+
+  ctx->done = true;
+}
+
+/**************************************************************************
+ * Process an 'extra' block of data. This is where rar5 stores the
+ * encryption record of a file.
+ *************************************************************************/
+static int rar5_process_extra (rar2hc_ctx_t *ctx, FILE *fp, const u64 extra_size)
+{
+  const off_t extra_end = ftello (fp) + extra_size;
+
+  while (ftello (fp) < extra_end)
+  {
+    u64 field_size, field_type;
+
+    const int len = read_vuint (fp, &field_size);
+
+    // rar5 technote lists max size of header len as 3 byte vint
+
+    if (len == 0 || len > 3) return 0;
+
+    const off_t field_end = ftello (fp) + field_size;
+
+    if (field_end > extra_end) return 0;
+
+    if (!read_vuint (fp, &field_type)) return 0;
+
+    if (field_type == RAR5_FHEXTRA_CRYPT)
+    {
+      u64 enc_version, flags;
+      u8  lg2count;
+      u8  init_v[RAR5_SIZE_INITV];
+
+      if (!read_vuint (fp, &enc_version)) return 0;
+      if (!read_vuint (fp, &flags)) return 0;
+
+      if ((flags & RAR5_FHEXTRA_CRYPT_PSWCHECK) == 0)
+      {
+        fprintf (stderr, "UsePswCheck is OFF. We currently don't support such files!\n");
+
+        return 0;
+      }
+
+      if (!read_uint8 (fp, &lg2count)) return 0;
+
+      if (lg2count >= RAR5_KDF_LG2_COUNT_MAX)
+      {
+        fprintf (stderr, "Lg2Count >= CRYPT5_KDF_LG2_COUNT_MAX (problem with file?)\n");
+
+        return 0;
+      }
+
+      if (!read_buf (fp, ctx->rar5_salt, RAR5_SIZE_SALT50)) return 0;
+      if (!read_buf (fp, init_v, RAR5_SIZE_INITV)) return 0;
+      if (!read_buf (fp, ctx->pswcheck, RAR5_SIZE_PSWCHECK)) return 0;
+
+      rar5_print_hash (ctx, lg2count, init_v);
+
+      return 1;
+    }
+
+    if (fseeko (fp, field_end, SEEK_SET) == -1) return 0;
+  }
+
+  return 1;
+}
+
+// returns the offset of the next block, 0 when done
+static off_t rar5_read_header (rar2hc_ctx_t *ctx, FILE *fp, const off_t cur_block_pos)
+{
+  if (ctx->encrypted)
+  {
+    // the header is encrypted, so we simply take the IV of this block
+
+    u8 headers_init_v[RAR5_SIZE_INITV];
+
+    if (!read_buf (fp, headers_init_v, RAR5_SIZE_INITV))
+    {
+      fprintf (stderr, "Error, rar file %s too short, could not read IV from header\n", ctx->archive_name);
+
+      return 0;
+    }
+
+    rar5_print_hash (ctx, ctx->rar5_iterations, headers_init_v);
+
+    return 0;
+  }
+
+  u32 head_crc;
+  u64 block_size, flags, extra_size = 0, data_size = 0;
+  u8  header_type;
+
+  if (!read_uint32 (fp, &head_crc)) return 0;
+
+  const int sizeof_vint = read_vuint (fp, &block_size);
+
+  if (!sizeof_vint) return 0;
+
+  // full size of this header, from the start of the HeaderCRC to the end of any extra data
+
+  const u64 head_size = block_size + 4 + sizeof_vint;
+
+  if (!read_uint8 (fp, &header_type)) return 0;
+  if (!read_vuint (fp, &flags)) return 0;
+
+  if ((flags & RAR5_HFL_EXTRA) != 0 && !read_vuint (fp, &extra_size)) return 0;
+  if ((flags & RAR5_HFL_DATA)  != 0 && !read_vuint (fp, &data_size))  return 0;
+
+  if (header_type == RAR5_HEAD_CRYPT)
+  {
+    u64 crypt_version, enc_flags;
+    u8  lg2count;
+
+    if (!read_vuint (fp, &crypt_version)) return 0;
+
+    if (crypt_version > RAR5_CRYPT_VERSION)
+    {
+      fprintf (stderr, "bad rar crypt version byte\n");
+
+      return 0;
+    }
+
+    if (!read_vuint (fp, &enc_flags)) return 0;
+
+    ctx->use_pswcheck = (enc_flags & RAR5_CHFL_CRYPT_PSWCHECK) != 0;
+
+    if (!read_uint8 (fp, &lg2count)) return 0;
+
+    if (lg2count > RAR5_KDF_LG2_COUNT_MAX)
+    {
+      fprintf (stderr, "rar PBKDF2 iteration count too large\n");
+
+      return 0;
+    }
+
+    ctx->rar5_iterations = lg2count;
+
+    if (!read_buf (fp, ctx->rar5_salt, RAR5_SIZE_SALT50)) return 0;
+
+    // rar2john also verifies the pswcheck sha256 checksum here, the result
+    // never makes it into the output line so it is skipped
+
+    if (ctx->use_pswcheck)
+    {
+      u8 chksum[RAR5_SIZE_PSWCHECK_CSUM];
+
+      if (!read_buf (fp, ctx->pswcheck, RAR5_SIZE_PSWCHECK)) return 0;
+      if (!read_buf (fp, chksum, RAR5_SIZE_PSWCHECK_CSUM)) return 0;
+    }
+
+    ctx->encrypted = true;
+  }
+  else if (header_type == RAR5_HEAD_MAIN)
+  {
+    u64 arc_flags, vol_number = 0;
+
+    if (!read_vuint (fp, &arc_flags)) return 0;
+
+    if ((arc_flags & RAR5_MHFL_VOLNUMBER) != 0 && !read_vuint (fp, &vol_number)) return 0;
+  }
+  else if (header_type == RAR5_HEAD_FILE || header_type == RAR5_HEAD_SERVICE)
+  {
+    u64 file_flags, unp_size, file_attr, comp_info, host_os, name_size;
+    u32 tmp;
+
+    if (!read_vuint (fp, &file_flags)) return 0;
+    if (!read_vuint (fp, &unp_size)) return 0;
+    if (!read_vuint (fp, &file_attr)) return 0;
+
+    if ((file_flags & RAR5_FHFL_UTIME) != 0 && !read_uint32 (fp, &tmp)) return 0;
+    if ((file_flags & RAR5_FHFL_CRC32) != 0 && !read_uint32 (fp, &tmp)) return 0;
+
+    if (!read_vuint (fp, &comp_info)) return 0;
+    if (!read_vuint (fp, &host_os)) return 0;
+    if (!read_vuint (fp, &name_size)) return 0;
+
+    // skip the file name
+
+    if (fseeko (fp, name_size, SEEK_CUR) == -1) return 0;
+
+    if (extra_size != 0) rar5_process_extra (ctx, fp, extra_size);
+
+    // one hash per file is all hash_extr wants
+
+    if (ctx->done) return 0;
+  }
+  else if (header_type == RAR5_HEAD_ENDARC)
+  {
+    return 0;
+  }
+
+  return cur_block_pos + head_size + data_size;
+}
+
+// 1 handled, 0 no RAR 5 marker
+static int rar2hc_process_rar5 (rar2hc_ctx_t *ctx, FILE *fp)
+{
+  if (seek_past_marker (fp, RAR5_MARKER, sizeof (RAR5_MARKER)) == -1) return 0;
+
+  while (1)
+  {
+    const off_t cur_block_pos = ftello (fp);
+
+    const off_t next_block_pos = rar5_read_header (ctx, fp, cur_block_pos);
+
+    if (next_block_pos == 0) break;
+
+    if (fseeko (fp, next_block_pos, SEEK_SET) == -1) break;
+  }
+
+  return 1;
+}
+
+static const char *rar2hc_basename (const char *path)
+{
+  const char *base = strrchr (path, '/');
+
+#if defined (_WIN)
+  const char *base_win = strrchr (path, '\\');
+
+  if (base_win > base) base = base_win;
+#endif
+
+  return (base == NULL) ? path : base + 1;
+}
+
+// appends one rar2john-style line to out, nothing if no encrypted entry was found
+int rar2hc_extract (const jmprobe_t *probe, membuf_t *out)
+{
+  const char *fpath = probe->fpath;
+
+  rar2hc_ctx_t ctx;
+
+  memset (&ctx, 0, sizeof (rar2hc_ctx_t));
+
+  ctx.archive_name = fpath;
+  ctx.base_aname   = rar2hc_basename (fpath);
+  ctx.out          = out;
+
+  FILE *fp = jmprobe_fdopen (probe);
+
+  if (fp == NULL) return -1;
+
+  int ret = rar2hc_process_rar3 (&ctx, fp);
+
+  if (ret == 0) ret = rar2hc_process_rar5 (&ctx, fp);
+
+  fclose (fp);
+
+  if (ret == 0)
+  {
+    fprintf (stderr, "! %s: Not a RAR file\n", fpath);
+
+    return -1;
+  }
+
+  return ret;
+}
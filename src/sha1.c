@@ -0,0 +1,173 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "sha1.h"
+
+#if defined (_POSIX)
+#include <sys/mman.h>
+#endif
+
+#define SHA1_ROTL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static u32 sha1_load_be (const u8 *p)
+{
+  return ((u32) p[0] << 24) | ((u32) p[1] << 16) | ((u32) p[2] << 8) | ((u32) p[3]);
+}
+
+static void sha1_store_be (u8 *p, const u32 v)
+{
+  p[0] = (u8) (v >> 24);
+  p[1] = (u8) (v >> 16);
+  p[2] = (u8) (v >>  8);
+  p[3] = (u8) (v);
+}
+
+static void sha1_transform (u32 state[5], const u8 *block)
+{
+  u32 w[80];
+
+  for (u32 i = 0; i < 16; i++) w[i] = sha1_load_be (block + i * 4);
+
+  for (u32 i = 16; i < 80; i++) w[i] = SHA1_ROTL (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+  u32 a = state[0];
+  u32 b = state[1];
+  u32 c = state[2];
+  u32 d = state[3];
+  u32 e = state[4];
+
+  for (u32 i = 0; i < 80; i++)
+  {
+    u32 f;
+    u32 k;
+
+    if (i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    }
+    else if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    }
+    else if (i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+
+    const u32 t = SHA1_ROTL (a, 5) + f + e + k + w[i];
+
+    e = d;
+    d = c;
+    c = SHA1_ROTL (b, 30);
+    b = a;
+    a = t;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void sha1_init (sha1_ctx_t *ctx)
+{
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+  ctx->state[4] = 0xc3d2e1f0;
+
+  ctx->len = 0;
+}
+
+void sha1_update (sha1_ctx_t *ctx, const void *data, size_t len)
+{
+  const u8 *p = (const u8 *) data;
+
+  size_t fill = (size_t) (ctx->len % SHA1_BLOCK_LEN);
+
+  ctx->len += len;
+
+  // top up a partial block first, then whole blocks straight from the input
+
+  if (fill > 0)
+  {
+    const size_t take = (len < SHA1_BLOCK_LEN - fill) ? len : SHA1_BLOCK_LEN - fill;
+
+    memcpy (ctx->block + fill, p, take);
+
+    p   += take;
+    len -= take;
+
+    if (fill + take < SHA1_BLOCK_LEN) return;
+
+    sha1_transform (ctx->state, ctx->block);
+  }
+
+  for (; len >= SHA1_BLOCK_LEN; p += SHA1_BLOCK_LEN, len -= SHA1_BLOCK_LEN)
+  {
+    sha1_transform (ctx->state, p);
+  }
+
+  if (len > 0) memcpy (ctx->block, p, len);
+}
+
+void sha1_final (sha1_ctx_t *ctx, u8 digest[SHA1_DIGEST_LEN])
+{
+  const u64 bits = ctx->len * 8;
+
+  size_t fill = (size_t) (ctx->len % SHA1_BLOCK_LEN);
+
+  ctx->block[fill++] = 0x80;
+
+  if (fill > SHA1_BLOCK_LEN - 8)
+  {
+    memset (ctx->block + fill, 0, SHA1_BLOCK_LEN - fill);
+
+    sha1_transform (ctx->state, ctx->block);
+
+    fill = 0;
+  }
+
+  memset (ctx->block + fill, 0, SHA1_BLOCK_LEN - 8 - fill);
+
+  sha1_store_be (ctx->block + SHA1_BLOCK_LEN - 8, (u32) (bits >> 32));
+  sha1_store_be (ctx->block + SHA1_BLOCK_LEN - 4, (u32) (bits));
+
+  sha1_transform (ctx->state, ctx->block);
+
+  for (u32 i = 0; i < 5; i++) sha1_store_be (digest + i * 4, ctx->state[i]);
+}
+
+int sha1_probe (const jmprobe_t *probe, u8 digest[SHA1_DIGEST_LEN])
+{
+  jmmap_t map;
+
+  if (jmprobe_map (probe, &map) == -1) return -1;
+
+#if defined (_POSIX)
+  if (map.mapped == true) madvise ((void *) map.buf, map.len, MADV_SEQUENTIAL);
+#endif
+
+  sha1_ctx_t ctx;
+
+  sha1_init (&ctx);
+
+  sha1_update (&ctx, map.buf, map.len);
+
+  sha1_final (&ctx, digest);
+
+  jmmap_close (&map);
+
+  return 1;
+}
@@ -0,0 +1,1201 @@
+/*
+ * szip2hc, in-process replacement of 7z2hashcat.pl (cvttools/posix).
+ *
+ * Output line format is unchanged:
+ *
+ *   $7z$type$cost$len(salt)$hex(salt)$len(iv)$hex(iv)$crc$len(data)$unpack_size$hex(data)[$crc_len$hex(coder attributes)]
+ *
+ * The last two fields are only printed if the data has to be decompressed
+ * after decrypting it (type 1 to 7), the iv is padded to 16 bytes.
+ *
+ * Differences to 7z2hashcat.pl: encoded headers compressed with LZMA2 are
+ * unpacked too, and the AES coder is searched for in every folder of a
+ * plain header, not only in the first one. The files info at the end of
+ * the header is not read, nothing in it goes into the hash. Truncated
+ * hashes (the padding attack) were switched off in the script and are not
+ * produced. Split archives (.7z.001, ...) are not joined.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "szip2hc.h"
+
+#include "Alloc.h"
+#include "LzmaDec.h"
+#include "Lzma2Dec.h"
+
+static const u8 SZIP_AES[]     = { 0x06, 0xf1, 0x07, 0x01 };
+static const u8 SZIP_LZMA1[]   = { 0x03, 0x01, 0x01 };
+static const u8 SZIP_LZMA2[]   = { 0x21 };
+static const u8 SZIP_PPMD[]    = { 0x03, 0x04, 0x01 };
+static const u8 SZIP_BCJ[]     = { 0x03, 0x03, 0x01, 0x03 };
+static const u8 SZIP_BCJ2[]    = { 0x03, 0x03, 0x01, 0x1b };
+static const u8 SZIP_BZIP2[]   = { 0x04, 0x02, 0x02 };
+static const u8 SZIP_DEFLATE[] = { 0x04, 0x01, 0x08 };
+
+static u32 szip_get32 (const u8 *p)
+{
+  return ((u32) p[0]) | ((u32) p[1] << 8) | ((u32) p[2] << 16) | ((u32) p[3] << 24);
+}
+
+static u64 szip_get64 (const u8 *p)
+{
+  return ((u64) szip_get32 (p)) | ((u64) szip_get32 (p + 4) << 32);
+}
+
+static const szip2hc_coder_t *szip_coder (const szip2hc_streams_t *st, const u64 idx)
+{
+  return ((const szip2hc_coder_t *) st->coders.buf) + idx;
+}
+
+static bool szip_coder_is (const szip2hc_coder_t *coder, const u8 *id, const size_t id_len)
+{
+  return (coder->id_len == id_len) && (memcmp (coder->id, id, id_len) == 0);
+}
+
+/**************************************************************************
+ * reader
+ *************************************************************************/
+
+static int szip_read_byte (szip2hc_reader_t *rd, u8 *b)
+{
+  if (rd->pos >= rd->len) return -1;
+
+  *b = rd->buf[rd->pos++];
+
+  return 1;
+}
+
+static int szip_read_bytes (szip2hc_reader_t *rd, const u64 cnt, const u8 **p)
+{
+  if (cnt > (u64) (rd->len - rd->pos)) return -1;
+
+  *p = rd->buf + rd->pos;
+
+  rd->pos += (size_t) cnt;
+
+  return 1;
+}
+
+static int szip_read_u32 (szip2hc_reader_t *rd, u32 *v)
+{
+  const u8 *p = NULL;
+
+  if (szip_read_bytes (rd, 4, &p) == -1) return -1;
+
+  *v = szip_get32 (p);
+
+  return 1;
+}
+
+// the leading 1 bits of the first byte tell how many bytes follow
+static int szip_read_number (szip2hc_reader_t *rd, u64 *v)
+{
+  u8 first = 0;
+
+  if (szip_read_byte (rd, &first) == -1) return -1;
+
+  u64 value = 0;
+
+  u8 mask = 0x80;
+
+  for (int i = 0; i < 8; i++)
+  {
+    if ((first & mask) == 0)
+    {
+      value |= ((u64) (first & (mask - 1))) << (8 * i);
+
+      break;
+    }
+
+    u8 b = 0;
+
+    if (szip_read_byte (rd, &b) == -1) return -1;
+
+    value |= ((u64) b) << (8 * i);
+
+    mask >>= 1;
+  }
+
+  *v = value;
+
+  return 1;
+}
+
+// a count of items that take at least one byte each, anything larger is garbage
+static int szip_read_count (szip2hc_reader_t *rd, u64 *cnt)
+{
+  if (szip_read_number (rd, cnt) == -1) return -1;
+
+  if (*cnt > (u64) (rd->len - rd->pos)) return -1;
+
+  return 1;
+}
+
+// skips the value of a property that is not needed
+static int szip_skip_data (szip2hc_reader_t *rd)
+{
+  u64 size = 0;
+
+  if (szip_read_number (rd, &size) == -1) return -1;
+
+  const u8 *p = NULL;
+
+  return szip_read_bytes (rd, size, &p);
+}
+
+static int szip_wait_for_id (szip2hc_reader_t *rd, const u64 id)
+{
+  while (true)
+  {
+    u64 cur = 0;
+
+    if (szip_read_number (rd, &cur) == -1) return -1;
+
+    if (cur == id) return 1;
+
+    if (cur == SZIP2HC_ID_END) return -1;
+
+    if (szip_skip_data (rd) == -1) return -1;
+  }
+}
+
+// a bit vector, msb first, optionally preceded by an "all defined" byte
+static int szip_read_bools (szip2hc_reader_t *rd, const u64 cnt, u8 *bools, const bool check_all)
+{
+  u8 all = 0;
+
+  if (check_all == true)
+  {
+    if (szip_read_byte (rd, &all) == -1) return -1;
+  }
+
+  if (all != 0)
+  {
+    memset (bools, 1, (size_t) cnt);
+
+    return 1;
+  }
+
+  u8 v = 0;
+  u8 mask = 0;
+
+  for (u64 i = 0; i < cnt; i++)
+  {
+    if (mask == 0)
+    {
+      if (szip_read_byte (rd, &v) == -1) return -1;
+
+      mask = 0x80;
+    }
+
+    bools[i] = ((v & mask) != 0) ? 1 : 0;
+
+    mask >>= 1;
+  }
+
+  return 1;
+}
+
+static int szip_read_digests (szip2hc_reader_t *rd, const u64 cnt, szip2hc_digest_t *digests)
+{
+  u8 *defined = (u8 *) jmcalloc ((size_t) cnt + 1, 1);
+
+  if (defined == NULL) return -1;
+
+  int ret = szip_read_bools (rd, cnt, defined, true);
+
+  for (u64 i = 0; (ret == 1) && (i < cnt); i++)
+  {
+    digests[i].defined = defined[i];
+    digests[i].crc     = 0;
+
+    if (defined[i] == 0) continue;
+
+    ret = szip_read_u32 (rd, &digests[i].crc);
+  }
+
+  jmfree (defined);
+
+  return ret;
+}
+
+/**************************************************************************
+ * streams info
+ *************************************************************************/
+
+static void szip_streams_destory (szip2hc_streams_t *st)
+{
+  jmfree (st->pack_sizes);
+  jmfree (st->folders);
+  membuf_destory (&st->coders);
+  jmfree (st->unpack_sizes);
+  jmfree (st->digests);
+  jmfree (st->sub_sizes);
+  jmfree (st->sub_digests);
+
+  memset (st, 0, sizeof (szip2hc_streams_t));
+}
+
+static int szip_read_pack_info (szip2hc_reader_t *rd, szip2hc_streams_t *st)
+{
+  if (szip_read_number (rd, &st->pack_pos) == -1) return -1;
+
+  if (szip_read_count (rd, &st->pack_cnt) == -1) return -1;
+
+  if (szip_wait_for_id (rd, SZIP2HC_ID_SIZE) == -1) return -1;
+
+  st->pack_sizes = (u64 *) jmcalloc ((size_t) st->pack_cnt + 1, sizeof (u64));
+
+  if (st->pack_sizes == NULL) return -1;
+
+  for (u64 i = 0; i < st->pack_cnt; i++)
+  {
+    if (szip_read_number (rd, &st->pack_sizes[i]) == -1) return -1;
+  }
+
+  // the crcs of the packed streams are of no use here
+
+  while (true)
+  {
+    u64 id = 0;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+
+    if (id == SZIP2HC_ID_END) return 1;
+
+    if (id == SZIP2HC_ID_CRC)
+    {
+      szip2hc_digest_t *digests = (szip2hc_digest_t *) jmcalloc ((size_t) st->pack_cnt + 1, sizeof (szip2hc_digest_t));
+
+      if (digests == NULL) return -1;
+
+      const int ret = szip_read_digests (rd, st->pack_cnt, digests);
+
+      jmfree (digests);
+
+      if (ret == -1) return -1;
+
+      continue;
+    }
+
+    if (szip_skip_data (rd) == -1) return -1;
+  }
+}
+
+static int szip_read_folder (szip2hc_reader_t *rd, szip2hc_streams_t *st, szip2hc_folder_t *folder)
+{
+  u64 coder_cnt = 0;
+
+  if (szip_read_number (rd, &coder_cnt) == -1) return -1;
+
+  if ((coder_cnt == 0) || (coder_cnt > SZIP2HC_STREAMS_MAX)) return -1;
+
+  folder->first_coder = st->coder_cnt;
+  folder->coder_cnt   = coder_cnt;
+
+  u64 in_cnt  = 0;
+  u64 out_cnt = 0;
+
+  for (u64 i = 0; i < coder_cnt; i++)
+  {
+    if (membuf_reserve (&st->coders, sizeof (szip2hc_coder_t)) == -1) return -1;
+
+    szip2hc_coder_t *coder = (szip2hc_coder_t *) (st->coders.buf + st->coders.len);
+
+    memset (coder, 0, sizeof (szip2hc_coder_t));
+
+    st->coders.len += sizeof (szip2hc_coder_t);
+    st->coder_cnt++;
+
+    u8 main_byte = 0;
+
+    if (szip_read_byte (rd, &main_byte) == -1) return -1;
+
+    if ((main_byte & 0xc0) != 0) return -1;
+
+    coder->id_len = main_byte & 0x0f;
+
+    if (coder->id_len > SZIP2HC_CODEC_ID_MAXLEN) return -1;
+
+    const u8 *p = NULL;
+
+    if (szip_read_bytes (rd, coder->id_len, &p) == -1) return -1;
+
+    memcpy (coder->id, p, coder->id_len);
+
+    u64 coder_in  = 1;
+    u64 coder_out = 1;
+
+    if ((main_byte & 0x10) != 0)
+    {
+      if (szip_read_number (rd, &coder_in)  == -1) return -1;
+      if (szip_read_number (rd, &coder_out) == -1) return -1;
+
+      if ((coder_in > SZIP2HC_STREAMS_MAX) || (coder_out > SZIP2HC_STREAMS_MAX)) return -1;
+    }
+
+    in_cnt  += coder_in;
+    out_cnt += coder_out;
+
+    if ((main_byte & 0x20) != 0)
+    {
+      if (szip_read_number (rd, &coder->props_len) == -1) return -1;
+
+      if (szip_read_bytes (rd, coder->props_len, &coder->props) == -1) return -1;
+    }
+  }
+
+  if ((in_cnt > SZIP2HC_STREAMS_MAX) || (out_cnt == 0) || (out_cnt > SZIP2HC_STREAMS_MAX)) return -1;
+
+  folder->out_cnt  = out_cnt;
+  folder->main_out = 0;
+
+  if ((in_cnt == 1) && (out_cnt == 1)) return 1;
+
+  u8 in_used[SZIP2HC_STREAMS_MAX]  = { 0 };
+  u8 out_used[SZIP2HC_STREAMS_MAX] = { 0 };
+
+  const u64 bindpair_cnt = out_cnt - 1;
+
+  if (bindpair_cnt > in_cnt) return -1;
+
+  for (u64 i = 0; i < bindpair_cnt; i++)
+  {
+    u64 in_idx  = 0;
+    u64 out_idx = 0;
+
+    if (szip_read_number (rd, &in_idx)  == -1) return -1;
+    if (szip_read_number (rd, &out_idx) == -1) return -1;
+
+    if ((in_idx >= in_cnt) || (in_used[in_idx] != 0)) return -1;
+    if ((out_idx >= out_cnt) || (out_used[out_idx] != 0)) return -1;
+
+    in_used[in_idx]   = 1;
+    out_used[out_idx] = 1;
+  }
+
+  const u64 packed_cnt = in_cnt - bindpair_cnt;
+
+  if (packed_cnt != 1)
+  {
+    for (u64 i = 0; i < packed_cnt; i++)
+    {
+      u64 idx = 0;
+
+      if (szip_read_number (rd, &idx) == -1) return -1;
+    }
+  }
+
+  // the output nothing is bound to is what the folder unpacks to
+
+  for (u64 i = 0; i < out_cnt; i++)
+  {
+    if (out_used[i] != 0) continue;
+
+    folder->main_out = i;
+
+    return 1;
+  }
+
+  return -1;
+}
+
+static int szip_read_unpack_info (szip2hc_reader_t *rd, szip2hc_streams_t *st)
+{
+  if (szip_wait_for_id (rd, SZIP2HC_ID_FOLDER) == -1) return -1;
+
+  if (szip_read_count (rd, &st->folder_cnt) == -1) return -1;
+
+  u8 external = 0;
+
+  if (szip_read_byte (rd, &external) == -1) return -1;
+
+  // folders stored in an additional stream are not supported, 7-Zip never writes them
+
+  if (external != 0) return -1;
+
+  st->folders = (szip2hc_folder_t *) jmcalloc ((size_t) st->folder_cnt + 1, sizeof (szip2hc_folder_t));
+
+  if (st->folders == NULL) return -1;
+
+  u64 out_cnt = 0;
+
+  for (u64 i = 0; i < st->folder_cnt; i++)
+  {
+    if (szip_read_folder (rd, st, &st->folders[i]) == -1) return -1;
+
+    st->folders[i].first_out = out_cnt;
+
+    out_cnt += st->folders[i].out_cnt;
+  }
+
+  if (szip_wait_for_id (rd, SZIP2HC_ID_CODERS_UNPACK_SIZE) == -1) return -1;
+
+  if (out_cnt > (u64) (rd->len - rd->pos)) return -1;
+
+  st->unpack_cnt   = out_cnt;
+  st->unpack_sizes = (u64 *) jmcalloc ((size_t) out_cnt + 1, sizeof (u64));
+
+  if (st->unpack_sizes == NULL) return -1;
+
+  for (u64 i = 0; i < out_cnt; i++)
+  {
+    if (szip_read_number (rd, &st->unpack_sizes[i]) == -1) return -1;
+  }
+
+  while (true)
+  {
+    u64 id = 0;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+
+    if (id == SZIP2HC_ID_END) return 1;
+
+    if (id == SZIP2HC_ID_CRC)
+    {
+      jmfree (st->digests);
+
+      st->digest_cnt = st->folder_cnt;
+      st->digests    = (szip2hc_digest_t *) jmcalloc ((size_t) st->folder_cnt + 1, sizeof (szip2hc_digest_t));
+
+      if (st->digests == NULL) return -1;
+
+      if (szip_read_digests (rd, st->folder_cnt, st->digests) == -1) return -1;
+
+      continue;
+    }
+
+    if (szip_skip_data (rd) == -1) return -1;
+  }
+}
+
+static u64 szip_folder_unpack_size (const szip2hc_streams_t *st, const u64 folder_idx)
+{
+  const szip2hc_folder_t *folder = &st->folders[folder_idx];
+
+  return st->unpack_sizes[folder->first_out + folder->main_out];
+}
+
+static bool szip_folder_crc_valid (const szip2hc_streams_t *st, const u64 folder_idx)
+{
+  return (folder_idx < st->digest_cnt) && (st->digests[folder_idx].defined != 0);
+}
+
+static int szip_read_substreams_info (szip2hc_reader_t *rd, szip2hc_streams_t *st)
+{
+  int ret = -1;
+
+  u64 *sub_cnt = (u64 *) jmcalloc ((size_t) st->folder_cnt + 1, sizeof (u64));
+
+  if (sub_cnt == NULL) return -1;
+
+  for (u64 i = 0; i < st->folder_cnt; i++) sub_cnt[i] = 1;
+
+  u64 id = 0;
+
+  while (true)
+  {
+    if (szip_read_number (rd, &id) == -1) goto out;
+
+    if (id == SZIP2HC_ID_NUM_UNPACK_STREAM)
+    {
+      for (u64 i = 0; i < st->folder_cnt; i++)
+      {
+        if (szip_read_number (rd, &sub_cnt[i]) == -1) goto out;
+
+        // every stream but the last needs its size listed
+
+        if (sub_cnt[i] > (u64) (rd->len - rd->pos) + 1) goto out;
+      }
+
+      continue;
+    }
+
+    if ((id == SZIP2HC_ID_CRC) || (id == SZIP2HC_ID_SIZE) || (id == SZIP2HC_ID_END)) break;
+
+    if (szip_skip_data (rd) == -1) goto out;
+  }
+
+  u64 total = 0;
+
+  for (u64 i = 0; i < st->folder_cnt; i++)
+  {
+    if ((id != SZIP2HC_ID_SIZE) && (sub_cnt[i] > 1)) goto out;
+
+    total += sub_cnt[i];
+
+    if (total > (u64) rd->len + st->folder_cnt) goto out;
+  }
+
+  st->sub_sizes   = (u64 *)              jmcalloc ((size_t) total + 1, sizeof (u64));
+  st->sub_digests = (szip2hc_digest_t *) jmcalloc ((size_t) total + 1, sizeof (szip2hc_digest_t));
+
+  if ((st->sub_sizes == NULL) || (st->sub_digests == NULL)) goto out;
+
+  for (u64 i = 0; i < st->folder_cnt; i++)
+  {
+    if (sub_cnt[i] == 0) continue;
+
+    const u64 folder_size = szip_folder_unpack_size (st, i);
+
+    u64 sum = 0;
+
+    if (id == SZIP2HC_ID_SIZE)
+    {
+      for (u64 j = 1; j < sub_cnt[i]; j++)
+      {
+        u64 size = 0;
+
+        if (szip_read_number (rd, &size) == -1) goto out;
+
+        st->sub_sizes[st->sub_size_cnt++] = size;
+
+        sum += size;
+      }
+
+      if (sum > folder_size) goto out;
+    }
+
+    st->sub_sizes[st->sub_size_cnt++] = folder_size - sum;
+  }
+
+  if (id == SZIP2HC_ID_SIZE)
+  {
+    if (szip_read_number (rd, &id) == -1) goto out;
+  }
+
+  // a folder holding a single file with a known crc has it in the unpack info already
+
+  u64 digest_cnt = 0;
+
+  for (u64 i = 0; i < st->folder_cnt; i++)
+  {
+    if ((sub_cnt[i] != 1) || (szip_folder_crc_valid (st, i) == false)) digest_cnt += sub_cnt[i];
+  }
+
+  bool have_crc = false;
+
+  while (id != SZIP2HC_ID_END)
+  {
+    if (id == SZIP2HC_ID_CRC)
+    {
+      u8 *defined = (u8 *) jmcalloc ((size_t) digest_cnt + 1, 1);
+
+      if (defined == NULL) goto out;
+
+      if (szip_read_bools (rd, digest_cnt, defined, true) == -1)
+      {
+        jmfree (defined);
+
+        goto out;
+      }
+
+      u64 k  = 0;
+      u64 k2 = 0;
+
+      for (u64 i = 0; i < st->folder_cnt; i++)
+      {
+        if ((sub_cnt[i] == 1) && (szip_folder_crc_valid (st, i) == true))
+        {
+          st->sub_digests[k++] = st->digests[i];
+
+          continue;
+        }
+
+        for (u64 j = 0; j < sub_cnt[i]; j++)
+        {
+          szip2hc_digest_t *digest = &st->sub_digests[k++];
+
+          digest->defined = defined[k2++];
+          digest->crc     = 0;
+
+          if ((digest->defined != 0) && (szip_read_u32 (rd, &digest->crc) == -1))
+          {
+            jmfree (defined);
+
+            goto out;
+          }
+        }
+      }
+
+      jmfree (defined);
+
+      have_crc = true;
+    }
+    else
+    {
+      if (szip_skip_data (rd) == -1) goto out;
+    }
+
+    if (szip_read_number (rd, &id) == -1) goto out;
+  }
+
+  // without a crc list the folder crcs still apply
+
+  if (have_crc == false)
+  {
+    u64 k = 0;
+
+    for (u64 i = 0; i < st->folder_cnt; i++)
+    {
+      if ((sub_cnt[i] == 1) && (szip_folder_crc_valid (st, i) == true))
+      {
+        st->sub_digests[k++] = st->digests[i];
+
+        continue;
+      }
+
+      k += sub_cnt[i];
+    }
+  }
+
+  st->sub_digest_cnt = st->sub_size_cnt;
+
+  ret = 1;
+
+out:
+
+  jmfree (sub_cnt);
+
+  return ret;
+}
+
+static int szip_read_streams_info (szip2hc_reader_t *rd, szip2hc_streams_t *st)
+{
+  u64 id = 0;
+
+  if (szip_read_number (rd, &id) == -1) return -1;
+
+  if (id == SZIP2HC_ID_PACK_INFO)
+  {
+    if (szip_read_pack_info (rd, st) == -1) return -1;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+  }
+
+  if (id == SZIP2HC_ID_UNPACK_INFO)
+  {
+    if (szip_read_unpack_info (rd, st) == -1) return -1;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+  }
+
+  if (id == SZIP2HC_ID_SUBSTREAMS_INFO)
+  {
+    if (st->folders == NULL) return -1;
+
+    if (szip_read_substreams_info (rd, st) == -1) return -1;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+  }
+  else if (st->folders != NULL)
+  {
+    // one file per folder
+
+    st->sub_sizes = (u64 *) jmcalloc ((size_t) st->folder_cnt + 1, sizeof (u64));
+
+    if (st->sub_sizes == NULL) return -1;
+
+    for (u64 i = 0; i < st->folder_cnt; i++) st->sub_sizes[i] = szip_folder_unpack_size (st, i);
+
+    st->sub_size_cnt = st->folder_cnt;
+  }
+
+  return (id == SZIP2HC_ID_END) ? 1 : -1;
+}
+
+// the header proper, only up to the main streams info, the files info is not needed
+static int szip_read_header (szip2hc_reader_t *rd, szip2hc_streams_t *st)
+{
+  u64 id = 0;
+
+  if (szip_read_number (rd, &id) == -1) return -1;
+
+  if (id == SZIP2HC_ID_ARCHIVE_PROPS)
+  {
+    while (true)
+    {
+      if (szip_read_number (rd, &id) == -1) return -1;
+
+      if (id == SZIP2HC_ID_END) break;
+
+      if (szip_skip_data (rd) == -1) return -1;
+    }
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+  }
+
+  if (id == SZIP2HC_ID_ADD_STREAMS_INFO)
+  {
+    szip2hc_streams_t add;
+
+    memset (&add, 0, sizeof (add));
+
+    const int ret = szip_read_streams_info (rd, &add);
+
+    szip_streams_destory (&add);
+
+    if (ret == -1) return -1;
+
+    if (szip_read_number (rd, &id) == -1) return -1;
+  }
+
+  if (id == SZIP2HC_ID_MAIN_STREAMS_INFO)
+  {
+    if (szip_read_streams_info (rd, st) == -1) return -1;
+  }
+
+  return 1;
+}
+
+/**************************************************************************
+ * hash
+ *************************************************************************/
+
+static const szip2hc_digest_t *szip_digest (const szip2hc_streams_t *st, const u64 idx)
+{
+  if (idx < st->digest_cnt)     return &st->digests[idx];
+  if (idx < st->sub_digest_cnt) return &st->sub_digests[idx];
+
+  return NULL;
+}
+
+static int szip_compression_type (const szip2hc_coder_t *coder)
+{
+  if (szip_coder_is (coder, SZIP_LZMA1,   sizeof (SZIP_LZMA1)))   return SZIP2HC_LZMA1;
+  if (szip_coder_is (coder, SZIP_LZMA2,   sizeof (SZIP_LZMA2)))   return SZIP2HC_LZMA2;
+  if (szip_coder_is (coder, SZIP_PPMD,    sizeof (SZIP_PPMD)))    return SZIP2HC_PPMD;
+  if (szip_coder_is (coder, SZIP_BCJ,     sizeof (SZIP_BCJ)))     return SZIP2HC_BCJ;
+  if (szip_coder_is (coder, SZIP_BCJ2,    sizeof (SZIP_BCJ2)))    return SZIP2HC_BCJ2;
+  if (szip_coder_is (coder, SZIP_BZIP2,   sizeof (SZIP_BZIP2)))   return SZIP2HC_BZIP2;
+  if (szip_coder_is (coder, SZIP_DEFLATE, sizeof (SZIP_DEFLATE))) return SZIP2HC_DEFLATE;
+
+  return SZIP2HC_UNCOMPRESSED;
+}
+
+static int szip_write (szip2hc_ctx_t *ctx, const szip2hc_streams_t *st, membuf_t *out)
+{
+  // the pack stream index advances with every coder in front of the AES one, like in the script
+
+  const szip2hc_folder_t *folder = NULL;
+  const szip2hc_coder_t  *aes    = NULL;
+
+  u64 aes_pos = 0;
+  u64 idx     = 0;
+  u64 offset  = st->pack_pos;
+
+  for (u64 i = 0; (aes == NULL) && (i < st->folder_cnt); i++)
+  {
+    for (u64 j = 0; j < st->folders[i].coder_cnt; j++)
+    {
+      const szip2hc_coder_t *coder = szip_coder (st, st->folders[i].first_coder + j);
+
+      if (szip_coder_is (coder, SZIP_AES, sizeof (SZIP_AES)))
+      {
+        folder  = &st->folders[i];
+        aes     = coder;
+        aes_pos = j;
+
+        break;
+      }
+
+      if (idx < st->pack_cnt) offset += st->pack_sizes[idx];
+
+      idx++;
+    }
+  }
+
+  // not encrypted
+
+  if (aes == NULL) return 1;
+
+  if ((idx >= st->pack_cnt) || (idx >= st->unpack_cnt))
+  {
+    fprintf (stderr, "%s: no pack stream for the AES coder\n", ctx->fpath);
+
+    return -1;
+  }
+
+  const u64 data_len    = st->pack_sizes[idx];
+  const u64 unpack_size = st->unpack_sizes[idx];
+
+  const szip2hc_digest_t *digest = szip_digest (st, idx);
+
+  if ((digest == NULL) || (digest->defined == 0))
+  {
+    fprintf (stderr, "%s: no CRC for the encrypted stream\n", ctx->fpath);
+
+    return -1;
+  }
+
+  // AES coder properties: cycles power, salt and iv lengths, salt, iv
+
+  if (aes->props_len == 0)
+  {
+    fprintf (stderr, "%s: AES coder without properties\n", ctx->fpath);
+
+    return -1;
+  }
+
+  const u32 power = aes->props[0] & 0x3f;
+
+  u32 salt_len = 0;
+  u32 iv_len   = SZIP2HC_IV_LEN;
+
+  const u8 *salt = NULL;
+
+  u8 iv[SZIP2HC_IV_LEN] = { 0 };
+
+  if ((aes->props[0] & 0xc0) != 0)
+  {
+    if (aes->props_len < 2)
+    {
+      fprintf (stderr, "%s: AES coder properties truncated\n", ctx->fpath);
+
+      return -1;
+    }
+
+    salt_len = ((aes->props[0] >> 7) & 1) + (aes->props[1] >> 4);
+    iv_len   = ((aes->props[0] >> 6) & 1) + (aes->props[1] & 0x0f);
+
+    if ((2 + salt_len + iv_len) > aes->props_len)
+    {
+      fprintf (stderr, "%s: AES coder properties truncated\n", ctx->fpath);
+
+      return -1;
+    }
+
+    salt = aes->props + 2;
+
+    memcpy (iv, aes->props + 2 + salt_len, iv_len);
+  }
+
+  if ((offset > (u64) ctx->len - ctx->data_offset) || (data_len > (u64) ctx->len - ctx->data_offset - offset))
+  {
+    fprintf (stderr, "%s: encrypted stream is truncated\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if (data_len > (SZIP2HC_DATA_LIMIT / 2))
+  {
+    fprintf (stderr, "%s: encrypted stream is too long (%" PRIu64 " of at most %d bytes)\n", ctx->fpath, data_len, SZIP2HC_DATA_LIMIT / 2);
+
+    return -1;
+  }
+
+  const u8 *data = ctx->buf + ctx->data_offset + offset;
+
+  // what the data is unpacked with after decrypting it, never more than one
+
+  int type = SZIP2HC_UNCOMPRESSED;
+
+  const szip2hc_coder_t *comp = NULL;
+
+  for (u64 j = aes_pos + 1; j < folder->coder_cnt; j++)
+  {
+    comp = szip_coder (st, folder->first_coder + j);
+
+    type = szip_compression_type (comp);
+
+    if (type != SZIP2HC_UNCOMPRESSED) break;
+  }
+
+  membuf_appendf (out, "$7z$%d$%u$%u$", type, power, salt_len);
+  membuf_append_hex (out, salt, salt_len);
+  membuf_appendf (out, "$%u$", iv_len);
+  membuf_append_hex (out, iv, sizeof (iv));
+  membuf_appendf (out, "$%u$%" PRIu64 "$%" PRIu64 "$", digest->crc, data_len, unpack_size);
+  membuf_append_hex (out, data, (size_t) data_len);
+
+  if (type != SZIP2HC_UNCOMPRESSED)
+  {
+    // the first file's size, the crc is over it
+
+    const u64 crc_len = (st->sub_size_cnt > 0) ? st->sub_sizes[0] : 0;
+
+    membuf_appendf (out, "$%" PRIu64 "$", crc_len);
+    membuf_append_hex (out, comp->props, (size_t) comp->props_len);
+  }
+
+  return membuf_appendf (out, "\n");
+}
+
+/**************************************************************************
+ * archive
+ *************************************************************************/
+
+// unpacks an LZMA or LZMA2 compressed header, the first pack stream of the first folder
+static int szip_unpack_header (szip2hc_ctx_t *ctx, const szip2hc_streams_t *st, membuf_t *hdr)
+{
+  const szip2hc_coder_t *coder = szip_coder (st, st->folders[0].first_coder);
+
+  if ((st->pack_cnt == 0) || (st->unpack_cnt == 0)) return -1;
+
+  const u64 pack_size   = st->pack_sizes[0];
+  const u64 unpack_size = st->unpack_sizes[0];
+
+  if ((st->pack_pos > (u64) ctx->len - ctx->data_offset) || (pack_size > (u64) ctx->len - ctx->data_offset - st->pack_pos))
+  {
+    fprintf (stderr, "%s: encoded header is truncated\n", ctx->fpath);
+
+    return -1;
+  }
+
+  if (unpack_size > SZIP2HC_HEADER_MAXLEN)
+  {
+    fprintf (stderr, "%s: encoded header is too large (%" PRIu64 " bytes)\n", ctx->fpath, unpack_size);
+
+    return -1;
+  }
+
+  if (membuf_reserve (hdr, (size_t) unpack_size) == -1) return -1;
+
+  const Byte *src = ctx->buf + ctx->data_offset + st->pack_pos;
+
+  SizeT src_len  = (SizeT) pack_size;
+  SizeT dest_len = (SizeT) unpack_size;
+
+  ELzmaStatus status;
+
+  SRes res = SZ_ERROR_UNSUPPORTED;
+
+  if (szip_coder_is (coder, SZIP_LZMA1, sizeof (SZIP_LZMA1)))
+  {
+    if (coder->props_len == LZMA_PROPS_SIZE)
+    {
+      res = LzmaDecode ((Byte *) hdr->buf, &dest_len, src, &src_len, coder->props, LZMA_PROPS_SIZE, LZMA_FINISH_ANY, &status, &g_Alloc);
+    }
+  }
+  else
+  {
+    if (coder->props_len == 1)
+    {
+      res = Lzma2Decode ((Byte *) hdr->buf, &dest_len, src, &src_len, coder->props[0], LZMA_FINISH_ANY, &status, &g_Alloc);
+    }
+  }
+
+  if ((res != SZ_OK) || (dest_len != (SizeT) unpack_size))
+  {
+    fprintf (stderr, "%s: could not unpack the encoded header (error %d)\n", ctx->fpath, res);
+
+    return -1;
+  }
+
+  hdr->len = (size_t) dest_len;
+
+  hdr->buf[hdr->len] = 0;
+
+  return 1;
+}
+
+static int szip_parse (szip2hc_ctx_t *ctx, const size_t start, membuf_t *out)
+{
+  if ((ctx->len - start) < SZIP2HC_SIGNATURE_LEN) return -1;
+
+  const u8 *sig = ctx->buf + start;
+
+  if (memcmp (sig, SZIP2HC_MAGIC, SZIP2HC_MAGIC_LEN) != 0) return -1;
+
+  const u64 next_offset = szip_get64 (sig + 12);
+  const u64 next_size   = szip_get64 (sig + 20);
+
+  ctx->data_offset = start + SZIP2HC_SIGNATURE_LEN;
+
+  const u64 avail = (u64) (ctx->len - ctx->data_offset);
+
+  if ((next_offset > avail) || (next_size > avail - next_offset)) return -1;
+
+  szip2hc_reader_t rd;
+
+  rd.buf = ctx->buf + ctx->data_offset + next_offset;
+  rd.len = (size_t) next_size;
+  rd.pos = 0;
+
+  szip2hc_streams_t st;
+
+  memset (&st, 0, sizeof (st));
+
+  membuf_t hdr;
+
+  if (membuf_init (&hdr, 0) == -1) return -1;
+
+  int ret = -1;
+
+  u64 id = 0;
+
+  if (szip_read_number (&rd, &id) == -1) goto out;
+
+  if (id == SZIP2HC_ID_HEADER)
+  {
+    if (szip_read_header (&rd, &st) == -1) goto out;
+  }
+  else if (id == SZIP2HC_ID_ENCODED_HEADER)
+  {
+    if (szip_read_streams_info (&rd, &st) == -1) goto out;
+
+    if (st.folder_cnt == 0) goto out;
+
+    const szip2hc_coder_t *coder = szip_coder (&st, st.folders[0].first_coder);
+
+    // an encrypted header gives the hash itself, a compressed one is unpacked and read instead
+
+    if (szip_coder_is (coder, SZIP_LZMA1, sizeof (SZIP_LZMA1)) || szip_coder_is (coder, SZIP_LZMA2, sizeof (SZIP_LZMA2)))
+    {
+      if (szip_unpack_header (ctx, &st, &hdr) == -1) goto out;
+
+      szip_streams_destory (&st);
+
+      rd.buf = (const u8 *) hdr.buf;
+      rd.len = hdr.len;
+      rd.pos = 0;
+
+      if (szip_read_number (&rd, &id) == -1) goto out;
+
+      if (id != SZIP2HC_ID_HEADER) goto out;
+
+      if (szip_read_header (&rd, &st) == -1) goto out;
+    }
+    else if (szip_coder_is (coder, SZIP_AES, sizeof (SZIP_AES)) == false)
+    {
+      fprintf (stderr, "%s: unsupported coder for the encoded header\n", ctx->fpath);
+
+      goto out;
+    }
+  }
+  else
+  {
+    goto out;
+  }
+
+  ret = szip_write (ctx, &st, out);
+
+out:
+
+  szip_streams_destory (&st);
+
+  membuf_destory (&hdr);
+
+  return ret;
+}
+
+/**************************************************************************
+ * sfx
+ *************************************************************************/
+
+// the archive follows the farthest section of the PE stub
+static size_t szip_sfx_pe_offset (szip2hc_ctx_t *ctx)
+{
+  const u8 *buf = ctx->buf;
+  const size_t len = ctx->len;
+
+  if ((len < 0x40) || (memcmp (buf, "MZ", 2) != 0)) return 0;
+
+  const u64 pe = szip_get32 (buf + 0x3c);
+
+  if ((pe + 24) > len) return 0;
+
+  if (memcmp (buf + pe, "PE\x00\x00", 4) != 0) return 0;
+
+  const u32 section_cnt = buf[pe + 6] | ((u32) buf[pe + 7] << 8);
+
+  // file header (20 bytes) and a 32-bit optional header (224 bytes), as the script assumed
+
+  u64 section = pe + 4 + 20 + 224;
+
+  u64 farthest = 0;
+  u64 end      = 0;
+
+  for (u32 i = 0; i < section_cnt; i++, section += 40)
+  {
+    if ((section + 40) > len) return 0;
+
+    const u32 raw_size = szip_get32 (buf + section + 16);
+    const u32 raw_ptr  = szip_get32 (buf + section + 20);
+
+    if (raw_ptr <= farthest) continue;
+
+    farthest = raw_ptr;
+    end      = (u64) raw_ptr + raw_size;
+  }
+
+  if (end >= len) return 0;
+
+  return (size_t) end;
+}
+
+static int szip_parse_sfx (szip2hc_ctx_t *ctx, membuf_t *out)
+{
+  // the PE layout first, then sector boundaries, then anywhere
+
+  const size_t pe = szip_sfx_pe_offset (ctx);
+
+  if ((pe != 0) && (szip_parse (ctx, pe, out) == 1) && (out->len != 0)) return 1;
+
+  membuf_reset (out);
+
+  for (size_t pos = SZIP2HC_SFX_ALIGN; (pos + SZIP2HC_MAGIC_LEN) <= ctx->len; pos += SZIP2HC_SFX_ALIGN)
+  {
+    if ((pos == pe) || (memcmp (ctx->buf + pos, SZIP2HC_MAGIC, SZIP2HC_MAGIC_LEN) != 0)) continue;
+
+    if ((szip_parse (ctx, pos, out) == 1) && (out->len != 0)) return 1;
+
+    membuf_reset (out);
+  }
+
+  for (size_t pos = 1; pos < ctx->len; pos++)
+  {
+    const u8 *p = (const u8 *) memmem (ctx->buf + pos, ctx->len - pos, SZIP2HC_MAGIC, SZIP2HC_MAGIC_LEN);
+
+    if (p == NULL) break;
+
+    pos = (size_t) (p - ctx->buf);
+
+    if ((pos == pe) || ((pos % SZIP2HC_SFX_ALIGN) == 0)) continue;
+
+    if ((szip_parse (ctx, pos, out) == 1) && (out->len != 0)) return 1;
+
+    membuf_reset (out);
+  }
+
+  fprintf (stderr, "%s: neither a supported 7-Zip file nor a supported SFX file\n", ctx->fpath);
+
+  return -1;
+}
+
+int szip2hc_extract (const jmprobe_t *probe, membuf_t *out)
+{
+  const char *fpath = probe->fpath;
+
+  jmmap_t map;
+
+  if (jmprobe_map (probe, &map) == -1) return -1;
+
+  szip2hc_ctx_t ctx;
+
+  memset (&ctx, 0, sizeof (ctx));
+
+  ctx.fpath = fpath;
+  ctx.buf   = map.buf;
+  ctx.len   = map.len;
+
+  int ret = 0;
+
+  if ((ctx.len >= SZIP2HC_MAGIC_LEN) && (memcmp (ctx.buf, SZIP2HC_MAGIC, SZIP2HC_MAGIC_LEN) == 0))
+  {
+    ret = szip_parse (&ctx, 0, out);
+
+    if (ret == -1) fprintf (stderr, "%s: invalid 7z header\n", fpath);
+  }
+  else
+  {
+    ret = szip_parse_sfx (&ctx, out);
+  }
+
+  jmmap_close (&map);
+
+  return ret;
+}
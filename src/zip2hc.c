@@ -0,0 +1,689 @@
+/*
+ * zip2hc, in-process version of zip2john for WinZip AES, PKWARE strong
+ * encryption and traditional PKZIP files.
+ *
+ * Based on zip2john.c from JohnTheRipper jumbo:
+ *   Copyright (c) 2011, 2012, Dhiru Kholia <dhiru.kholia at gmail.com>
+ *   and (c) 2011, 2012, JimF
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted.
+ *
+ * The hash part of the zip2john line is unchanged, but returned bare:
+ *
+ *   $zip2$*0*strength*0*hex(salt)*hex(verifier)*hex(len)*hex(data)*hex(authcode)*$/zip2$
+ *   $zip3$*0*algid*bitlen*0*hex(iv)*hex(erd)*0*0*0*filename
+ *   $pkzip2$count*check_bytes*[1*...*]2*...*$/pkzip2$
+ *
+ * Differences to zip2john: only the first hash of an archive is returned
+ * (the one the driver used to cut out of zip2john's output), the -a -o -c
+ * -m -2 options are gone, so file magic is never used.
+ */
+
+#include "zip2hc.h"
+
+static u16 fget16le (FILE *fp)
+{
+  u8 buf[2] = { 0 };
+
+  if (fread (buf, 1, 2, fp) != 2) return 0;
+
+  return ((u16) buf[0]) | ((u16) buf[1] << 8);
+}
+
+static u32 fget32le (FILE *fp)
+{
+  u8 buf[4] = { 0 };
+
+  if (fread (buf, 1, 4, fp) != 4) return 0;
+
+  return ((u32) buf[0]) | ((u32) buf[1] << 8) | ((u32) buf[2] << 16) | ((u32) buf[3] << 24);
+}
+
+static u64 fget64le (FILE *fp)
+{
+  const u64 lo = fget32le (fp);
+  const u64 hi = fget32le (fp);
+
+  return lo | (hi << 32);
+}
+
+static void zip2hc_set_info (zip2hc_ctx_t *ctx, const zip2hc_kind_t kind, const u8 *filename)
+{
+  zip2hc_info_t *info = ctx->info;
+
+  info->kind = kind;
+
+  snprintf (info->fname, sizeof (info->fname), "%s", (const char *) filename);
+}
+
+/**************************************************************************
+ * WinZip AES
+ *************************************************************************/
+
+// 1 hash written, 0 entry skipped, -1 error
+static int zip2hc_process_aes (zip2hc_ctx_t *ctx, const u8 *filename, const u16 extrafield_length, const u64 compressed_size, const u64 offset)
+{
+  FILE *fp = ctx->fp;
+
+  const off_t extra_end = ftello (fp) + extrafield_length;
+
+  bool found = false;
+
+  u16 efh_datasize = 0;
+
+  while (ftello (fp) + 4 <= extra_end)
+  {
+    const u16 efh_id = fget16le (fp);
+
+    efh_datasize = fget16le (fp);
+
+    if (efh_id == 0x9901)
+    {
+      found = true;
+
+      break;
+    }
+
+    if (fseeko (fp, efh_datasize, SEEK_CUR) == -1) return -1;
+  }
+
+  if (found == false)
+  {
+    fprintf (stderr, "Unable to parse %s which is using WinZip AES encryption!\n", ctx->archive_name);
+
+    return -1;
+  }
+
+  // data size is currently 7, but the spec says not to rely on that
+
+  if (efh_datasize != ZIP2HC_AES_EXTRA_LEN - 4)
+  {
+    fprintf (stderr, "AES_EXTRA_DATA_LENGTH is not 11 for %s\n", ctx->archive_name);
+
+    return -1;
+  }
+
+  const u16 efh_vendor_version = fget16le (fp);
+  const u16 efh_vendor_id      = fget16le (fp);
+  const int efh_aes_strength   = fgetc (fp);
+  const u16 actual_cmptype     = fget16le (fp);
+
+  (void) efh_vendor_version;
+  (void) efh_vendor_id;
+
+  if (efh_aes_strength < 1 || efh_aes_strength > 3)
+  {
+    fprintf (stderr, "%s->%s: invalid AES strength %d\n", ctx->archive_name, filename, efh_aes_strength);
+
+    return -1;
+  }
+
+  if (fseeko (fp, extra_end, SEEK_SET) == -1) return -1;
+
+  // password verification value -> 2 bytes, salt value -> (4 + 4 * efh_aes_strength)
+
+  const u32 salt_len = 4 + 4 * efh_aes_strength;
+
+  if (compressed_size < 2 + salt_len + ZIP2HC_AES_AUTH_LEN)
+  {
+    fprintf (stderr, "%s->%s: AES entry too short\n", ctx->archive_name, filename);
+
+    return -1;
+  }
+
+  const u64 real_cmpr_len = compressed_size - 2 - salt_len - ZIP2HC_AES_AUTH_LEN;
+
+  u8 salt[16];
+  u8 verifier[2];
+  u8 authcode[ZIP2HC_AES_AUTH_LEN];
+
+  u8 *data = (u8 *) jmmalloc (real_cmpr_len + 1);
+
+  if (data == NULL) return -1;
+
+  if (fread (salt,     1, salt_len,          fp) != salt_len
+   || fread (verifier, 1, sizeof (verifier), fp) != sizeof (verifier)
+   || fread (data,     1, real_cmpr_len,     fp) != real_cmpr_len
+   || fread (authcode, 1, sizeof (authcode), fp) != sizeof (authcode))
+  {
+    fprintf (stderr, "Error, in fread of file data!\n");
+
+    jmfree (data);
+
+    return -1;
+  }
+
+  membuf_appendf (ctx->out, "$zip2$*0*%x*%x*", efh_aes_strength, 0);
+  membuf_append_hex (ctx->out, salt, salt_len);
+  membuf_appendf (ctx->out, "*");
+  membuf_append_hex (ctx->out, verifier, sizeof (verifier));
+  membuf_appendf (ctx->out, "*%" PRIx64 "*", real_cmpr_len);
+  membuf_append_hex (ctx->out, data, real_cmpr_len);
+  membuf_appendf (ctx->out, "*");
+  membuf_append_hex (ctx->out, authcode, sizeof (authcode));
+  membuf_appendf (ctx->out, "*$/zip2$");
+
+  jmfree (data);
+
+  zip2hc_set_info (ctx, ZIP2HC_KIND_AES, filename);
+
+  ctx->info->cmptype      = actual_cmptype;
+  ctx->info->offset       = offset;
+  ctx->info->offex        = extra_end - offset;
+  ctx->info->cmp_len      = compressed_size;
+  ctx->info->aes_strength = (u8) efh_aes_strength;
+
+  return 1;
+}
+
+/**************************************************************************
+ * PKWARE strong encryption, APPNOTE-6.3.4.TXT
+ *************************************************************************/
+
+// 1 hash written, 0 not a supported decryption header
+static int zip2hc_process_strong (zip2hc_ctx_t *ctx, const u8 *filename, u32 crc, u64 uncompressed_size)
+{
+  FILE *fp = ctx->fp;
+
+  u8 iv[16];
+  u8 erd[256];
+
+  u16 iv_size = fget16le (fp);
+
+  if (iv_size > sizeof (iv)) return 0;
+
+  if (fread (iv, 1, iv_size, fp) != iv_size) return 0;
+
+  const u32 size   = fget32le (fp);
+  const u16 format = fget16le (fp);
+
+  (void) size;
+
+  if (format != 3) return 0;
+
+  u16 alg_id = fget16le (fp);
+
+  if (alg_id == 0x660e || alg_id == 0x660f || alg_id == 0x6610)
+  {
+    alg_id = 1;
+  }
+  else
+  {
+    if (alg_id == 0x6603 || alg_id == 0x6609 || alg_id == 0x6720 || alg_id == 0x6721 || alg_id == 0x6801)
+    {
+      fprintf (stderr, "AlgId (%x) is currently unsupported\n", alg_id);
+    }
+
+    return 0;
+  }
+
+  if (iv_size == 0)
+  {
+    // little endian crc and size make up the iv
+
+    memset (iv, 0, sizeof (iv));
+
+    for (int i = 0; i < 4; i++) iv[i]     = (u8) (crc >> (8 * i));
+    for (int i = 0; i < 8; i++) iv[4 + i] = (u8) (uncompressed_size >> (8 * i));
+
+    iv_size = 12;
+  }
+
+  const u16 bitlen   = fget16le (fp);
+  const u16 flags    = fget16le (fp);
+  const u16 erd_size = fget16le (fp);
+
+  (void) flags;
+
+  if (erd_size > sizeof (erd)) return 0;
+
+  if (fread (erd, 1, erd_size, fp) != erd_size) return 0;
+
+  const u32 reserved1 = fget32le (fp);
+
+  if (reserved1 != 0)
+  {
+    fprintf (stderr, "Reserved1 is %u (non-zero)\n", reserved1);
+
+    return 0;
+  }
+
+  membuf_appendf (ctx->out, "$zip3$*%d*%d*%d*%d*", 0, alg_id, bitlen, 0);
+  membuf_append_hex (ctx->out, iv, iv_size);
+  membuf_appendf (ctx->out, "*");
+  membuf_append_hex (ctx->out, erd, erd_size);
+  membuf_appendf (ctx->out, "*0*0*0*%s", (const char *) filename);
+
+  zip2hc_set_info (ctx, ZIP2HC_KIND_STRONG, filename);
+
+  ctx->info->crc        = crc;
+  ctx->info->decomp_len = uncompressed_size;
+
+  return 1;
+}
+
+/**************************************************************************
+ * traditional PKZIP
+ *************************************************************************/
+
+/*
+ * If the archive was created from a non-seekable stream, CRC and sizes are
+ * only known after the file data, so look for whatever follows it.
+ */
+static void zip2hc_scan_for_eod (FILE *fp, zip2hc_blob_t *p, const bool size64)
+{
+  const off_t saved_pos = ftello (fp);
+
+  // crc32 + two sizes, in front of the next signature
+
+  const off_t desc_len = 4 + ((size64 == true) ? 16 : 8);
+
+  u32 sig = 0;
+
+  int c;
+
+  while ((c = fgetc (fp)) != EOF)
+  {
+    sig = (sig >> 8) | ((u32) c << 24);
+
+    if (sig == ZIP2HC_DATA_DESCRIPTOR)
+    {
+      // signature is followed by the descriptor
+    }
+    else if (sig == ZIP2HC_LOCAL_HEADER || sig == ZIP2HC_CENTRAL_DIR)
+    {
+      // descriptor without signature, in front of the next header
+
+      if (fseeko (fp, -(4 + desc_len), SEEK_CUR) == -1) break;
+    }
+    else
+    {
+      continue;
+    }
+
+    p->crc = fget32le (fp);
+
+    if (size64 == true)
+    {
+      p->cmp_len    = fget64le (fp);
+      p->decomp_len = fget64le (fp);
+    }
+    else
+    {
+      p->cmp_len    = fget32le (fp);
+      p->decomp_len = fget32le (fp);
+    }
+
+    break;
+  }
+
+  fseeko (fp, saved_pos, SEEK_SET);
+}
+
+// 1 blob loaded, 0 entry skipped, -1 error
+static int zip2hc_load_blob (zip2hc_ctx_t *ctx, zip2hc_blob_t *p)
+{
+  FILE *fp = ctx->fp;
+
+  memset (p, 0, sizeof (zip2hc_blob_t));
+
+  p->offset = ftello (fp) - 4;
+
+  const u16 version      = fget16le (fp);
+  const u16 flags        = fget16le (fp);
+
+  p->cmptype             = fget16le (fp);
+
+  const u16 lastmod_time = fget16le (fp);
+  const u16 lastmod_date = fget16le (fp);
+
+  p->crc                 = fget32le (fp);
+  p->cmp_len             = fget32le (fp);
+  p->decomp_len          = fget32le (fp);
+
+  const u16 filename_length   = fget16le (fp);
+  const u16 extrafield_length = fget16le (fp);
+
+  (void) lastmod_date;
+
+  if (filename_length >= sizeof (p->fname) || fread (p->fname, 1, filename_length, fp) != filename_length)
+  {
+    fprintf (stderr, "Error, fread could not read the data from the file: %s\n", ctx->archive_name);
+
+    return -1;
+  }
+
+  p->fname[filename_length] = 0;
+
+  p->offex = 30 + filename_length + extrafield_length;
+
+  bool size64 = false;
+
+  // we only handle implode or store, 0x314 (788) was seen at 2012 CMIYC
+
+  if ((flags & 1) == 0 || (version != 10 && version != 20 && version != 45 && version != 788))
+  {
+    if (p->cmp_len == 0 && p->decomp_len == 0) zip2hc_scan_for_eod (fp, p, version >= 45);
+
+    fseeko (fp, extrafield_length, SEEK_CUR);
+    fseeko (fp, p->cmp_len, SEEK_CUR);
+
+    return 0;
+  }
+
+  if (flags & (1 << 3))
+  {
+    u32 extra_len_used = 0;
+
+    while (extra_len_used < extrafield_length)
+    {
+      const u16 efh_id = fget16le (fp);
+
+      u16 efh_datasize = fget16le (fp);
+
+      if (efh_id == 0x0001)
+      {
+        size64 = true;
+
+        p->decomp_len = fget64le (fp);
+        p->cmp_len    = fget64le (fp);
+
+        extra_len_used += 16;
+        efh_datasize   -= 16;
+      }
+
+      fseeko (fp, efh_datasize, SEEK_CUR);
+
+      extra_len_used += 4 + efh_datasize;
+
+      // Info-ZIP extra fields, these use a 2 byte checksum taken from the timestamp
+
+      if (efh_id == 0x07c8     // Macintosh (old, J. Lee)
+       || efh_id == 0x334d     // Macintosh (new, D. Haase's 'Mac3' field)
+       || efh_id == 0x4d49     // OpenVMS (obsolete)
+       || efh_id == 0x5855     // UNIX (original; also OS/2, NT, etc.)
+       || efh_id == 0x6375     // UTF-8 comment field
+       || efh_id == 0x7075     // UTF-8 name field
+       || efh_id == 0x7855     // UNIX (16-bit UID/GID info)
+       || efh_id == 0x7875)    // UNIX 3rd generation (generic UID/GID, ...)
+      {
+        ctx->check_bytes  = 2;
+        ctx->check_in_crc = 0;
+      }
+    }
+  }
+  else if (extrafield_length)
+  {
+    fseeko (fp, extrafield_length, SEEK_CUR);
+  }
+
+  if (p->cmp_len == 0 && p->decomp_len == 0) zip2hc_scan_for_eod (fp, p, size64);
+
+  p->hash_data = (u8 *) jmmalloc (p->cmp_len + 1);
+
+  if (p->hash_data == NULL) return -1;
+
+  if (fread (p->hash_data, 1, p->cmp_len, fp) != p->cmp_len)
+  {
+    fprintf (stderr, "Error, fread could not read the data from the file: %s\n", ctx->archive_name);
+
+    jmfree (p->hash_data);
+
+    p->hash_data = NULL;
+
+    return -1;
+  }
+
+  // checksum bytes, from the crc or from the timestamp
+
+  snprintf (p->chksum,  sizeof (p->chksum),  "%02x%02x", (p->crc >> 24) & 0xff, (p->crc >> 16) & 0xff);
+  snprintf (p->chksum2, sizeof (p->chksum2), "%02x%02x", lastmod_time >> 8, lastmod_time & 0xff);
+
+  return 1;
+}
+
+// keeps the smallest entries, sorted by cmp_len, zip2john's selection without file magic
+static void zip2hc_keep_blob (zip2hc_ctx_t *ctx, zip2hc_blob_t *cur)
+{
+  zip2hc_blob_t *hashes = ctx->hashes;
+
+  if (ctx->hashes_cnt == ZIP2HC_HASHES_MAX)
+  {
+    if (cur->cmp_len < hashes[0].cmp_len)
+    {
+      jmfree (hashes[0].hash_data);
+
+      hashes[0] = *cur;
+    }
+    else
+    {
+      jmfree (cur->hash_data);
+    }
+
+    return;
+  }
+
+  u32 pos = 0;
+
+  while (pos < ctx->hashes_cnt && cur->cmp_len >= hashes[pos].cmp_len) pos++;
+
+  for (u32 i = ctx->hashes_cnt; i > pos; i--) hashes[i] = hashes[i - 1];
+
+  hashes[pos] = *cur;
+
+  ctx->hashes_cnt++;
+}
+
+static void zip2hc_print_old (zip2hc_ctx_t *ctx)
+{
+  zip2hc_blob_t *hashes = ctx->hashes;
+
+  membuf_appendf (ctx->out, "$pkzip2$%x*%x*", ctx->hashes_cnt, ctx->check_bytes);
+
+  // checksum-only entries first, just enough data to check the inflate header
+
+  for (u32 i = 1; i < ctx->hashes_cnt; i++)
+  {
+    u64 len = 12 + 24;
+
+    if (len > hashes[i].cmp_len) len = hashes[i].cmp_len;
+
+    membuf_appendf (ctx->out, "1*%x*%x*%" PRIx64 "*%s*%s*", 0, hashes[i].cmptype, len, hashes[i].chksum, hashes[i].chksum2);
+    membuf_append_hex (ctx->out, hashes[i].hash_data, len);
+    membuf_appendf (ctx->out, "*");
+  }
+
+  // then the smallest one, in full
+
+  const zip2hc_blob_t *p = &hashes[0];
+
+  membuf_appendf (ctx->out, "%x*%x*%" PRIx64 "*%" PRIx64 "*%x*%" PRIx64 "*%" PRIx64 "*%x*", 2, 0, p->cmp_len, p->decomp_len, p->crc, p->offset, p->offex, p->cmptype);
+  membuf_appendf (ctx->out, "%" PRIx64 "*%s*%s*", p->cmp_len, p->chksum, p->chksum2);
+  membuf_append_hex (ctx->out, p->hash_data, p->cmp_len);
+  membuf_appendf (ctx->out, "*$/pkzip2$");
+
+  zip2hc_set_info (ctx, ZIP2HC_KIND_PKZIP, (const u8 *) p->fname);
+
+  zip2hc_info_t *info = ctx->info;
+
+  info->cmptype    = p->cmptype;
+  info->offset     = p->offset;
+  info->offex      = p->offex;
+  info->cmp_len    = p->cmp_len;
+  info->decomp_len = p->decomp_len;
+  info->crc        = p->crc;
+  info->hashes_cnt = ctx->hashes_cnt;
+}
+
+/*
+ * zip2john's process_old_zip, all the encrypted entries of a traditional
+ * archive go into a single hash
+ */
+static int zip2hc_process_old (zip2hc_ctx_t *ctx)
+{
+  FILE *fp = ctx->fp;
+
+  int ret = 1;
+
+  ctx->check_in_crc = 1;
+  ctx->check_bytes  = 1;
+
+  if (fseeko (fp, 0, SEEK_SET) == -1) return -1;
+
+  while (!feof (fp))
+  {
+    const u32 id = fget32le (fp);
+
+    if (id == ZIP2HC_LOCAL_HEADER)
+    {
+      zip2hc_blob_t cur;
+
+      const int rc = zip2hc_load_blob (ctx, &cur);
+
+      if (rc == -1)
+      {
+        ret = -1;
+
+        break;
+      }
+
+      if (rc == 0) continue;
+
+      if (cur.decomp_len <= 3)
+      {
+        jmfree (cur.hash_data);
+
+        continue;
+      }
+
+      zip2hc_keep_blob (ctx, &cur);
+    }
+    else if (id == ZIP2HC_DATA_DESCRIPTOR)
+    {
+      fseeko (fp, 12, SEEK_CUR);
+    }
+    else if (id == ZIP2HC_CENTRAL_DIR || id == ZIP2HC_END_CENTRAL_DIR)
+    {
+      break;
+    }
+  }
+
+  if (ret == 1 && ctx->hashes_cnt > 0) zip2hc_print_old (ctx);
+
+  for (u32 i = 0; i < ctx->hashes_cnt; i++) jmfree (ctx->hashes[i].hash_data);
+
+  ctx->hashes_cnt = 0;
+
+  return ret;
+}
+
+/**************************************************************************
+ * local header walk, zip2john's process_file
+ *************************************************************************/
+
+static int zip2hc_process (zip2hc_ctx_t *ctx)
+{
+  FILE *fp = ctx->fp;
+
+  u8 filename[ZIP2HC_FNAME_MAXLEN];
+
+  while (!feof (fp))
+  {
+    const u32 id = fget32le (fp);
+
+    if (id == ZIP2HC_LOCAL_HEADER)
+    {
+      const off_t offset = ftello (fp) - 4;
+
+      const u16 version           = fget16le (fp);
+      const u16 flags             = fget16le (fp);
+      const u16 cmptype           = fget16le (fp);
+      const u16 lastmod_time      = fget16le (fp);
+      const u16 lastmod_date      = fget16le (fp);
+      const u32 crc               = fget32le (fp);
+      const u64 compressed_size   = fget32le (fp);
+      const u64 uncompressed_size = fget32le (fp);
+      const u16 filename_length   = fget16le (fp);
+      const u16 extrafield_length = fget16le (fp);
+
+      (void) lastmod_time;
+      (void) lastmod_date;
+
+      if (filename_length > 250)
+      {
+        fprintf (stderr, "! %s: Invalid zip file, filename length too long!\n", ctx->archive_name);
+
+        return -1;
+      }
+
+      if (fread (filename, 1, filename_length, fp) != filename_length)
+      {
+        fprintf (stderr, "Error, in fread of file data!\n");
+
+        return -1;
+      }
+
+      filename[filename_length] = 0;
+
+      if (cmptype == 99)
+      {
+        return zip2hc_process_aes (ctx, filename, extrafield_length, compressed_size, offset);
+      }
+
+      // bit 6 of the flags is not a reliable strong encryption check, the version is
+
+      if ((flags & 1) && (version == 51 || version == 52 || version >= 61))
+      {
+        const off_t previous_position = ftello (fp);
+
+        if (zip2hc_process_strong (ctx, filename, crc, uncompressed_size) == 1) return 1;
+
+        fseeko (fp, previous_position, SEEK_SET);
+        fseeko (fp, extrafield_length + compressed_size, SEEK_CUR);
+      }
+      else if (flags & 1)
+      {
+        return zip2hc_process_old (ctx);
+      }
+      else
+      {
+        fseeko (fp, extrafield_length + compressed_size, SEEK_CUR);
+      }
+    }
+    else if (id == ZIP2HC_DATA_DESCRIPTOR)
+    {
+      fseeko (fp, 12, SEEK_CUR);
+    }
+    else if (id == ZIP2HC_CENTRAL_DIR || id == ZIP2HC_END_CENTRAL_DIR)
+    {
+      break;
+    }
+  }
+
+  return 1;
+}
+
+// appends the bare hash of the first encrypted entry to out, nothing if there is none
+int zip2hc_extract (const jmprobe_t *probe, membuf_t *out, zip2hc_info_t *info)
+{
+  const char *fpath = probe->fpath;
+
+  zip2hc_ctx_t ctx;
+
+  memset (&ctx, 0, sizeof (zip2hc_ctx_t));
+  memset (info, 0, sizeof (zip2hc_info_t));
+
+  ctx.archive_name = fpath;
+  ctx.out          = out;
+  ctx.info         = info;
+
+  ctx.fp = jmprobe_fdopen (probe);
+
+  if (ctx.fp == NULL) return -1;
+
+  const int ret = zip2hc_process (&ctx);
+
+  fclose (ctx.fp);
+
+  return ret;
+}